@@ -0,0 +1,124 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/* Compares the SAT backends on pebbling and CNOT-Rz synthesis instances */
+
+#include <caterpillar/solvers/sat_backend.hpp>
+#include <caterpillar/synthesis/satbased_cnotrz.hpp>
+#include <caterpillar/synthesis/strategies/pebbling_mapping_strategy.hpp>
+
+#include <fmt/format.h>
+#include <mockturtle/generators/arithmetic.hpp>
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <tweedledum/gates/mcst_gate.hpp>
+#include <tweedledum/networks/netlist.hpp>
+#include <tweedledum/utils/bit_matrix_rm.hpp>
+#include <tweedledum/utils/parity_terms.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace caterpillar;
+
+static const std::vector<std::pair<sat_backend, std::string>> backends = {
+    {sat_backend::bsat, "bsat"},
+    {sat_backend::glucose, "glucose"}};
+
+static const std::vector<std::pair<cardinality_encoding, std::string>> encodings = {
+    {cardinality_encoding::sequential_counter, "sequential"},
+    {cardinality_encoding::totalizer, "totalizer"},
+    {cardinality_encoding::modulo_totalizer, "modulo"},
+    {cardinality_encoding::sorting_network, "sorter"}};
+
+static mockturtle::aig_network adder( uint32_t bitwidth )
+{
+  mockturtle::aig_network aig;
+  std::vector<mockturtle::aig_network::signal> a( bitwidth ), b( bitwidth );
+  std::generate( a.begin(), a.end(), [&]() { return aig.create_pi(); } );
+  std::generate( b.begin(), b.end(), [&]() { return aig.create_pi(); } );
+  auto carry = aig.get_constant( false );
+  mockturtle::carry_ripple_adder_inplace( aig, a, b, carry );
+  for ( auto const& f : a )
+  {
+    aig.create_po( f );
+  }
+  aig.create_po( carry );
+  return aig;
+}
+
+static void benchmark_pebbling()
+{
+  std::cout << fmt::format( "{:>8} {:>6} {:>11} {:>8} {:>6} {:>10} {:>10} {:>9}\n",
+                            "instance", "gates", "encoding", "backend", "steps", "vars", "clauses", "time" );
+  for ( auto bitwidth = 2u; bitwidth <= 6u; bitwidth += 2u )
+  {
+    const auto aig = adder( bitwidth );
+    for ( auto const& [encoding, encoding_name] : encodings )
+    {
+      for ( auto const& [backend, backend_name] : backends )
+      {
+        pebbling_mapping_strategy_params ps;
+        ps.pebble_limit = aig.num_gates() / 2;
+        ps.max_steps = 200u;
+        ps.encoding = encoding;
+        ps.backend = backend;
+        pebbling_mapping_strategy_stats st;
+        pebbling_mapping_strategy<mockturtle::aig_network> strategy( ps, &st );
+
+        mockturtle::stopwatch<>::duration time{};
+        const auto found = mockturtle::call_with_stopwatch( time, [&]() { return strategy.compute_steps( aig ); } );
+        std::cout << fmt::format( "{:>8} {:>6} {:>11} {:>8} {:>6} {:>10} {:>10} {:>8.2f}s\n",
+                                  fmt::format( "add{}", bitwidth ), aig.num_gates(), encoding_name, backend_name,
+                                  found ? std::to_string( strategy.num_steps() ) : "-", st.num_vars, st.num_clauses,
+                                  mockturtle::to_seconds( time ) );
+      }
+    }
+  }
+}
+
+static void benchmark_cnotrz()
+{
+  tweedledum::bit_matrix_rm<> transform( 3u, 3u );
+  transform.at( 0, 0 ) = 1;
+  transform.at( 1, 1 ) = 1;
+  transform.at( 2, 2 ) = 1;
+
+  tweedledum::parity_terms terms;
+  constexpr auto T = tweedledum::symbolic_angles::one_eighth;
+  constexpr auto Tdag = tweedledum::symbolic_angles::seven_eighth;
+  terms.add_term( 0b001, T );
+  terms.add_term( 0b010, T );
+  terms.add_term( 0b011, Tdag );
+  terms.add_term( 0b100, T );
+  terms.add_term( 0b101, Tdag );
+  terms.add_term( 0b110, Tdag );
+  terms.add_term( 0b111, T );
+
+  std::cout << fmt::format( "\n{:>8} {:>8} {:>6} {:>9}\n", "instance", "backend", "gates", "time" );
+  for ( auto const& [backend, backend_name] : backends )
+  {
+    satbased_cnotrz_params ps;
+    ps.backend = backend;
+
+    mockturtle::stopwatch<>::duration time{};
+    const auto circ = mockturtle::call_with_stopwatch( time, [&]() {
+      return satbased_cnotrz<tweedledum::netlist<tweedledum::mcst_gate>>( transform, terms, ps );
+    } );
+    std::cout << fmt::format( "{:>8} {:>8} {:>6} {:>8.2f}s\n", "toffoli", backend_name, circ.num_gates(), mockturtle::to_seconds( time ) );
+  }
+}
+
+int main()
+{
+  benchmark_pebbling();
+  benchmark_cnotrz();
+  return 0;
+}
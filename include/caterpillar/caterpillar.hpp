@@ -36,17 +36,30 @@
 #include "caterpillar/optimization/optimization_graph.hpp"
 #include "caterpillar/optimization/post_opt_esop.hpp"
 #include "caterpillar/solvers/bsat_solver.hpp"
+#include "caterpillar/solvers/cardinality.hpp"
+#include "caterpillar/solvers/maxsat_rc2.hpp"
+#include "caterpillar/solvers/sat_backend.hpp"
 #include "caterpillar/solvers/z3_solver.hpp"
+#include "caterpillar/structures/cancellation_token.hpp"
+#include "caterpillar/structures/gate_sinks.hpp"
 #include "caterpillar/structures/stg_gate.hpp"
 #include "caterpillar/structures/abstract_network.hpp"
+#include "caterpillar/synthesis/ancilla_allocator.hpp"
+#include "caterpillar/synthesis/estimate_resources.hpp"
 #include "caterpillar/synthesis/lhrs.hpp"
+#include "caterpillar/synthesis/parallel_lhrs.hpp"
 #include "caterpillar/synthesis/satbased_cnotrz.hpp"
 #include "caterpillar/synthesis/stg_to_mcx.hpp"
 #include "caterpillar/synthesis/strategies/action.hpp"
 #include "caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp"
 #include "caterpillar/synthesis/strategies/best_fit_mapping_strategy.hpp"
 #include "caterpillar/synthesis/strategies/eager_mapping_strategy.hpp"
+#include "caterpillar/synthesis/strategies/greedy_pebbling_mapping_strategy.hpp"
 #include "caterpillar/synthesis/strategies/mapping_strategy.hpp"
+#include "caterpillar/synthesis/strategies/maxsat_pebbling_mapping_strategy.hpp"
 #include "caterpillar/synthesis/strategies/pebbling_mapping_strategy.hpp"
+#include "caterpillar/synthesis/strategies/step_store.hpp"
+#include "caterpillar/synthesis/strategies/tree_pebbling_mapping_strategy.hpp"
+#include "caterpillar/synthesis/strategies/windowed_pebbling_mapping_strategy.hpp"
 #include "caterpillar/synthesis/strategies/xag_mapping_strategy.hpp"
 #include "caterpillar/verification/circuit_to_logic_network.hpp"
@@ -5,45 +5,175 @@
 *-----------------------------------------------------------------------------*/
 #pragma once
 
+#include <cassert>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
 #include <mockturtle/traits.hpp>
 #include <mockturtle/utils/node_map.hpp>
-#include <mockturtle/views/fanout_view.hpp>
 #include <percy/solvers/bsat2.hpp>
 #include <algorithm>
 
 #include "../synthesis/strategies/action.hpp"
+#include "cardinality.hpp"
 
 namespace caterpillar
 {
 
-template<typename Network>
-class pebble_solver
+namespace detail
+{
+
+/*! \brief Maximum of an array under additions to ranges of it */
+class range_max_tree
 {
-  using Steps = std::vector<std::pair<mockturtle::node<Network>, mapping_strategy_action>>;
+public:
+  explicit range_max_tree( std::vector<int32_t> const& values )
+      : _size( static_cast<uint32_t>( values.size() ) ),
+        _max( 4u * std::max<uint32_t>( _size, 1u ), 0 ),
+        _add( _max.size(), 0 )
+  {
+    if ( _size )
+    {
+      build( 1u, 0u, _size, values );
+    }
+  }
+
+  /*! \brief Adds `value` to all elements in `[begin, end)` */
+  void add( uint32_t begin, uint32_t end, int32_t value )
+  {
+    if ( begin < end )
+    {
+      add( 1u, 0u, _size, begin, end, value );
+    }
+  }
+
+  /*! \brief Maximum of the elements in `[begin, end)` */
+  int32_t max( uint32_t begin, uint32_t end ) const
+  {
+    return begin < end ? max( 1u, 0u, _size, begin, end ) : std::numeric_limits<int32_t>::min();
+  }
+
+private:
+  void build( uint32_t v, uint32_t lo, uint32_t hi, std::vector<int32_t> const& values )
+  {
+    if ( hi - lo == 1u )
+    {
+      _max[v] = values[lo];
+      return;
+    }
+    const auto mid = ( lo + hi ) / 2u;
+    build( 2u * v, lo, mid, values );
+    build( 2u * v + 1u, mid, hi, values );
+    _max[v] = std::max( _max[2u * v], _max[2u * v + 1u] );
+  }
+
+  void add( uint32_t v, uint32_t lo, uint32_t hi, uint32_t begin, uint32_t end, int32_t value )
+  {
+    if ( end <= lo || hi <= begin )
+    {
+      return;
+    }
+    if ( begin <= lo && hi <= end )
+    {
+      _max[v] += value;
+      _add[v] += value;
+      return;
+    }
+    const auto mid = ( lo + hi ) / 2u;
+    add( 2u * v, lo, mid, begin, end, value );
+    add( 2u * v + 1u, mid, hi, begin, end, value );
+    _max[v] = std::max( _max[2u * v], _max[2u * v + 1u] ) + _add[v];
+  }
+
+  int32_t max( uint32_t v, uint32_t lo, uint32_t hi, uint32_t begin, uint32_t end ) const
+  {
+    if ( begin <= lo && hi <= end )
+    {
+      return _max[v];
+    }
+    const auto mid = ( lo + hi ) / 2u;
+    auto result = std::numeric_limits<int32_t>::min();
+    if ( begin < mid )
+    {
+      result = std::max( result, max( 2u * v, lo, mid, begin, end ) );
+    }
+    if ( mid < end )
+    {
+      result = std::max( result, max( 2u * v + 1u, mid, hi, begin, end ) );
+    }
+    return result + _add[v];
+  }
+
+private:
+  uint32_t _size;
+  std::vector<int32_t> _max;
+  std::vector<int32_t> _add;
+};
 
+} // namespace detail
+
+/*! \brief SAT encoding of the reversible pebbling game
+ *
+ * `Solver` is one of percy's solver wrappers, e.g., `percy::bsat_wrapper` or
+ * `percy::bmcg_wrapper`.
+ *
+ * If `max_weight` is not 0, the total weight of all compute and uncompute
+ * moves is bounded by `max_weight`.  The weight of each move of a gate (e.g.,
+ * its T-count) is returned by `move_weight` for the node index of the gate.
+ * All moves weigh 1, if no function is given.  Values of the network are not
+ * used implicitly, a weight function may return `ntk.value( n )`.
+ *
+ * If `max_moves` is not 0, at most `max_moves` gates change their pebble in
+ * each step.  Independent of this bound, a gate and its children never change
+ * in the same step, such that the moves of a step form a layer that can be
+ * applied in any order.
+ */
+template<typename Network, class Solver = percy::bsat_wrapper>
+class pebble_solver
+{
 public:
-  pebble_solver( Network const& net, uint32_t pebbles )
+  pebble_solver( Network const& net, uint32_t pebbles, cardinality_encoding encoding = cardinality_encoding::totalizer, uint32_t max_weight = 0u, uint32_t max_moves = 0u,
+                 std::function<uint32_t( uint32_t )> const& move_weight = {} )
       : index_to_gate( net.num_gates() ),
         gate_to_index( net ),
         _net( net ),
         _pebbles( pebbles ),
-        _nr_gates( net.num_gates() )
+        _max_pebbles( pebbles ),
+        _max_weight( max_weight ),
+        _max_moves( max_moves ),
+        _nr_gates( net.num_gates() ),
+        encoder( solver, _nr_vars, encoding, pebbles + 1u, _card_stats ),
+        weight_encoder( solver, _nr_vars, cardinality_encoding::sequential_counter, max_weight + 1u, _card_stats ),
+        move_encoder( solver, _nr_vars, encoding, max_moves + 1u, _card_stats )
   {
     net.foreach_gate( [&]( auto a, auto i ) {
       gate_to_index[a] = i;
       index_to_gate[i] = a;
     } );
 
+    if ( _max_weight )
+    {
+      _weights.resize( _nr_gates, 1u );
+      if ( move_weight )
+      {
+        net.foreach_gate( [&]( auto a, auto i ) {
+          _weights[i] = move_weight( net.node_to_index( a ) );
+        } );
+      }
+    }
+
     net.foreach_po( [&]( auto po ) {
       o_set.insert( net.get_node( po ) );
     } );
 
-    extra = ( _pebbles < _nr_gates ) ? _pebbles * ( _nr_gates - _pebbles ) : 0;
+    /* the counter is only needed, if the limit is below the number of gates */
+    _has_card = _pebbles > 0u && _pebbles < _nr_gates;
+    _has_move_limit = _max_moves > 0u && _max_moves < _nr_gates;
   }
 
   inline uint32_t current_step() const
@@ -51,6 +181,12 @@ public:
     return _nr_steps;
   }
 
+  /*! \brief Number of steps of the last call to `solve` */
+  inline uint32_t solved_step() const
+  {
+    return _solved_step;
+  }
+
   inline void add_edge_clause( int p, int p_n, int ch, int ch_n )
   {
     int h[3];
@@ -77,12 +213,23 @@ public:
 
   void initialize()
   {
-    solver.set_nr_vars( _nr_gates + extra );
+    initialize( {} );
+  }
+
+  /*! \brief Starts the game with exactly the gates in `pebbled` being pebbled */
+  void initialize( std::vector<mockturtle::node<Network>> const& pebbled )
+  {
+    add_pebble_vars();
 
-    /* set constraint that everything is unpebbled */
+    std::vector<uint8_t> initial( _nr_gates, 0u );
+    for ( auto const& n : pebbled )
+    {
+      initial[gate_to_index[n]] = 1u;
+    }
+    _has_initial = !pebbled.empty();
     for ( auto v = 0u; v < _nr_gates; v++ )
     {
-      int lit = pabc::Abc_Var2Lit( v, 1 ); // zero is not negated
+      int lit = pabc::Abc_Var2Lit( pebble_var( 0, v ), initial[v] ? 0 : 1 );
       solver.add_clause( &lit, &lit + 1 );
     }
   }
@@ -90,7 +237,7 @@ public:
   void add_step()
   {
     _nr_steps++;
-    solver.set_nr_vars( ( _nr_gates + extra ) * ( 1 + _nr_steps ) );
+    add_pebble_vars();
 
     /* encode move */
     _net.foreach_gate( [&]( auto n, auto i ) {
@@ -109,228 +256,366 @@ public:
     } );
 
     /* cardinality constraint */
-    if ( ( _pebbles > 0 ) && ( _nr_gates > _pebbles ) )
+    if ( _has_card )
     {
-      /* var declaration */
-      std::vector<std::vector<int>> card_vars( _nr_gates - _pebbles );
-      auto id_start = _nr_steps * ( _nr_gates + extra ) + _nr_gates;
-      for ( auto j = 0u; j < _nr_gates - _pebbles; ++j )
+      std::vector<int> inputs( _nr_gates );
+      for ( auto i = 0u; i < _nr_gates; ++i )
       {
-        for ( auto k = 0u; k < _pebbles; ++k )
-        {
-          card_vars[j].push_back( id_start );
-          id_start++;
-        }
+        inputs[i] = pebble_var( _nr_steps, i );
       }
+      counters.push_back( encoder.count( inputs ) );
+    }
 
-      /* constraint */
-      for ( auto j = 0u; j < _nr_gates - _pebbles - 1u; j++ )
+    /* a move of a gate in this step adds its weight and counts towards the moves of the step */
+    if ( _max_weight || _has_move_limit )
+    {
+      std::vector<int> moves( _nr_gates );
+      for ( auto i = 0u; i < _nr_gates; ++i )
       {
-        for ( auto k = 0u; k < _pebbles; k++ )
-        {
-          int to_or[2];
-          to_or[0] = pabc::Abc_Var2Lit( card_vars[j][k], 1 );
-          to_or[1] = pabc::Abc_Var2Lit( card_vars[j + 1][k], 0 );
-          solver.add_clause( to_or, to_or + 2 );
-        }
+        const auto p = pebble_var( _nr_steps - 1, i );
+        const auto p_next = pebble_var( _nr_steps, i );
+        moves[i] = add_var();
+
+        int h[3];
+        h[0] = pabc::Abc_Var2Lit( p, 1 );
+        h[1] = pabc::Abc_Var2Lit( p_next, 0 );
+        h[2] = pabc::Abc_Var2Lit( moves[i], 0 );
+        solver.add_clause( h, h + 3 );
+
+        h[0] = pabc::Abc_Var2Lit( p, 0 );
+        h[1] = pabc::Abc_Var2Lit( p_next, 1 );
+        solver.add_clause( h, h + 3 );
       }
-
-      for ( auto j = 0u; j < _nr_gates - _pebbles; j++ )
+      if ( _max_weight )
       {
-
-        for ( auto kp = 0u; kp <= _pebbles; kp++ )
+        weight_encoder.add_weighted( weight_counter, moves, _weights );
+      }
+      if ( _has_move_limit )
+      {
+        auto counter = move_encoder.count( moves );
+        if ( const auto v = move_encoder.bound_var( counter, _max_moves ); v != -1 )
         {
-          int k = kp - 1;
-          int to_var_or[3];
-
-          if ( k == -1 )
-          {
-            to_var_or[0] = pabc::Abc_Var2Lit( _nr_steps * ( _nr_gates + extra ) + j + k + 1, 1 );
-            to_var_or[1] = pabc::Abc_Var2Lit( card_vars[j][k + 1], 0 );
-            solver.add_clause( to_var_or, to_var_or + 2 );
-          }
-          else if ( k == static_cast<int>( _pebbles - 1 ) )
-          {
-            to_var_or[0] = pabc::Abc_Var2Lit( _nr_steps * ( _nr_gates + extra ) + j + k + 1, 1 );
-            to_var_or[1] = pabc::Abc_Var2Lit( card_vars[j][k], 1 );
-            solver.add_clause( to_var_or, to_var_or + 2 );
-          }
-          else
-          {
-            to_var_or[0] = pabc::Abc_Var2Lit( _nr_steps * ( _nr_gates + extra ) + j + k + 1, 1 );
-            to_var_or[1] = pabc::Abc_Var2Lit( card_vars[j][k], 1 );
-            to_var_or[2] = pabc::Abc_Var2Lit( card_vars[j][k + 1], 0 );
-            solver.add_clause( to_var_or, to_var_or + 3 );
-          }
+          int lit = pabc::Abc_Var2Lit( v, 1 );
+          solver.add_clause( &lit, &lit + 1 );
         }
       }
     }
   }
 
+  /*! \brief Tightens the pebble limit without rebuilding the SAT instance
+   *
+   * The new limit must not exceed `max_pebbles()`.  Steps that have been added
+   * before are kept, since a schedule for fewer pebbles needs at least as many
+   * steps.
+   */
+  void set_pebbles( uint32_t pebbles )
+  {
+    assert( pebbles <= max_pebbles() );
+    _pebbles = pebbles;
+  }
+
+  /*! \brief Largest pebble limit that can be selected with `set_pebbles` */
+  inline uint32_t max_pebbles() const
+  {
+    return _has_card ? _max_pebbles : 0u;
+  }
+
+  /*! \brief Variables and clauses of the cardinality constraints */
+  inline cardinality_stats const& card_stats() const
+  {
+    return _card_stats;
+  }
+
+  inline int nr_vars() const
+  {
+    return static_cast<int>( _nr_vars );
+  }
+
+  inline int nr_clauses()
+  {
+    return solver.nr_clauses();
+  }
+
   percy::synth_result solve( uint32_t conflict_limit )
   {
+    return solve( conflict_limit, _nr_steps );
+  }
+
+  /*! \brief Solves for a schedule whose final state is reached after `step` steps
+   *
+   * `step` must not exceed `current_step()`.  The remaining steps do not
+   * change any pebble, and `extract_result` emits the first `step` steps.
+   */
+  percy::synth_result solve( uint32_t conflict_limit, uint32_t step )
+  {
+    assert( step <= _nr_steps );
+    _solved_step = step;
+
     std::vector<int> p( _nr_gates );
     _net.foreach_gate( [&]( auto n, auto i ) {
-      p[i] = pabc::Abc_Var2Lit( pebble_var( _nr_steps, i ), o_set.count( n ) ? 0 : 1 );
+      p[i] = pabc::Abc_Var2Lit( pebble_var( step, i ), o_set.count( n ) ? 0 : 1 );
     } );
-    return solver.solve( &p[0], &p[0] + _nr_gates, conflict_limit );
+
+    /* select the pebble limit in every step */
+    for ( auto& counter : counters )
+    {
+      if ( const auto v = encoder.bound_var( counter, _pebbles ); v != -1 )
+      {
+        p.push_back( pabc::Abc_Var2Lit( v, 1 ) );
+      }
+    }
+    if ( _max_weight )
+    {
+      if ( const auto v = weight_encoder.bound_var( weight_counter, _max_weight ); v != -1 )
+      {
+        p.push_back( pabc::Abc_Var2Lit( v, 1 ) );
+      }
+    }
+    return solver.solve( p.data(), p.data() + p.size(), conflict_limit );
   }
 
-  inline int pebble_var( int step, int gate )
+  /*! \brief Lower bound on the number of steps of any schedule from no pebbles
+   *
+   * A gate on level `l` cannot be computed before step `l`.  A gate that is
+   * not an output must be uncomputed after its fanout has been computed and
+   * before its children that are not outputs are uncomputed.  Further, not
+   * more gates than pebbles can be computed in a single step, and all gates
+   * that are not outputs are computed and uncomputed within the bound on the
+   * moves in each step.  Returns 0, if
+   * the game starts with pebbled gates, and the largest integer, if there are
+   * fewer pebbles than outputs.
+   */
+  uint32_t lower_bound_steps() const
   {
-    return step * ( extra + _nr_gates ) + gate;
+    if ( _has_initial )
+    {
+      return 0u;
+    }
+
+    /* level and longest path of non-output gates ending in each gate, in topological order */
+    std::vector<uint32_t> level( _nr_gates, 0u ), run( _nr_gates, 0u ), order;
+    std::vector<uint8_t> visited( _nr_gates, 0u );
+    std::vector<std::pair<uint32_t, bool>> stack;
+    uint32_t num_outputs{0u};
+    for ( auto const& o : o_set )
+    {
+      if ( !_net.is_constant( o ) && !_net.is_pi( o ) )
+      {
+        stack.emplace_back( gate_to_index[o], false );
+        ++num_outputs;
+      }
+    }
+    while ( !stack.empty() )
+    {
+      const auto [i, expanded] = stack.back();
+      stack.pop_back();
+      if ( expanded )
+      {
+        order.push_back( i );
+        continue;
+      }
+      if ( visited[i] )
+      {
+        continue;
+      }
+      visited[i] = 1u;
+      stack.emplace_back( i, true );
+      foreach_gate_child( i, [&]( auto c ) {
+        if ( !visited[c] )
+        {
+          stack.emplace_back( c, false );
+        }
+      } );
+    }
+
+    uint32_t bound{0u};
+    for ( auto i : order )
+    {
+      const auto is_output = o_set.count( index_to_gate[i] ) != 0u;
+      foreach_gate_child( i, [&]( auto c ) {
+        level[i] = std::max( level[i], level[c] );
+        run[i] = std::max( run[i], run[c] );
+      } );
+      ++level[i];
+      run[i] = is_output ? 0u : run[i] + 1u;
+
+      bound = std::max( bound, level[i] );
+      if ( !is_output )
+      {
+        /* some fanout on level level[i] + 1 or higher must be computed first */
+        bound = std::max( bound, level[i] + run[i] + 1u );
+      }
+    }
+
+    if ( _pebbles > 0u )
+    {
+      if ( _pebbles < num_outputs )
+      {
+        return std::numeric_limits<uint32_t>::max();
+      }
+      bound = std::max<uint32_t>( bound, ( order.size() + _pebbles - 1 ) / _pebbles );
+    }
+    if ( _has_move_limit )
+    {
+      const auto num_moves = 2u * static_cast<uint32_t>( order.size() ) - num_outputs;
+      bound = std::max<uint32_t>( bound, ( num_moves + _max_moves - 1 ) / _max_moves );
+    }
+    return bound;
   }
 
-  Steps extract_result()
+  inline int pebble_var( int step, int gate )
   {
-    std::vector<std::vector<int>> vals_step( _nr_steps + 1 );
-    Steps steps;
+    return step_offsets[step] + gate;
+  }
 
-    for ( auto i = 0u; i <= _nr_steps; ++i )
+  /*! \brief Extracts the moves of the last solved game
+   *
+   * Redundant moves are removed: a gate that is computed and uncomputed
+   * again while none of its fanouts change, and a gate that is uncomputed and
+   * computed again while there is a free pebble in all steps in between.  The
+   * events of each gate are traversed once in the order of the steps, where
+   * the number of pebbles of each step is maintained in a range maximum tree.
+   *
+   * The moves are appended to `steps` with `steps.emplace_back( node, action )`,
+   * e.g., into the `step_store` of a mapping strategy.
+   */
+  template<class Steps>
+  void extract_result( Steps& steps )
+  {
+    const auto num_steps = _solved_step;
+
+    /* events of each gate, and events of each step as gate and position in the gate's events */
+    std::vector<std::vector<pebble_event>> events( _nr_gates );
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> step_events( num_steps + 1 );
+    std::vector<uint8_t> pebbled( _nr_gates );
+    std::vector<int32_t> counts( num_steps + 1, 0 );
+    for ( auto j = 0u; j < _nr_gates; ++j )
+    {
+      pebbled[j] = solver.var_value( pebble_var( 0, j ) );
+      counts[0] += pebbled[j];
+    }
+    for ( auto i = 1u; i <= num_steps; ++i )
     {
       for ( auto j = 0u; j < _nr_gates; ++j )
       {
-        const auto value = solver.var_value( pebble_var( i, j ) );
-        vals_step[i].push_back( value );
+        const uint8_t value = solver.var_value( pebble_var( i, j ) );
+        if ( value != pebbled[j] )
+        {
+          step_events[i].emplace_back( j, static_cast<uint32_t>( events[j].size() ) );
+          events[j].push_back( {i, value != 0u, false} );
+          pebbled[j] = value;
+        }
+        counts[i] += value;
       }
     }
 
-    /* remove redundant steps */
-    mockturtle::fanout_view<Network> fanout_view{_net};
-    for ( auto i = 1u; i <= _nr_steps; ++i )
+    std::vector<std::vector<uint32_t>> fanouts( _nr_gates );
+    for ( auto j = 0u; j < _nr_gates; ++j )
     {
-      for ( auto j = 0u; j < _nr_gates; ++j )
+      foreach_gate_child( j, [&]( auto c ) { fanouts[c].push_back( j ); } );
+    }
+
+    /* position of the first event of each gate that may lie after the current step */
+    std::vector<uint32_t> cursor( _nr_gates, 0u );
+    const auto next_event = [&]( uint32_t j, uint32_t step ) {
+      auto& k = cursor[j];
+      while ( k < events[j].size() && ( events[j][k].removed || events[j][k].step <= step ) )
       {
-        /* Is j pebbled at step i? */
-        if ( vals_step[i][j] && !vals_step[i - 1][j] )
-        {
-          bool redundant = true;
-          int redundant_until = -1;
-          std::vector<int> parent_indexes;
-          fanout_view.foreach_fanout( index_to_gate[j], [&]( auto const& parent ) {
-            parent_indexes.push_back( gate_to_index[parent] );
-          } );
-          for ( auto ii = i + 1u; ii <= _nr_steps; ++ii )
-          {
-            for ( auto parent : parent_indexes )
-            {
-              if ( vals_step[ii][parent] != vals_step[ii - 1][parent] )
-              {
-                redundant = false;
-                break;
-              }
-            }
-            if ( !redundant )
-              break;
-            if ( !vals_step[ii][j] && vals_step[ii - 1][j] )
-            {
-              redundant_until = ii;
-              break;
-            }
-          }
+        ++k;
+      }
+      return k < events[j].size() ? events[j][k].step : std::numeric_limits<uint32_t>::max();
+    };
 
-          if ( redundant && redundant_until > 0 )
-          {
-            // Found redundant gate j at step i until redundant_until
-            for ( int ii = i; ii < redundant_until; ++ii )
-            {
-              vals_step[ii][j] = 0;
-            }
-          }
-        }
+    detail::range_max_tree tree( counts );
+    const auto limit = _pebbles ? static_cast<int32_t>( _pebbles ) : std::numeric_limits<int32_t>::max();
 
-        /* Is j unpebbled at step i? */
-        if ( !vals_step[i][j] && vals_step[i - 1][j] )
+    for ( auto i = 1u; i <= num_steps; ++i )
+    {
+      for ( auto const& [j, k] : step_events[i] )
+      {
+        auto& event = events[j][k];
+        if ( event.removed || k + 1u == events[j].size() )
         {
-          bool redundant = true;
-          int redundant_until = -1;
-          for ( auto ii = i + 1u; ii <= _nr_steps; ++ii )
-          {
-            if ( std::count( vals_step[ii].begin(), vals_step[ii].end(), 1 ) == _pebbles )
-            {
-              redundant = false;
-              break;
-            }
-            if ( vals_step[ii][j] && !vals_step[ii - 1][j] )
-            {
-              redundant_until = ii;
-              break;
-            }
-          }
+          continue;
+        }
+        auto& next = events[j][k + 1u];
 
-          if ( redundant && redundant_until > 0 )
+        if ( event.compute )
+        {
+          /* no fanout changes until the gate is uncomputed */
+          const auto redundant = std::all_of( fanouts[j].begin(), fanouts[j].end(), [&]( auto p ) {
+            return next_event( p, i ) > next.step;
+          } );
+          if ( redundant )
           {
-            // Found redundant gate j at step i until redundant_until
-            for ( int ii = i; ii < redundant_until; ++ii )
-            {
-              vals_step[ii][j] = 1;
-            }
+            tree.add( i, next.step, -1 );
+            event.removed = next.removed = true;
           }
         }
+        else if ( tree.max( i, next.step ) < limit )
+        {
+          /* the pebble stays on the gate until it is computed again */
+          tree.add( i, next.step, 1 );
+          event.removed = next.removed = true;
+        }
       }
     }
 
-    for ( auto s = 1u; s <= _nr_steps; s++ )
+    /* in each step, the uncompute moves precede the compute moves, which are emitted in reverse order */
+    for ( auto i = 1u; i <= num_steps; ++i )
     {
-      auto it = steps.end();
-
-      for ( auto n = 0u; n < _nr_gates; n++ )
+      for ( auto const& [j, k] : step_events[i] )
       {
-        if ( vals_step[s][n] != vals_step[s - 1][n] )
+        if ( !events[j][k].removed && !events[j][k].compute )
         {
-          bool inplace = false;
-          uint32_t target{};
-
-#if 0
-          kitty::dynamic_truth_table tt = _net.node_function( gate_to_index[n] );
-          auto clone = tt.construct();
-          kitty::create_parity( clone );
-
-          if ( !o_set.count( index_to_gate[n] ) && clone == tt )
-          {
-            _net.foreach_fanin(index_to_gate[n], [&] (auto ch_signal)
-            {
-              auto ch_node = _net.get_node(ch_signal);
-              if (_net.fanout_size(ch_node) == 1)
-              {
-                inplace = true;
-                target = _net.node_to_index( ch_node );
-                return false;
-              }
-              return true;
-            });
-          }
-#endif
-
-          if ( !vals_step[s][n] )
-          {
-            if ( inplace )
-            {
-              it = steps.insert( it, {index_to_gate[n], uncompute_inplace_action{target}} );
-              ++it;
-            }
-            else
-            {
-              it = steps.insert( it, {index_to_gate[n], uncompute_action{}} );
-              ++it;
-            }
-          }
-          else
-          {
-            if ( inplace )
-            {
-              it = steps.insert( it, {index_to_gate[n], compute_inplace_action{target}} );
-            }
-            else
-            {
-              it = steps.insert( it, {index_to_gate[n], compute_action{}} );
-            }
-          }
+          steps.emplace_back( index_to_gate[j], uncompute_action{} );
+        }
+      }
+      for ( auto it = step_events[i].rbegin(); it != step_events[i].rend(); ++it )
+      {
+        if ( !events[it->first][it->second].removed && events[it->first][it->second].compute )
+        {
+          steps.emplace_back( index_to_gate[it->first], compute_action{} );
         }
       }
     }
+  }
+
+private:
+  /*! \brief change of a gate's pebble in a step */
+  struct pebble_event
+  {
+    uint32_t step;
+    bool compute;
+    bool removed;
+  };
 
-    return steps;
+  template<class Fn>
+  void foreach_gate_child( uint32_t i, Fn&& fn ) const
+  {
+    _net.foreach_fanin( index_to_gate[i], [&]( auto const& f ) {
+      const auto c = _net.get_node( f );
+      if ( !_net.is_constant( c ) && !_net.is_pi( c ) )
+      {
+        fn( static_cast<uint32_t>( gate_to_index[c] ) );
+      }
+    } );
+  }
+
+  int add_var()
+  {
+    solver.add_var();
+    return static_cast<int>( _nr_vars++ );
+  }
+
+  void add_pebble_vars()
+  {
+    step_offsets.push_back( _nr_vars );
+    for ( auto i = 0u; i < _nr_gates; ++i )
+    {
+      solver.add_var();
+    }
+    _nr_vars += _nr_gates;
   }
 
 private:
@@ -338,12 +623,35 @@ private:
   mockturtle::node_map<int, Network> gate_to_index;
   std::unordered_set<mockturtle::node<Network>> o_set;
 
-  percy::bsat_wrapper solver;
+  Solver solver;
   Network const& _net;
   uint32_t _pebbles;
+  uint32_t _max_pebbles;
+  uint32_t _max_weight;
+  uint32_t _max_moves;
   uint32_t _nr_gates;
   uint32_t _nr_steps = 0;
-  uint32_t extra;
+  uint32_t _solved_step = 0;
+  uint32_t _nr_vars = 0;
+  bool _has_card;
+  bool _has_move_limit;
+  bool _has_initial{false};
+
+  /*! \brief first pebble variable of each step, auxiliary variables follow the pebble variables */
+  std::vector<uint32_t> step_offsets;
+  cardinality_stats _card_stats;
+  cardinality_encoder<Solver> encoder;
+
+  /*! \brief cardinality counters of each step after the initial one */
+  std::vector<cardinality_counter> counters;
+
+  /*! \brief weight of each gate and counter of the total weight of all moves */
+  std::vector<uint32_t> _weights;
+  cardinality_encoder<Solver> weight_encoder;
+  cardinality_counter weight_counter;
+
+  /*! \brief encoder of the bound on the moves in each step */
+  cardinality_encoder<Solver> move_encoder;
 };
 
 } // namespace caterpillar
@@ -0,0 +1,442 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file cardinality.hpp
+  \brief CNF encodings of at-most-k constraints with selectable bounds
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <percy/solvers/solver_wrapper.hpp>
+
+namespace caterpillar
+{
+
+/*! \brief Encoding of the cardinality constraint */
+enum class cardinality_encoding
+{
+  /*! \brief sequential counter, O(n * k) variables and clauses */
+  sequential_counter,
+  /*! \brief totalizer, O(n log n) variables and O(n * k) clauses */
+  totalizer,
+  /*! \brief modulo totalizer, O(n sqrt k) clauses */
+  modulo_totalizer,
+  /*! \brief odd-even merge sorting network truncated to k + 1 outputs */
+  sorting_network
+};
+
+struct cardinality_stats
+{
+  /*! \brief Number of auxiliary variables. */
+  uint64_t num_vars{0};
+
+  /*! \brief Number of clauses. */
+  uint64_t num_clauses{0};
+
+  void report() const
+  {
+    std::cout << fmt::format( "[i] cardinality variables = {}   cardinality clauses = {}\n", num_vars, num_clauses );
+  }
+};
+
+/*! \brief Counter over a set of literals
+ *
+ * Unary encodings store in `lower[i]` a variable that is implied, if at least
+ * `i + 1` inputs are true.  The modulo totalizer stores the count modulo
+ * `modulo` in `lower` and the quotient in `upper`.
+ */
+struct cardinality_counter
+{
+  uint32_t num_inputs{0};
+  uint32_t modulo{0};
+  std::vector<int> lower;
+  std::vector<int> upper;
+
+  /*! \brief bound variables of the modulo totalizer */
+  std::unordered_map<uint32_t, int> bounds;
+};
+
+/*! \brief Encodes counters whose bound is selected by assumptions
+ *
+ * A counter is created with `count` for at most `cap` counted inputs.  The
+ * variable returned by `bound_var` for some `k < cap` is implied, if more than
+ * `k` inputs are true, such that assuming its complement enforces an
+ * at-most-k constraint.
+ */
+template<class Solver>
+class cardinality_encoder
+{
+public:
+  cardinality_encoder( Solver& solver, uint32_t& nr_vars, cardinality_encoding encoding, uint32_t cap, cardinality_stats& st )
+      : solver( solver ),
+        nr_vars( nr_vars ),
+        encoding( encoding ),
+        cap( std::max( cap, 1u ) ),
+        st( st )
+  {
+  }
+
+  cardinality_counter count( std::vector<int> const& inputs )
+  {
+    cardinality_counter c;
+    c.num_inputs = static_cast<uint32_t>( inputs.size() );
+    switch ( encoding )
+    {
+    case cardinality_encoding::sequential_counter:
+      c.lower = sequential_counter( inputs );
+      break;
+    case cardinality_encoding::totalizer:
+      c.lower = totalizer( inputs.data(), inputs.data() + inputs.size() );
+      break;
+    case cardinality_encoding::modulo_totalizer:
+      c.modulo = std::max( 2u, static_cast<uint32_t>( std::ceil( std::sqrt( cap ) ) ) );
+      std::tie( c.upper, c.lower ) = modulo_totalizer( inputs.data(), inputs.data() + inputs.size(), c.modulo );
+      break;
+    case cardinality_encoding::sorting_network:
+      c.lower = sorter( inputs );
+      break;
+    }
+    return c;
+  }
+
+  /*! \brief Variable implied by more than `k` true inputs (-1, if there are at most `k` inputs) */
+  int bound_var( cardinality_counter& c, uint32_t k )
+  {
+    assert( k < cap );
+    if ( k >= c.num_inputs )
+    {
+      return -1;
+    }
+    if ( c.modulo == 0u )
+    {
+      return c.lower[k];
+    }
+
+    if ( const auto it = c.bounds.find( k ); it != c.bounds.end() )
+    {
+      return it->second;
+    }
+
+    /* more than k inputs, iff quotient > q or quotient = q and remainder >= r */
+    const auto q = ( k + 1 ) / c.modulo;
+    const auto r = ( k + 1 ) % c.modulo;
+    const auto o = new_var();
+    if ( q < c.upper.size() )
+    {
+      add_clause( {lit( c.upper[q], 1 ), lit( o, 0 )} );
+    }
+    if ( q == 0u )
+    {
+      add_clause( {lit( c.lower[r - 1], 1 ), lit( o, 0 )} );
+    }
+    else if ( r == 0u )
+    {
+      add_clause( {lit( c.upper[q - 1], 1 ), lit( o, 0 )} );
+    }
+    else if ( r <= c.lower.size() )
+    {
+      add_clause( {lit( c.upper[q - 1], 1 ), lit( c.lower[r - 1], 1 ), lit( o, 0 )} );
+    }
+    c.bounds.emplace( k, o );
+    return o;
+  }
+
+  /*! \brief Adds weighted inputs to a counter
+   *
+   * Extends `c`, which must be empty or have been created with this method,
+   * with a sequential weight counter, such that `bound_var( c, k )` is implied,
+   * if the total weight of the true inputs is more than `k`.  Inputs with
+   * weight 0 are ignored.  The counter can be extended repeatedly.
+   */
+  void add_weighted( cardinality_counter& c, std::vector<int> const& inputs, std::vector<uint32_t> const& weights )
+  {
+    assert( c.modulo == 0u && inputs.size() == weights.size() );
+    for ( auto i = 0u; i < inputs.size(); ++i )
+    {
+      const auto x = inputs[i];
+      const auto w = weights[i];
+      if ( w == 0u )
+      {
+        continue;
+      }
+
+      auto next = new_vars( static_cast<uint32_t>( std::min<uint64_t>( uint64_t( c.num_inputs ) + w, cap ) ) );
+      for ( auto j = 0u; j < std::min<uint32_t>( w, next.size() ); ++j )
+      {
+        add_clause( {lit( x, 1 ), lit( next[j], 0 )} );
+      }
+      for ( auto j = 0u; j < c.lower.size(); ++j )
+      {
+        add_clause( {lit( c.lower[j], 1 ), lit( next[j], 0 )} );
+        if ( j + w < next.size() )
+        {
+          add_clause( {lit( x, 1 ), lit( c.lower[j], 1 ), lit( next[j + w], 0 )} );
+        }
+      }
+      c.lower = std::move( next );
+      c.num_inputs = static_cast<uint32_t>( std::min<uint64_t>( uint64_t( c.num_inputs ) + w, std::numeric_limits<uint32_t>::max() ) );
+    }
+  }
+
+private:
+  static int lit( int var, int negated )
+  {
+    return pabc::Abc_Var2Lit( var, negated );
+  }
+
+  int new_var()
+  {
+    solver.add_var();
+    ++st.num_vars;
+    return static_cast<int>( nr_vars++ );
+  }
+
+  void add_clause( std::initializer_list<int> lits )
+  {
+    std::vector<int> clause( lits );
+    solver.add_clause( clause.data(), clause.data() + clause.size() );
+    ++st.num_clauses;
+  }
+
+  std::vector<int> new_vars( uint32_t num )
+  {
+    std::vector<int> vars( num );
+    for ( auto& v : vars )
+    {
+      v = new_var();
+    }
+    return vars;
+  }
+
+  /* s[j] of prefix i is implied, if at least j + 1 of the first i inputs are true */
+  std::vector<int> sequential_counter( std::vector<int> const& inputs )
+  {
+    std::vector<int> s;
+    for ( auto x : inputs )
+    {
+      auto next = new_vars( std::min<uint32_t>( s.size() + 1u, cap ) );
+      add_clause( {lit( x, 1 ), lit( next[0], 0 )} );
+      for ( auto j = 0u; j < s.size(); ++j )
+      {
+        add_clause( {lit( s[j], 1 ), lit( next[j], 0 )} );
+        if ( j + 1 < next.size() )
+        {
+          add_clause( {lit( x, 1 ), lit( s[j], 1 ), lit( next[j + 1], 0 )} );
+        }
+      }
+      s = std::move( next );
+    }
+    return s;
+  }
+
+  std::vector<int> totalizer( int const* begin, int const* end )
+  {
+    const auto num_inputs = static_cast<uint32_t>( end - begin );
+    if ( num_inputs == 1u )
+    {
+      return {*begin};
+    }
+
+    const auto mid = begin + num_inputs / 2;
+    const auto a = totalizer( begin, mid );
+    const auto b = totalizer( mid, end );
+    const auto r = new_vars( std::min( num_inputs, cap ) );
+
+    for ( auto i = 0u; i <= a.size(); ++i )
+    {
+      for ( auto j = 0u; j <= b.size(); ++j )
+      {
+        if ( i + j == 0u || i + j > r.size() )
+        {
+          continue;
+        }
+        add_implication( a, i, b, j, -1, r[i + j - 1] );
+      }
+    }
+    return r;
+  }
+
+  std::pair<std::vector<int>, std::vector<int>> modulo_totalizer( int const* begin, int const* end, uint32_t modulo )
+  {
+    const auto num_inputs = static_cast<uint32_t>( end - begin );
+    if ( num_inputs == 1u )
+    {
+      return {{}, {*begin}};
+    }
+
+    const auto mid = begin + num_inputs / 2;
+    const auto [ua, la] = modulo_totalizer( begin, mid, modulo );
+    const auto [ub, lb] = modulo_totalizer( mid, end, modulo );
+
+    const auto has_carry = la.size() + lb.size() >= modulo;
+    const auto carry = has_carry ? new_var() : -1;
+    const auto l = new_vars( std::min<uint32_t>( modulo - 1u, la.size() + lb.size() ) );
+    const auto u = new_vars( std::min<uint32_t>( cap / modulo + 1u, ua.size() + ub.size() + ( has_carry ? 1u : 0u ) ) );
+
+    for ( auto i = 0u; i <= la.size(); ++i )
+    {
+      for ( auto j = 0u; j <= lb.size(); ++j )
+      {
+        const auto s = i + j;
+        if ( s == 0u )
+        {
+          continue;
+        }
+        if ( s < modulo )
+        {
+          /* the remainder is only implied without carry */
+          add_implication( la, i, lb, j, -1, l[s - 1], carry );
+        }
+        else
+        {
+          add_implication( la, i, lb, j, -1, carry );
+          if ( s > modulo )
+          {
+            add_implication( la, i, lb, j, -1, l[s - modulo - 1] );
+          }
+        }
+      }
+    }
+
+    for ( auto i = 0u; i <= ua.size(); ++i )
+    {
+      for ( auto j = 0u; j <= ub.size(); ++j )
+      {
+        const auto t = i + j;
+        if ( t > 0u )
+        {
+          add_implication( ua, i, ub, j, -1, u[std::min<uint32_t>( t, u.size() ) - 1] );
+        }
+        if ( has_carry )
+        {
+          add_implication( ua, i, ub, j, carry, u[std::min<uint32_t>( t + 1, u.size() ) - 1] );
+        }
+      }
+    }
+
+    return {u, l};
+  }
+
+  /* a[i - 1] and b[j - 1] (and c) imply r (or d), index 0 is constant true */
+  void add_implication( std::vector<int> const& a, uint32_t i, std::vector<int> const& b, uint32_t j, int c, int r, int d = -1 )
+  {
+    int clause[4];
+    auto k = 0u;
+    if ( i > 0u )
+    {
+      clause[k++] = lit( a[i - 1], 1 );
+    }
+    if ( j > 0u )
+    {
+      clause[k++] = lit( b[j - 1], 1 );
+    }
+    if ( c != -1 )
+    {
+      clause[k++] = lit( c, 1 );
+    }
+    clause[k++] = lit( r, 0 );
+    if ( d != -1 )
+    {
+      clause[k++] = lit( d, 0 );
+    }
+    solver.add_clause( clause, clause + k );
+    ++st.num_clauses;
+  }
+
+  /* sorts descending, -1 is constant false */
+  std::vector<int> sorter( std::vector<int> const& inputs )
+  {
+    if ( inputs.size() <= 1u )
+    {
+      return inputs;
+    }
+    const auto mid = inputs.begin() + inputs.size() / 2;
+    auto a = sorter( std::vector<int>( inputs.begin(), mid ) );
+    auto b = sorter( std::vector<int>( mid, inputs.end() ) );
+    auto r = merge( a, b );
+    r.resize( std::min<std::size_t>( r.size(), cap ) );
+    return r;
+  }
+
+  /* odd-even merge of two sorted sequences of arbitrary length */
+  std::vector<int> merge( std::vector<int> const& a, std::vector<int> const& b )
+  {
+    if ( a.empty() )
+    {
+      return b;
+    }
+    if ( b.empty() )
+    {
+      return a;
+    }
+    if ( a.size() == 1u && b.size() == 1u )
+    {
+      const auto [hi, lo] = comparator( a[0], b[0] );
+      return {hi, lo};
+    }
+
+    std::vector<int> a_even, a_odd, b_even, b_odd;
+    for ( auto i = 0u; i < a.size(); ++i )
+    {
+      ( i % 2 == 0 ? a_even : a_odd ).push_back( a[i] );
+    }
+    for ( auto i = 0u; i < b.size(); ++i )
+    {
+      ( i % 2 == 0 ? b_even : b_odd ).push_back( b[i] );
+    }
+    const auto v = merge( a_even, b_even );
+    const auto w = merge( a_odd, b_odd );
+
+    std::vector<int> r{v[0]};
+    auto i = 0u;
+    for ( ; i < w.size() && i + 1 < v.size(); ++i )
+    {
+      const auto [hi, lo] = comparator( w[i], v[i + 1] );
+      r.push_back( hi );
+      r.push_back( lo );
+    }
+    r.insert( r.end(), w.begin() + i, w.end() );
+    r.insert( r.end(), v.begin() + i + 1, v.end() );
+    return r;
+  }
+
+  std::pair<int, int> comparator( int a, int b )
+  {
+    if ( a == -1 || b == -1 )
+    {
+      return {a == -1 ? b : a, -1};
+    }
+    const auto hi = new_var();
+    const auto lo = new_var();
+    add_clause( {lit( a, 1 ), lit( hi, 0 )} );
+    add_clause( {lit( b, 1 ), lit( hi, 0 )} );
+    add_clause( {lit( a, 1 ), lit( b, 1 ), lit( lo, 0 )} );
+    return {hi, lo};
+  }
+
+private:
+  Solver& solver;
+  uint32_t& nr_vars;
+  cardinality_encoding encoding;
+  uint32_t cap;
+  cardinality_stats& st;
+};
+
+} // namespace caterpillar
@@ -0,0 +1,216 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file maxsat_rc2.hpp
+  \brief cancellable RC2 MaxSAT solver
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <easy/sat2/cardinality.hpp>
+#include <easy/sat2/maxsat.hpp>
+
+#include "../structures/cancellation_token.hpp"
+
+namespace caterpillar
+{
+
+/*! \brief RC2 MaxSAT solver that can be cancelled
+ *
+ * Runs the RC2 procedure of `easy::sat2::maxsat_solver<maxsat_rc2>` on the
+ * same clauses, but checks a cancellation token before each SAT call.  RC2
+ * only finds a solution in its last iteration, such that `solve` fails
+ * without solution if it is cancelled.  A single SAT call is not
+ * interrupted.
+ */
+class maxsat_rc2_solver : public easy::sat2::maxsat_solver<easy::sat2::maxsat_rc2>
+{
+public:
+  using base_t = easy::sat2::maxsat_solver<easy::sat2::maxsat_rc2>;
+  using base_t::maxsat_solver;
+
+  /*! \brief Solves the problem, or fails if `cancellation` is cancelled before */
+  state solve( cancellation_token const& cancellation = {} )
+  {
+    if ( cancellation.is_cancelled() || _solver.solve() == easy::sat2::sat_solver::state::unsat || _soft_clauses.empty() )
+    {
+      return _state = state::fail;
+    }
+
+    std::vector<int> sels, sums;
+    std::map<int, std::shared_ptr<easy::sat2::totalizer_tree>> t_objects;
+    std::map<int, int> bounds;
+    std::map<int, int> selector_to_clause;
+
+    /* a soft clause that is not a unit clause gets a fresh selector variable */
+    for ( auto i = 0u; i < _soft_clauses.size(); ++i )
+    {
+      auto clause = _soft_clauses[i];
+      auto selector = clause[0u];
+      if ( clause.size() > 1u )
+      {
+        selector = _sid++;
+        clause.push_back( -selector );
+        add_clause( clause );
+      }
+      sels.push_back( selector );
+      selector_to_clause.emplace( selector, static_cast<int>( i ) );
+    }
+    _selectors = sels;
+
+    while ( !cancellation.is_cancelled() )
+    {
+      std::vector<int> assumptions( sels );
+      assumptions.insert( assumptions.end(), sums.begin(), sums.end() );
+
+      if ( _solver.solve( assumptions ) == easy::sat2::sat_solver::state::sat )
+      {
+        const auto model = _solver.get_model();
+        for ( auto i = 0u; i < _soft_clauses.size(); ++i )
+        {
+          ( model[_selectors[i]] ? _enabled_clauses : _disabled_clauses ).push_back( static_cast<int>( i ) );
+        }
+        return _state = state::success;
+      }
+
+      /* divide core into selectors and sums */
+      const auto core = _solver.get_core();
+      std::vector<int> core_sels, core_sums;
+      int w_min = std::numeric_limits<int>::max();
+      for ( auto i = 0u; i < core.size(); ++i )
+      {
+        if ( std::find( sels.begin(), sels.end(), core[i] ) != sels.end() )
+        {
+          core_sels.push_back( core[i] );
+        }
+        else if ( std::find( sums.begin(), sums.end(), core[i] ) != sums.end() )
+        {
+          core_sums.push_back( core[i] );
+        }
+        w_min = std::min( w_min, _weights.at( selector_to_clause.at( core[i] ) ) );
+      }
+
+      std::vector<int> garbage;
+      if ( core_sels.size() != 1u || !core_sums.empty() )
+      {
+        std::vector<int> rels;
+        for ( auto l : core_sels )
+        {
+          auto& w = _weights.at( selector_to_clause.at( l ) );
+          if ( w == w_min )
+          {
+            /* the selector is relaxed and no longer assumed */
+            garbage.push_back( l );
+            rels.push_back( -l );
+          }
+          else
+          {
+            /* the remaining weight stays assumed, a relaxed copy is added */
+            w -= w_min;
+            const auto relaxed = _sid++;
+            add_clause( {l, relaxed} );
+            rels.push_back( relaxed );
+          }
+        }
+
+        for ( auto l : core_sums )
+        {
+          auto& w = _weights[selector_to_clause.at( l )];
+          if ( w == w_min )
+          {
+            garbage.push_back( l );
+          }
+          else
+          {
+            w -= w_min;
+          }
+
+          /* increase the bound of the sum */
+          auto& t = t_objects[l];
+          const auto b = bounds[l] + 1;
+          std::vector<std::vector<int>> clauses;
+          easy::sat2::increase_totalizer( clauses, _sid, t, b );
+          for ( auto const& c : clauses )
+          {
+            add_clause( c );
+          }
+
+          if ( static_cast<std::size_t>( b ) < t->vars.size() )
+          {
+            const auto lnew = -t->vars[b];
+            if ( const auto it = std::find( garbage.begin(), garbage.end(), lnew ); it != garbage.end() )
+            {
+              garbage.erase( it );
+              _weights[selector_to_clause[lnew]] = 0;
+            }
+
+            if ( selector_to_clause.find( lnew ) == selector_to_clause.end() )
+            {
+              t_objects.emplace( lnew, t );
+              bounds.emplace( lnew, b );
+              selector_to_clause.emplace( lnew, static_cast<int>( _weights.size() ) );
+              _weights.push_back( w_min );
+              sums.push_back( lnew );
+            }
+            else
+            {
+              _weights[selector_to_clause[lnew]] += w_min;
+            }
+          }
+
+          rels.push_back( -l );
+        }
+
+        if ( rels.size() > 1u )
+        {
+          /* new cardinality constraint over the relaxed literals */
+          std::vector<std::vector<int>> clauses;
+          auto tree = easy::sat2::create_totalizer( clauses, _sid, rels, 1u );
+          for ( auto const& c : clauses )
+          {
+            add_clause( c );
+          }
+
+          const auto lnew = -tree->vars[1];
+          t_objects.emplace( lnew, tree );
+          bounds.emplace( lnew, 1 );
+          selector_to_clause.emplace( lnew, static_cast<int>( _weights.size() ) );
+          _weights.push_back( w_min );
+          sums.push_back( lnew );
+        }
+      }
+      else
+      {
+        /* unit core */
+        add_clause( {-core_sels[0u]} );
+        garbage.push_back( core_sels[0u] );
+      }
+
+      const auto is_garbage = [&]( int l ) { return std::find( garbage.begin(), garbage.end(), l ) != garbage.end(); };
+      sels.erase( std::remove_if( sels.begin(), sels.end(), is_garbage ), sels.end() );
+      sums.erase( std::remove_if( sums.begin(), sums.end(), is_garbage ), sums.end() );
+    }
+
+    return _state = state::fail;
+  }
+
+  /*! \brief Model of the last call to `solve`, if it succeeded */
+  easy::sat2::model model() const
+  {
+    assert( _state == state::success );
+    return _solver.get_model();
+  }
+};
+
+} // namespace caterpillar
@@ -0,0 +1,47 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file sat_backend.hpp
+  \brief runtime selection of percy SAT solver wrappers
+*/
+
+#pragma once
+
+#include <percy/solvers/bmcg_sat.hpp>
+#include <percy/solvers/bsat2.hpp>
+
+namespace caterpillar
+{
+
+/*! \brief SAT solver used by the SAT-based algorithms */
+enum class sat_backend
+{
+  /*! \brief ABC's bsat solver (`percy::bsat_wrapper`) */
+  bsat,
+  /*! \brief Glucose as shipped with ABC (`percy::bmcg_wrapper`) */
+  glucose
+};
+
+/*! \brief Calls `fn` with a null pointer to the solver wrapper type of `backend`
+ *
+ * The solver type is obtained in `fn` with
+ * `std::remove_pointer_t<decltype( tag )>`.
+ */
+template<class Fn>
+decltype( auto ) dispatch_sat_backend( sat_backend backend, Fn&& fn )
+{
+  switch ( backend )
+  {
+  default:
+  case sat_backend::bsat:
+    return fn( static_cast<percy::bsat_wrapper*>( nullptr ) );
+  case sat_backend::glucose:
+    return fn( static_cast<percy::bmcg_wrapper*>( nullptr ) );
+  }
+}
+
+} // namespace caterpillar
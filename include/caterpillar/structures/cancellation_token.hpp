@@ -0,0 +1,95 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file cancellation_token.hpp
+  \brief shared deadline and cancellation flag for long-running algorithms
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace caterpillar
+{
+
+/*! \brief Cooperative cancellation with an optional wall-clock deadline
+ *
+ * Copies of a token share their state, such that a token that is passed to
+ * several algorithms can be cancelled for all of them at once, also from
+ * another thread.  Algorithms check the token between their expensive calls,
+ * e.g., SAT solver calls, and return the best result found so far.
+ *
+ * A default-constructed token is never cancelled.
+ */
+class cancellation_token
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  cancellation_token() = default;
+
+  /*! \brief Token that is only cancelled by `cancel` */
+  static cancellation_token make()
+  {
+    return cancellation_token( clock::time_point::max() );
+  }
+
+  /*! \brief Token that is cancelled after `timeout` or by `cancel` */
+  template<class Rep, class Period>
+  static cancellation_token with_timeout( std::chrono::duration<Rep, Period> const& timeout )
+  {
+    return cancellation_token( clock::now() + std::chrono::duration_cast<clock::duration>( timeout ) );
+  }
+
+  /*! \brief Cancels all copies of the token */
+  void cancel() const
+  {
+    if ( _state )
+    {
+      _state->cancelled = true;
+    }
+  }
+
+  /*! \brief Returns true, if the token was cancelled or its deadline has passed */
+  bool is_cancelled() const
+  {
+    if ( !_state )
+    {
+      return false;
+    }
+    if ( !_state->cancelled.load( std::memory_order_relaxed ) && clock::now() >= _state->deadline )
+    {
+      _state->cancelled = true;
+    }
+    return _state->cancelled.load( std::memory_order_relaxed );
+  }
+
+  /*! \brief Returns true, if the token can be cancelled at all */
+  bool is_cancellable() const
+  {
+    return _state != nullptr;
+  }
+
+private:
+  explicit cancellation_token( clock::time_point deadline )
+      : _state( std::make_shared<state>() )
+  {
+    _state->deadline = deadline;
+  }
+
+  struct state
+  {
+    std::atomic<bool> cancelled{false};
+    clock::time_point deadline;
+  };
+
+  std::shared_ptr<state> _state;
+};
+
+} // namespace caterpillar
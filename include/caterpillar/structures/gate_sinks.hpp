@@ -0,0 +1,711 @@
+/*-------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*------------------------------------------------------------------------------------------------*/
+
+/*!
+  \file gate_sinks.hpp
+  \brief gate sinks that can replace a netlist as target of synthesis
+
+  A gate sink is anything that `logic_network_synthesis` and the single-target
+  gate synthesis functions can append gates to.  It must implement the
+  following subset of the `tweedledum::netlist` interface:
+
+  - `num_qubits()`
+  - `add_qubit()`
+  - `add_gate( gate_base, qubit_id target )`
+  - `add_gate( gate_base, qubit_id control, qubit_id target )`
+  - `add_gate( gate_base, std::vector<qubit_id> controls, std::vector<qubit_id> targets )`
+
+  The sinks in this file do not store gates, their memory does not depend on
+  the size of the synthesized circuit.
+*/
+
+#pragma once
+
+#include <tweedledum/gates/gate_base.hpp>
+#include <tweedledum/gates/gate_set.hpp>
+#include <tweedledum/networks/qubit.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace caterpillar
+{
+
+namespace td = tweedledum;
+
+namespace detail
+{
+
+/*! \brief Buffered writer used by streaming sinks
+ *
+ * Data is collected in a buffer and flushed whenever it grows beyond
+ * `buffer_size`.  If the stream is seekable, the header is written first and
+ * patched when the sink is finalized.  Otherwise, the data is flushed into a
+ * temporary file, which is copied to the stream after the final header, such
+ * that the memory never exceeds the buffer.
+ */
+class buffered_sink_stream
+{
+public:
+  buffered_sink_stream( std::ostream& os, std::size_t buffer_size )
+      : os( os ), buffer_size( buffer_size )
+  {
+    const auto pos = os.tellp();
+    seekable = pos != std::ostream::pos_type( -1 );
+    if ( seekable )
+    {
+      header_pos = pos;
+    }
+    else if ( spool = std::tmpfile(); !spool )
+    {
+      throw std::runtime_error( "cannot create temporary file for non-seekable stream" );
+    }
+    buffer.reserve( buffer_size );
+  }
+
+  buffered_sink_stream( buffered_sink_stream const& ) = delete;
+  buffered_sink_stream& operator=( buffered_sink_stream const& ) = delete;
+
+  ~buffered_sink_stream()
+  {
+    if ( spool )
+    {
+      std::fclose( spool );
+    }
+  }
+
+  void write( char const* data, std::size_t size )
+  {
+    buffer.append( data, size );
+    if ( buffer.size() >= buffer_size )
+    {
+      flush();
+    }
+  }
+
+  void write( std::string const& data )
+  {
+    write( data.data(), data.size() );
+  }
+
+  /*! \brief Reserves `size` bytes for the header in front of the data. */
+  void reserve_header( std::size_t size )
+  {
+    header_size = size;
+    if ( seekable )
+    {
+      os << std::string( size, ' ' );
+    }
+  }
+
+  void finalize( std::string const& header )
+  {
+    assert( header.size() == header_size );
+    if ( seekable )
+    {
+      flush();
+      const auto end = os.tellp();
+      os.seekp( header_pos );
+      os.write( header.data(), header.size() );
+      os.seekp( end );
+    }
+    else
+    {
+      flush();
+      os.write( header.data(), header.size() );
+      std::rewind( spool );
+      buffer.resize( std::max<std::size_t>( buffer_size, 1u ) );
+      while ( const auto size = std::fread( &buffer[0], 1u, buffer.size(), spool ) )
+      {
+        os.write( buffer.data(), size );
+      }
+      buffer.clear();
+      std::fclose( spool );
+      spool = nullptr;
+    }
+    os.flush();
+  }
+
+private:
+  void flush()
+  {
+    if ( spool )
+    {
+      if ( std::fwrite( buffer.data(), 1u, buffer.size(), spool ) != buffer.size() )
+      {
+        throw std::runtime_error( "cannot write temporary file for non-seekable stream" );
+      }
+    }
+    else
+    {
+      os.write( buffer.data(), buffer.size() );
+    }
+    buffer.clear();
+  }
+
+private:
+  std::ostream& os;
+  std::size_t buffer_size;
+  std::string buffer;
+  bool seekable{false};
+  std::FILE* spool{nullptr};
+  std::ostream::pos_type header_pos{0};
+  std::size_t header_size{0u};
+};
+
+} // namespace detail
+
+/*! \brief Gate sink that only counts resources
+ *
+ * Counts qubits and gates by type.  The T-count of multiple-controlled Toffoli
+ * gates is estimated with the same cost model as `detail::t_cost`, based on
+ * the number of qubits at the time the gate is added.
+ */
+class resource_counting_sink
+{
+public:
+  uint32_t num_qubits() const
+  {
+    return _num_qubits;
+  }
+
+  td::qubit_id add_qubit()
+  {
+    return td::qubit_id( _num_qubits++ );
+  }
+
+  void add_gate( td::gate_base op, td::qubit_id target )
+  {
+    (void)target;
+    count( op, 0u );
+  }
+
+  void add_gate( td::gate_base op, td::qubit_id control, td::qubit_id target )
+  {
+    (void)control;
+    (void)target;
+    count( op, 1u );
+  }
+
+  void add_gate( td::gate_base op, std::vector<td::qubit_id> const& controls, std::vector<td::qubit_id> const& targets )
+  {
+    for ( auto i = 0u; i < targets.size(); ++i )
+    {
+      count( op, static_cast<uint32_t>( controls.size() ) );
+    }
+  }
+
+  /*! \brief Number of gates. */
+  uint64_t num_gates() const
+  {
+    return _num_gates;
+  }
+
+  /*! \brief Number of NOT gates (including MCX gates without controls). */
+  uint64_t num_not() const
+  {
+    return _num_not;
+  }
+
+  /*! \brief Number of CNOT gates (including MCX gates with one control). */
+  uint64_t num_cnot() const
+  {
+    return _num_cnot;
+  }
+
+  /*! \brief Number of MCX gates with at least two controls. */
+  uint64_t num_mcx() const
+  {
+    return _num_mcx;
+  }
+
+  /*! \brief Number of T gates, including estimated T-count of MCX gates. */
+  uint64_t t_count() const
+  {
+    return _t_count;
+  }
+
+  void report( std::ostream& os = std::cout ) const
+  {
+    os << fmt::format( "[i] qubits = {}   gates = {}   NOT = {}   CNOT = {}   MCX = {}   T-count = {}\n",
+                       _num_qubits, _num_gates, _num_not, _num_cnot, _num_mcx, _t_count );
+  }
+
+private:
+  static uint64_t mcx_t_cost( uint32_t controls, uint32_t lines )
+  {
+    switch ( controls )
+    {
+    case 0u:
+    case 1u:
+      return 0u;
+    case 2u:
+      return 7u;
+    case 3u:
+      return 16u;
+    default:
+      return ( lines - controls - 1 >= ( controls - 1 ) / 2 ) ? 8u * ( controls - 1 ) : 16u * ( controls - 1 );
+    }
+  }
+
+  void count( td::gate_base op, uint32_t num_controls )
+  {
+    ++_num_gates;
+    switch ( op.operation() )
+    {
+    default:
+      break;
+    case td::gate_set::pauli_x:
+      ++_num_not;
+      break;
+    case td::gate_set::cx:
+      ++_num_cnot;
+      break;
+    case td::gate_set::t:
+    case td::gate_set::t_dagger:
+      ++_t_count;
+      break;
+    case td::gate_set::mcx:
+      if ( num_controls == 0u )
+        ++_num_not;
+      else if ( num_controls == 1u )
+        ++_num_cnot;
+      else
+        ++_num_mcx;
+      _t_count += mcx_t_cost( num_controls, _num_qubits );
+      break;
+    }
+  }
+
+private:
+  uint32_t _num_qubits{0u};
+  uint64_t _num_gates{0u};
+  uint64_t _num_not{0u};
+  uint64_t _num_cnot{0u};
+  uint64_t _num_mcx{0u};
+  uint64_t _t_count{0u};
+};
+
+/*! \brief Gate sink that writes OPENQASM 2.0 into a stream
+ *
+ * The output is the same as `tweedledum::write_qasm` for the written network,
+ * except for padding in the header which allows to fix the number of qubits
+ * once all gates have been written, and for MCX gates with more than two
+ * controls, which `write_qasm` does not support.  These are decomposed into
+ * Toffoli gates that borrow other qubits of the circuit in any state (Barenco
+ * et al., Lemmas 7.2 and 7.3), which needs `4(n - 2)` Toffoli gates for `n`
+ * controls and `n - 2` borrowed qubits, or about twice as many with a single
+ * borrowed qubit.  If no qubit can be borrowed, gates with at most
+ * `max_controls_without_borrowing` controls are written as Hadamard gates
+ * around a multiple-controlled Z gate, which is expanded into `u1` rotations
+ * of all parities of its qubits.  Gates that cannot be written throw
+ * `std::invalid_argument`.  Call `finalize` after synthesis to complete the
+ * file; the destructor finalizes as well, but ignores errors.
+ */
+class qasm_gate_sink
+{
+public:
+  /*! \brief Largest MCX gate written as phase polynomial with `2^(n + 1) - 1` rotations */
+  static constexpr uint32_t max_controls_without_borrowing = 4u;
+
+  explicit qasm_gate_sink( std::ostream& os, std::size_t buffer_size = 1u << 16 )
+      : stream( os, buffer_size )
+  {
+    stream.reserve_header( header( 0u ).size() );
+  }
+
+  ~qasm_gate_sink()
+  {
+    try
+    {
+      finalize();
+    }
+    catch ( ... )
+    {
+    }
+  }
+
+  uint32_t num_qubits() const
+  {
+    return _num_qubits;
+  }
+
+  td::qubit_id add_qubit()
+  {
+    return td::qubit_id( _num_qubits++ );
+  }
+
+  void add_gate( td::gate_base op, td::qubit_id target )
+  {
+    write_gate( op, std::array<td::qubit_id, 0>{}, std::array<td::qubit_id, 1>{target} );
+  }
+
+  void add_gate( td::gate_base op, td::qubit_id control, td::qubit_id target )
+  {
+    write_gate( op, std::array<td::qubit_id, 1>{control}, std::array<td::qubit_id, 1>{target} );
+  }
+
+  void add_gate( td::gate_base op, std::vector<td::qubit_id> const& controls, std::vector<td::qubit_id> const& targets )
+  {
+    write_gate( op, controls, targets );
+  }
+
+  /*! \brief Writes the remaining buffer and the final header. */
+  void finalize()
+  {
+    if ( finalized )
+      return;
+    finalized = true;
+    stream.finalize( header( _num_qubits ) );
+  }
+
+private:
+  static std::string header( uint32_t num_qubits )
+  {
+    /* qubit numbers are padded to 10 digits, the maximum of a 32-bit integer */
+    return fmt::format( "OPENQASM 2.0;\ninclude \"qelib1.inc\";\nqreg q[{0}]{1};\ncreg c[{0}]{1};\n",
+                        num_qubits, std::string( 10u - fmt::format( "{}", num_qubits ).size(), ' ' ) );
+  }
+
+  template<class Controls, class Targets>
+  void write_gate( td::gate_base op, Controls const& controls, Targets const& targets )
+  {
+    switch ( op.operation() )
+    {
+    default:
+      throw std::invalid_argument( "qasm_gate_sink: unsupported gate type" );
+
+    case td::gate_set::hadamard:
+      write_single( "h", targets );
+      break;
+    case td::gate_set::pauli_x:
+      write_single( "x", targets );
+      break;
+    case td::gate_set::pauli_z:
+      write_single( "z", targets );
+      break;
+    case td::gate_set::phase:
+      write_single( "s", targets );
+      break;
+    case td::gate_set::phase_dagger:
+      write_single( "sdg", targets );
+      break;
+    case td::gate_set::t:
+      write_single( "t", targets );
+      break;
+    case td::gate_set::t_dagger:
+      write_single( "tdg", targets );
+      break;
+    case td::gate_set::rotation_z:
+      write_single( fmt::format( "rz({})", op.rotation_angle().numeric_value() ), targets );
+      break;
+    case td::gate_set::rotation_y:
+      write_single( fmt::format( "ry({})", op.rotation_angle().numeric_value() ), targets );
+      break;
+    case td::gate_set::rotation_x:
+      write_single( fmt::format( "rx({})", op.rotation_angle().numeric_value() ), targets );
+      break;
+
+    case td::gate_set::cx:
+      for ( auto c : controls )
+      {
+        if ( c.is_complemented() )
+          stream.write( fmt::format( "x q[{}];\n", c.index() ) );
+        for ( auto t : targets )
+          write_cx( c.index(), t.index() );
+        if ( c.is_complemented() )
+          stream.write( fmt::format( "x q[{}];\n", c.index() ) );
+      }
+      break;
+
+    case td::gate_set::mcx:
+      for ( auto c : controls )
+      {
+        if ( c.is_complemented() )
+          stream.write( fmt::format( "x q[{}];\n", c.index() ) );
+      }
+      switch ( controls.size() )
+      {
+      case 0u:
+        write_single( "x", targets );
+        break;
+      case 1u:
+        for ( auto t : targets )
+          write_cx( controls[0].index(), t.index() );
+        break;
+      default:
+        for ( auto i = 1u; i < targets.size(); ++i )
+          write_cx( targets[0].index(), targets[i].index() );
+        if ( controls.size() == 2u )
+        {
+          write_ccx( controls[0].index(), controls[1].index(), targets[0].index() );
+        }
+        else
+        {
+          std::vector<uint32_t> qubits;
+          for ( auto c : controls )
+            qubits.push_back( c.index() );
+          write_mcx( qubits, targets[0].index() );
+        }
+        for ( auto i = 1u; i < targets.size(); ++i )
+          write_cx( targets[0].index(), targets[i].index() );
+        break;
+      }
+      for ( auto c : controls )
+      {
+        if ( c.is_complemented() )
+          stream.write( fmt::format( "x q[{}];\n", c.index() ) );
+      }
+      break;
+    }
+  }
+
+  void write_cx( uint32_t control, uint32_t target )
+  {
+    stream.write( fmt::format( "cx q[{}], q[{}];\n", control, target ) );
+  }
+
+  void write_ccx( uint32_t control0, uint32_t control1, uint32_t target )
+  {
+    stream.write( fmt::format( "ccx q[{}], q[{}], q[{}];\n", control0, control1, target ) );
+  }
+
+  /* up to count qubits of the circuit that are not controls or target */
+  std::vector<uint32_t> borrowable_qubits( std::vector<uint32_t> const& controls, uint32_t target, uint32_t count ) const
+  {
+    std::vector<uint32_t> qubits;
+    for ( auto q = 0u; q < _num_qubits && qubits.size() < count; ++q )
+    {
+      if ( q != target && std::find( controls.begin(), controls.end(), q ) == controls.end() )
+        qubits.push_back( q );
+    }
+    return qubits;
+  }
+
+  void write_mcx( std::vector<uint32_t> const& controls, uint32_t target )
+  {
+    const auto n = static_cast<uint32_t>( controls.size() );
+    if ( n == 1u )
+    {
+      write_cx( controls[0], target );
+      return;
+    }
+    if ( n == 2u )
+    {
+      write_ccx( controls[0], controls[1], target );
+      return;
+    }
+
+    const auto borrowed = borrowable_qubits( controls, target, n - 2u );
+    if ( borrowed.size() == n - 2u )
+    {
+      write_mcx_borrowed( controls, target, borrowed );
+    }
+    else if ( !borrowed.empty() )
+    {
+      /* the first half of the controls is computed into the borrowed qubit, which controls the target with the second half */
+      const auto k = ( n + 1u ) / 2u;
+      std::vector<uint32_t> first( controls.begin(), controls.begin() + k );
+      std::vector<uint32_t> second( controls.begin() + k, controls.end() );
+      second.push_back( borrowed.front() );
+      for ( auto i = 0u; i < 2u; ++i )
+      {
+        write_mcx( first, borrowed.front() );
+        write_mcx( second, target );
+      }
+    }
+    else if ( n <= max_controls_without_borrowing )
+    {
+      write_mcx_phases( controls, target );
+    }
+    else
+    {
+      throw std::invalid_argument( "qasm_gate_sink: too many controls and no qubit to borrow" );
+    }
+  }
+
+  /* the borrowed qubits b[i] accumulate the products of the first i + 2 controls, each product is toggled twice */
+  void write_mcx_borrowed( std::vector<uint32_t> const& controls, uint32_t target, std::vector<uint32_t> const& borrowed )
+  {
+    const auto n = static_cast<uint32_t>( controls.size() );
+    for ( auto round = 0u; round < 2u; ++round )
+    {
+      write_ccx( controls[n - 1u], borrowed[n - 3u], target );
+      for ( auto i = n - 2u; i >= 2u; --i )
+        write_ccx( controls[i], borrowed[i - 2u], borrowed[i - 1u] );
+      write_ccx( controls[0], controls[1], borrowed[0] );
+      for ( auto i = 2u; i <= n - 2u; ++i )
+        write_ccx( controls[i], borrowed[i - 2u], borrowed[i - 1u] );
+    }
+  }
+
+  /* the product of m qubits is the sum over all non-empty subsets S of (-1)^(|S| - 1) parity(S) / 2^(m - 1) */
+  void write_mcx_phases( std::vector<uint32_t> const& controls, uint32_t target )
+  {
+    std::vector<uint32_t> qubits( controls );
+    qubits.push_back( target );
+    const auto m = static_cast<uint32_t>( qubits.size() );
+
+    stream.write( fmt::format( "h q[{}];\n", target ) );
+    for ( auto subset = 1u; subset < ( 1u << m ); ++subset )
+    {
+      /* parity is computed into the last qubit of the subset */
+      const auto last = 31u - __builtin_clz( subset );
+      for ( auto i = 0u; i < last; ++i )
+        if ( ( subset >> i ) & 1u )
+          write_cx( qubits[i], qubits[last] );
+      stream.write( fmt::format( "u1({}pi/{}) q[{}];\n", __builtin_popcount( subset ) % 2u ? "" : "-", 1u << ( m - 1u ), qubits[last] ) );
+      for ( auto i = last; i-- > 0u; )
+        if ( ( subset >> i ) & 1u )
+          write_cx( qubits[i], qubits[last] );
+    }
+    stream.write( fmt::format( "h q[{}];\n", target ) );
+  }
+
+  template<class Targets>
+  void write_single( std::string const& name, Targets const& targets )
+  {
+    for ( auto t : targets )
+    {
+      stream.write( fmt::format( "{} q[{}];\n", name, t.index() ) );
+    }
+  }
+
+private:
+  detail::buffered_sink_stream stream;
+  uint32_t _num_qubits{0u};
+  bool finalized{false};
+};
+
+/*! \brief Gate sink that writes a compact binary format into a stream
+ *
+ * The stream starts with the magic string `CTPB`, followed by the format
+ * version, the number of qubits (uint32) and the number of gates (uint64).
+ * Each gate is written as its operation (uint8), the number of controls
+ * (uint8), the number of targets (uint8), followed by the qubit literals
+ * (uint32, `index << 1 | complemented`) of the controls and targets.  Gates
+ * with a rotation angle are followed by the angle (double).  All numbers are
+ * written in the byte order of the host.  Gates with more than 255 controls or
+ * targets throw `std::invalid_argument`.  Call `finalize` after synthesis to
+ * complete the file; the destructor finalizes as well, but ignores errors.
+ */
+class binary_gate_sink
+{
+public:
+  static constexpr uint32_t version = 1u;
+
+  explicit binary_gate_sink( std::ostream& os, std::size_t buffer_size = 1u << 16 )
+      : stream( os, buffer_size )
+  {
+    stream.reserve_header( header().size() );
+  }
+
+  ~binary_gate_sink()
+  {
+    try
+    {
+      finalize();
+    }
+    catch ( ... )
+    {
+    }
+  }
+
+  uint32_t num_qubits() const
+  {
+    return _num_qubits;
+  }
+
+  uint64_t num_gates() const
+  {
+    return _num_gates;
+  }
+
+  td::qubit_id add_qubit()
+  {
+    return td::qubit_id( _num_qubits++ );
+  }
+
+  void add_gate( td::gate_base op, td::qubit_id target )
+  {
+    write_gate( op, std::array<td::qubit_id, 0>{}, std::array<td::qubit_id, 1>{target} );
+  }
+
+  void add_gate( td::gate_base op, td::qubit_id control, td::qubit_id target )
+  {
+    write_gate( op, std::array<td::qubit_id, 1>{control}, std::array<td::qubit_id, 1>{target} );
+  }
+
+  void add_gate( td::gate_base op, std::vector<td::qubit_id> const& controls, std::vector<td::qubit_id> const& targets )
+  {
+    write_gate( op, controls, targets );
+  }
+
+  /*! \brief Writes the remaining buffer and the final header. */
+  void finalize()
+  {
+    if ( finalized )
+      return;
+    finalized = true;
+    stream.finalize( header() );
+  }
+
+private:
+  std::string header() const
+  {
+    std::string h( "CTPB" );
+    append( h, version );
+    append( h, _num_qubits );
+    append( h, _num_gates );
+    return h;
+  }
+
+  template<typename T>
+  static void append( std::string& s, T value )
+  {
+    s.append( reinterpret_cast<char const*>( &value ), sizeof( T ) );
+  }
+
+  template<class Controls, class Targets>
+  void write_gate( td::gate_base op, Controls const& controls, Targets const& targets )
+  {
+    if ( controls.size() > 255u || targets.size() > 255u )
+      throw std::invalid_argument( "binary_gate_sink: more than 255 controls or targets" );
+
+    record.clear();
+    append( record, static_cast<uint8_t>( op.operation() ) );
+    append( record, static_cast<uint8_t>( controls.size() ) );
+    append( record, static_cast<uint8_t>( targets.size() ) );
+    for ( auto c : controls )
+      append( record, c.literal() );
+    for ( auto t : targets )
+      append( record, td::qubit_id( t.index() ).literal() );
+    if ( op.is_one_of( td::gate_set::rotation_x, td::gate_set::rotation_y, td::gate_set::rotation_z ) )
+      append( record, static_cast<double>( op.rotation_angle().numeric_value() ) );
+
+    stream.write( record );
+    ++_num_gates;
+  }
+
+private:
+  detail::buffered_sink_stream stream;
+  std::string record;
+  uint32_t _num_qubits{0u};
+  uint64_t _num_gates{0u};
+  bool finalized{false};
+};
+
+} // namespace caterpillar
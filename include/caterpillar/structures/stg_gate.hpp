@@ -10,7 +10,16 @@
 
 #include <kitty/constructors.hpp>
 #include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace caterpillar
@@ -18,46 +27,329 @@ namespace caterpillar
 
 namespace td = tweedledum;
 
-/*! 
+/*! \brief Non-owning view of a contiguous sequence of qubits. */
+class qubit_span
+{
+public:
+  qubit_span( td::qubit_id const* data, uint32_t size )
+      : _data( data ), _size( size )
+  {
+  }
+
+  td::qubit_id const* begin() const
+  {
+    return _data;
+  }
+
+  td::qubit_id const* end() const
+  {
+    return _data + _size;
+  }
+
+  uint32_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0u;
+  }
+
+  td::qubit_id operator[]( uint32_t i ) const
+  {
+    assert( i < _size );
+    return _data[i];
+  }
+
+  /*! \brief Copies the qubits into a vector. */
+  std::vector<td::qubit_id> to_vector() const
+  {
+    return std::vector<td::qubit_id>( begin(), end() );
+  }
+
+private:
+  td::qubit_id const* _data;
+  uint32_t _size;
+};
+
+/*! \brief Interned control functions of single-target gates
+ *
+ * Each distinct truth table is stored once and referenced by a 32-bit id.  The
+ * id 0 is reserved for gates without control function.
+ *
+ * Ids are reference counted: `intern` and `acquire` take a reference,
+ * `release` drops it.  Gates and packed strategy steps hold one reference per
+ * function they refer to, such that a function is removed when the last gate
+ * or step that uses it is destroyed, and its id is reused by a later
+ * function.  The store therefore only holds the functions of live gates and
+ * steps.
+ *
+ * Functions are stored in chunks of doubling size that are never moved, such
+ * that references stay valid while new functions are added.  Interning and
+ * releasing the last reference take a lock, but reading a function by id and
+ * copying a reference do not: the chunk pointers and the size are atomic and
+ * published after the function has been stored, and a function is never
+ * removed while it is referenced.
+ */
+class stg_function_store
+{
+public:
+  static constexpr uint32_t no_function = 0u;
+
+  static stg_function_store& instance()
+  {
+    static stg_function_store store;
+    return store;
+  }
+
+  stg_function_store( stg_function_store const& ) = delete;
+  stg_function_store& operator=( stg_function_store const& ) = delete;
+
+  ~stg_function_store()
+  {
+    for ( auto& chunk : chunks )
+    {
+      delete[] chunk.load( std::memory_order_relaxed );
+    }
+  }
+
+  /*! \brief Returns the id of `function` and takes a reference to it. */
+  uint32_t intern( kitty::dynamic_truth_table const& function )
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    if ( const auto it = ids.find( function ); it != ids.end() )
+    {
+      entry_at( it->second ).references.fetch_add( 1u, std::memory_order_relaxed );
+      return it->second;
+    }
+
+    uint32_t id;
+    if ( !free_ids.empty() )
+    {
+      id = free_ids.back();
+      free_ids.pop_back();
+    }
+    else
+    {
+      id = _size.load( std::memory_order_relaxed );
+      allocate( id );
+    }
+    auto& e = entry_at( id );
+    e.function = function;
+    e.references.store( 1u, std::memory_order_relaxed );
+    ids.emplace( function, id );
+    _size.store( std::max( _size.load( std::memory_order_relaxed ), id + 1u ), std::memory_order_release );
+    return id;
+  }
+
+  /*! \brief Takes another reference to an id that is already referenced. */
+  void acquire( uint32_t id )
+  {
+    if ( id != no_function )
+    {
+      assert( entry_at( id ).references.load( std::memory_order_relaxed ) > 0u );
+      entry_at( id ).references.fetch_add( 1u, std::memory_order_relaxed );
+    }
+  }
+
+  /*! \brief Drops a reference and removes the function with its last reference. */
+  void release( uint32_t id )
+  {
+    if ( id == no_function )
+    {
+      return;
+    }
+
+    /* only the last reference takes the lock, such that it cannot race with interning the same function */
+    auto& references = entry_at( id ).references;
+    auto count = references.load( std::memory_order_relaxed );
+    while ( count > 1u )
+    {
+      if ( references.compare_exchange_weak( count, count - 1u, std::memory_order_release, std::memory_order_relaxed ) )
+      {
+        return;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock( mutex );
+    if ( references.fetch_sub( 1u, std::memory_order_acq_rel ) == 1u )
+    {
+      auto& e = entry_at( id );
+      ids.erase( e.function );
+      e.function = kitty::dynamic_truth_table();
+      free_ids.push_back( id );
+    }
+  }
+
+  kitty::dynamic_truth_table const& operator[]( uint32_t id ) const
+  {
+    assert( id < size() );
+    return entry_at( id ).function;
+  }
+
+  /*! \brief Returns an upper bound on the ids in use. */
+  uint32_t size() const
+  {
+    return _size.load( std::memory_order_acquire );
+  }
+
+  /*! \brief Returns the number of referenced functions. */
+  uint32_t num_functions()
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    return static_cast<uint32_t>( ids.size() );
+  }
+
+private:
+  struct entry
+  {
+    kitty::dynamic_truth_table function;
+    std::atomic<uint32_t> references{0u};
+  };
+
+  /* chunk k holds the ids from (2^k - 1) * first_chunk_size */
+  static constexpr uint32_t log_first_chunk_size = 10u;
+  static constexpr uint32_t num_chunks = 32u - log_first_chunk_size;
+
+  static std::pair<uint32_t, uint32_t> locate( uint32_t id )
+  {
+    const auto chunk = 31u - __builtin_clz( ( id >> log_first_chunk_size ) + 1u );
+    return {chunk, id - ( ( ( 1u << chunk ) - 1u ) << log_first_chunk_size )};
+  }
+
+  stg_function_store()
+  {
+    /* reserve id 0 for no function */
+    allocate( no_function );
+    _size.store( 1u, std::memory_order_release );
+  }
+
+  entry& entry_at( uint32_t id ) const
+  {
+    const auto [chunk, offset] = locate( id );
+    return chunks[chunk].load( std::memory_order_acquire )[offset];
+  }
+
+  void allocate( uint32_t id )
+  {
+    const auto [chunk, offset] = locate( id );
+    (void)offset;
+    if ( !chunks[chunk].load( std::memory_order_relaxed ) )
+    {
+      chunks[chunk].store( new entry[std::size_t( 1u ) << ( log_first_chunk_size + chunk )], std::memory_order_release );
+    }
+  }
+
+private:
+  std::mutex mutex;
+  std::array<std::atomic<entry*>, num_chunks> chunks{};
+  std::atomic<uint32_t> _size{0u};
+  std::unordered_map<kitty::dynamic_truth_table, uint32_t, kitty::hash<kitty::dynamic_truth_table>> ids;
+  std::vector<uint32_t> free_ids;
+};
+
+/*!
   A single-target gate is a reversible gate characterized by:
-  `_function` a control function,
-  `_controls` a list of control qubits,
-  `_targets` a list of target qubits.
-  
+  a control function,
+  a list of control qubits,
+  a list of target qubits.
+
   X gates are applied to the targets whenever the control function evaluates to true.
+
+  The gate is compact: the control function is interned in `stg_function_store`
+  and referenced by id, which the gate holds a reference to, and up to `max_inline_qubits` controls and targets are
+  stored inside the gate without heap allocation.
 */
 class stg_gate : public td::gate_base
 {
-
 public:
+  /*! \brief Number of qubits (controls and targets) stored without heap allocation */
+  static constexpr uint32_t max_inline_qubits = 6u;
+
   stg_gate( gate_base const& op, td::qubit_id target )
-    : td::gate_base( op )
+      : td::gate_base( op )
   {
     assert( is_single_qubit() );
-    _targets.push_back( target );
+    td::qubit_id* qs = allocate( 0u, 1u );
+    qs[0] = target;
   }
 
   stg_gate( gate_base const& op, td::qubit_id control, td::qubit_id target )
       : gate_base( op )
   {
     assert( is_double_qubit() );
-    _controls.push_back( control );
-    _targets.push_back( target );
+    td::qubit_id* qs = allocate( 1u, 1u );
+    qs[0] = control;
+    qs[1] = target;
   }
 
   stg_gate( gate_base const& op, std::vector<td::qubit_id> const& controls, std::vector<td::qubit_id> const& targets )
-      : td::gate_base( op ),
-        _controls( controls ),
-        _targets( targets )
+      : td::gate_base( op )
   {
+    td::qubit_id* qs = allocate( static_cast<uint32_t>( controls.size() ), static_cast<uint32_t>( targets.size() ) );
+    std::copy( targets.begin(), targets.end(), std::copy( controls.begin(), controls.end(), qs ) );
   }
 
   stg_gate( kitty::dynamic_truth_table const& function, std::vector<td::qubit_id> const& controls, td::qubit_id target )
       : gate_base( td::gate_set::num_defined_ops ),
-        _function( function ),
-        _controls( controls )
+        _function_id( stg_function_store::instance().intern( function ) )
+  {
+    td::qubit_id* qs = allocate( static_cast<uint32_t>( controls.size() ), 1u );
+    *std::copy( controls.begin(), controls.end(), qs ) = target;
+  }
+
+  stg_gate( stg_gate const& other )
+      : td::gate_base( other ),
+        _function_id( other._function_id )
+  {
+    stg_function_store::instance().acquire( _function_id );
+    std::copy( other.qubits(), other.qubits() + other.num_qubits(), allocate( other._num_controls, other._num_targets ) );
+  }
+
+  stg_gate( stg_gate&& other ) noexcept
+      : td::gate_base( other ),
+        _function_id( other._function_id ),
+        _num_controls( other._num_controls ),
+        _num_targets( other._num_targets ),
+        _storage( other._storage )
+  {
+    other._function_id = stg_function_store::no_function;
+    other._num_controls = other._num_targets = 0u;
+  }
+
+  stg_gate& operator=( stg_gate const& other )
+  {
+    /* copy first, such that this gate is unchanged if the allocation throws */
+    if ( this != &other )
+    {
+      stg_gate copy( other );
+      *this = std::move( copy );
+    }
+    return *this;
+  }
+
+  stg_gate& operator=( stg_gate&& other ) noexcept
   {
-    _targets.push_back( target );
+    if ( this != &other )
+    {
+      release();
+      stg_function_store::instance().release( _function_id );
+      td::gate_base::operator=( other );
+      _function_id = other._function_id;
+      _num_controls = other._num_controls;
+      _num_targets = other._num_targets;
+      _storage = other._storage;
+      other._function_id = stg_function_store::no_function;
+      other._num_controls = other._num_targets = 0u;
+    }
+    return *this;
+  }
+
+  ~stg_gate()
+  {
+    release();
+    stg_function_store::instance().release( _function_id );
   }
 
   bool is_unitary_gate() const
@@ -67,28 +359,46 @@ public:
 
   uint32_t num_controls() const
   {
-    return _controls.size();
+    return _num_controls;
   }
 
   uint32_t num_targets() const
   {
-    return _targets.size();
+    return _num_targets;
   }
 
-  auto controls() const
+  qubit_span controls() const
   {
-    return _controls;
+    return qubit_span( qubits(), _num_controls );
   }
 
-  auto targets() const
+  qubit_span targets() const
   {
-    return _targets;
+    return qubit_span( qubits() + _num_controls, _num_targets );
+  }
+
+  /*! \brief Returns true, if the gate has a control function. */
+  bool has_function() const
+  {
+    return _function_id != stg_function_store::no_function;
+  }
+
+  /*! \brief Returns the id of the control function in `stg_function_store`. */
+  uint32_t function_id() const
+  {
+    return _function_id;
+  }
+
+  /*! \brief Returns the control function. */
+  kitty::dynamic_truth_table const& function() const
+  {
+    return stg_function_store::instance()[_function_id];
   }
 
   template<typename Fn>
   void foreach_control( Fn&& fn ) const
   {
-    for ( auto c : _controls )
+    for ( auto c : controls() )
     {
       fn( c );
     }
@@ -97,21 +407,69 @@ public:
   template<typename Fn>
   void foreach_target( Fn&& fn ) const
   {
-    for ( auto t : _targets )
+    for ( auto t : targets() )
     {
       fn( t );
     }
   }
 
 private:
-  /*! \brief control function of a single-target gate */
-  kitty::dynamic_truth_table _function;
+  uint32_t num_qubits() const
+  {
+    return static_cast<uint32_t>( _num_controls ) + _num_targets;
+  }
+
+  bool is_inline() const
+  {
+    return num_qubits() <= max_inline_qubits;
+  }
 
-  /*! \brief set control qubits in the network. */
-  std::vector<td::qubit_id> _controls{};
+  td::qubit_id const* qubits() const
+  {
+    return is_inline() ? _storage.inline_qubits : _storage.heap_qubits;
+  }
+
+  td::qubit_id* allocate( uint32_t num_controls, uint32_t num_targets )
+  {
+    assert( num_controls <= 0xffff && num_targets <= 0xffff );
+    assert( _num_controls == 0u && _num_targets == 0u );
+
+    /* the sizes are only set after a successful allocation, such that the gate stays inline if it throws */
+    const auto num_qubits = num_controls + num_targets;
+    td::qubit_id* qs = num_qubits <= max_inline_qubits ? _storage.inline_qubits : new td::qubit_id[num_qubits];
+    if ( qs != _storage.inline_qubits )
+    {
+      _storage.heap_qubits = qs;
+    }
+    _num_controls = static_cast<uint16_t>( num_controls );
+    _num_targets = static_cast<uint16_t>( num_targets );
+    return qs;
+  }
+
+  void release()
+  {
+    if ( !is_inline() )
+    {
+      delete[] _storage.heap_qubits;
+    }
+    _num_controls = _num_targets = 0u;
+  }
+
+private:
+  /*! \brief id of control function in `stg_function_store` */
+  uint32_t _function_id{stg_function_store::no_function};
+
+  uint16_t _num_controls{0u};
+  uint16_t _num_targets{0u};
+
+  /*! \brief control qubits followed by target qubits */
+  union storage
+  {
+    storage() {}
 
-  /*! \brief set of target qubits in the network. */
-  std::vector<td::qubit_id> _targets{};
+    td::qubit_id inline_qubits[max_inline_qubits];
+    td::qubit_id* heap_qubits;
+  } _storage;
 };
 
 } // namespace caterpillar
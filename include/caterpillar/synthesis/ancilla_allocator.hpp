@@ -0,0 +1,293 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken and Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file ancilla_allocator.hpp
+  \brief policies to assign ancilla qubits during synthesis
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <stack>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace caterpillar
+{
+
+/*! \brief Policy to choose a free ancilla qubit.
+ *
+ * All policies require the same number of qubits, which is the maximum
+ * number of simultaneously live ancillae.  They differ in which free qubit
+ * is chosen.
+ */
+enum class ancilla_allocation
+{
+  /*! \brief Most recently released qubit. */
+  lifo,
+  /*! \brief Least recently released qubit. */
+  fifo,
+  /*! \brief Free qubit with the smallest index. */
+  lowest_index,
+  /*! \brief Qubits are assigned ahead of synthesis by coloring the lifetime
+   *         intervals of all computed nodes, such that long-lived values
+   *         occupy the low qubits (see `plan`). */
+  interval_coloring
+};
+
+namespace detail
+{
+
+/*! \brief Assigns ancilla qubits according to an `ancilla_allocation` policy.
+ *
+ * Qubits are requested with a function that creates a new qubit, which is
+ * called whenever no free qubit can be reused.
+ */
+class ancilla_allocator
+{
+public:
+  /*! \brief A lifetime interval in steps, `end` is `infinite` if the value is never released. */
+  using interval_t = std::pair<uint32_t, uint32_t>;
+  static constexpr uint32_t infinite = std::numeric_limits<uint32_t>::max();
+
+  explicit ancilla_allocator( ancilla_allocation policy )
+      : policy( policy )
+  {
+  }
+
+  /*! \brief Plans the qubits of all requests ahead of time.
+   *
+   * `intervals` contains the lifetime of each request, in the order of the
+   * requests, i.e., sorted by start.  Two colorings with the minimum number
+   * of colors are considered: the left-edge algorithm with the free color of
+   * smallest index, and first fit by decreasing length, which places values
+   * that are never released or live long on the low qubits and fills the
+   * gaps above them with short values.  The latter is discarded if it needs
+   * more colors.  Qubits are created in the order of the colors, and the
+   * coloring with fewer free qubits below the highest live qubit is used.
+   * Returns the number of colors.  Requests that exceed the plan use the
+   * free qubit with the smallest index.
+   */
+  uint32_t plan( std::vector<interval_t> const& intervals )
+  {
+    next_request = 0u;
+    color_to_qubit.clear();
+
+    std::vector<uint32_t> by_length;
+    const auto num_colors = color_left_edge( intervals, planned_colors );
+    if ( color_by_length( intervals, by_length ) == num_colors && count_holes( intervals, by_length ) < count_holes( intervals, planned_colors ) )
+    {
+      planned_colors = std::move( by_length );
+    }
+    return num_colors;
+  }
+
+  template<class NewQubitFn>
+  uint32_t request( NewQubitFn&& new_qubit )
+  {
+    if ( policy == ancilla_allocation::interval_coloring && next_request < planned_colors.size() )
+    {
+      /* qubits are created in the order of their colors, such that low colors are low qubits */
+      const auto color = planned_colors[next_request++];
+      while ( color_to_qubit.size() <= color )
+      {
+        color_to_qubit.push_back( new_qubit() );
+      }
+      const auto q = color_to_qubit[color];
+      free_set.erase( q );
+      return q;
+    }
+
+    switch ( policy )
+    {
+    case ancilla_allocation::lifo:
+      if ( !free_stack.empty() )
+      {
+        const auto q = free_stack.top();
+        free_stack.pop();
+        return q;
+      }
+      break;
+    case ancilla_allocation::fifo:
+      if ( !free_queue.empty() )
+      {
+        const auto q = free_queue.front();
+        free_queue.pop_front();
+        return q;
+      }
+      break;
+    case ancilla_allocation::lowest_index:
+    case ancilla_allocation::interval_coloring:
+      if ( !free_set.empty() )
+      {
+        const auto q = *free_set.begin();
+        free_set.erase( free_set.begin() );
+        return q;
+      }
+      break;
+    }
+    return new_qubit();
+  }
+
+  void release( uint32_t q )
+  {
+    switch ( policy )
+    {
+    case ancilla_allocation::lifo:
+      free_stack.push( q );
+      break;
+    case ancilla_allocation::fifo:
+      free_queue.push_back( q );
+      break;
+    case ancilla_allocation::lowest_index:
+    case ancilla_allocation::interval_coloring:
+      free_set.insert( q );
+      break;
+    }
+  }
+
+private:
+  /* left-edge algorithm, which chooses the free color with the smallest index */
+  static uint32_t color_left_edge( std::vector<interval_t> const& intervals, std::vector<uint32_t>& colors )
+  {
+    colors.clear();
+    colors.reserve( intervals.size() );
+
+    /* active intervals ordered by end step */
+    using active_t = std::pair<uint32_t, uint32_t>;
+    std::priority_queue<active_t, std::vector<active_t>, std::greater<active_t>> active;
+    std::set<uint32_t> free_colors;
+    uint32_t num_colors{0u};
+
+    for ( auto const& [start, end] : intervals )
+    {
+      while ( !active.empty() && active.top().first < start )
+      {
+        free_colors.insert( active.top().second );
+        active.pop();
+      }
+
+      uint32_t color;
+      if ( free_colors.empty() )
+      {
+        color = num_colors++;
+      }
+      else
+      {
+        color = *free_colors.begin();
+        free_colors.erase( free_colors.begin() );
+      }
+      colors.push_back( color );
+      if ( end != infinite )
+      {
+        active.emplace( end, color );
+      }
+    }
+    return num_colors;
+  }
+
+  /* first fit by decreasing length, each color keeps its intervals ordered by start */
+  static uint32_t color_by_length( std::vector<interval_t> const& intervals, std::vector<uint32_t>& planned )
+  {
+    std::vector<uint32_t> order( intervals.size() );
+    std::iota( order.begin(), order.end(), 0u );
+    std::stable_sort( order.begin(), order.end(), [&]( auto a, auto b ) {
+      return intervals[a].second - intervals[a].first > intervals[b].second - intervals[b].first;
+    } );
+
+    planned.resize( intervals.size() );
+    std::vector<std::map<uint32_t, uint32_t>> colors;
+    const auto fits = []( std::map<uint32_t, uint32_t> const& color, interval_t const& interval ) {
+      const auto next = color.upper_bound( interval.first );
+      if ( next != color.end() && next->first <= interval.second )
+      {
+        return false;
+      }
+      return next == color.begin() || std::prev( next )->second < interval.first;
+    };
+
+    for ( auto i : order )
+    {
+      uint32_t color{0u};
+      while ( color < colors.size() && !fits( colors[color], intervals[i] ) )
+      {
+        ++color;
+      }
+      if ( color == colors.size() )
+      {
+        colors.emplace_back();
+      }
+      colors[color].emplace( intervals[i] );
+      planned[i] = color;
+    }
+    return static_cast<uint32_t>( colors.size() );
+  }
+
+  /* sum over all steps of the free colors below the highest live color */
+  static uint64_t count_holes( std::vector<interval_t> const& intervals, std::vector<uint32_t> const& colors )
+  {
+    uint32_t last_step{0u};
+    for ( auto const& [start, end] : intervals )
+    {
+      last_step = std::max( last_step, end == infinite ? start : end );
+    }
+
+    /* a value is live from its start up to its end, ends are ordered before starts */
+    std::vector<std::tuple<uint32_t, bool, uint32_t>> events;
+    events.reserve( 2u * intervals.size() );
+    for ( auto i = 0u; i < intervals.size(); ++i )
+    {
+      events.emplace_back( intervals[i].first, true, colors[i] );
+      events.emplace_back( intervals[i].second == infinite ? last_step + 1u : intervals[i].second, false, colors[i] );
+    }
+    std::sort( events.begin(), events.end() );
+
+    uint64_t holes{0u};
+    std::set<uint32_t> live;
+    for ( auto i = 0u; i < events.size(); ++i )
+    {
+      const auto& [step, is_start, color] = events[i];
+      if ( is_start )
+      {
+        live.insert( color );
+      }
+      else
+      {
+        live.erase( color );
+      }
+      if ( !live.empty() && i + 1u < events.size() )
+      {
+        holes += uint64_t( std::get<0>( events[i + 1u] ) - step ) * ( *live.rbegin() + 1u - live.size() );
+      }
+    }
+    return holes;
+  }
+
+private:
+  ancilla_allocation policy;
+
+  std::stack<uint32_t> free_stack;
+  std::deque<uint32_t> free_queue;
+  std::set<uint32_t> free_set;
+
+  std::vector<uint32_t> planned_colors;
+  std::vector<uint32_t> color_to_qubit;
+  uint32_t next_request{0u};
+};
+
+} // namespace detail
+
+} // namespace caterpillar
@@ -0,0 +1,134 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken and Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file estimate_resources.hpp
+  \brief resource estimation of hierarchical synthesis without a netlist
+*/
+
+#pragma once
+
+#include "../structures/gate_sinks.hpp"
+#include "lhrs.hpp"
+
+#include <cstdint>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+#include <mockturtle/traits.hpp>
+#include <optional>
+#include <tweedledum/algorithms/synthesis/stg.hpp>
+#include <unordered_map>
+
+namespace caterpillar
+{
+
+/*! \brief Caches the gates of a single-target gate synthesis function
+ *
+ * The gates for each function are computed once with `SingleTargetGateSynthesisFn`
+ * and replayed on the qubits of later calls with the same function.  Functions
+ * for which the synthesis function adds helper qubits are not cached, such
+ * that every call for them invokes the synthesis function and is a miss.
+ */
+template<class SingleTargetGateSynthesisFn = tweedledum::stg_from_pprm>
+class cached_stg_fn
+{
+public:
+  explicit cached_stg_fn( SingleTargetGateSynthesisFn const& stg_fn = {} )
+      : stg_fn( stg_fn )
+  {
+  }
+
+  template<class QuantumNetwork>
+  void operator()( QuantumNetwork& qnet, SetQubits const& qubits, kitty::dynamic_truth_table const& function ) const
+  {
+    const auto it = cache.find( function );
+    if ( it != cache.end() && it->second )
+    {
+      ++_hits;
+      it->second->append( qnet, qubits );
+      return;
+    }
+
+    ++_misses;
+    if ( it != cache.end() )
+    {
+      /* the synthesis function adds helper qubits */
+      stg_fn( qnet, qubits, function );
+      return;
+    }
+
+    detail::gate_span_sink sink;
+    SetQubits positions;
+    for ( auto i = 0u; i < qubits.size(); ++i )
+    {
+      positions.emplace_back( sink.add_qubit() );
+    }
+    stg_fn( sink, positions, function );
+
+    /* the gates of the first call are appended from the sink, with new qubits for helper qubits */
+    SetQubits qubit_map( qubits );
+    while ( qubit_map.size() < sink.num_qubits() )
+    {
+      qubit_map.emplace_back( qnet.num_qubits() );
+      qnet.add_qubit();
+    }
+    sink.span().append( qnet, qubit_map );
+
+    std::optional<detail::gate_span> span;
+    if ( sink.num_qubits() == qubits.size() )
+    {
+      span = std::move( sink.span() );
+    }
+    cache.emplace( function, std::move( span ) );
+  }
+
+  /*! \brief Number of calls that reused cached gates. */
+  uint64_t num_hits() const
+  {
+    return _hits;
+  }
+
+  /*! \brief Number of calls that invoked the synthesis function, including
+   *  all calls for functions that are not cached. */
+  uint64_t num_misses() const
+  {
+    return _misses;
+  }
+
+private:
+  SingleTargetGateSynthesisFn stg_fn;
+  mutable std::unordered_map<kitty::dynamic_truth_table, std::optional<detail::gate_span>, kitty::hash<kitty::dynamic_truth_table>> cache;
+  mutable uint64_t _hits{0u};
+  mutable uint64_t _misses{0u};
+};
+
+/*! \brief Estimates the resources of hierarchical synthesis
+ *
+ * Performs the same steps as `logic_network_synthesis`, but only counts qubits
+ * and gates in `resources` instead of building a circuit.  The gates of each
+ * cell function are computed once by `stg_fn` and cached per truth table, such
+ * that the estimation is exact for deterministic synthesis functions.
+ */
+template<class LogicNetwork, class SingleTargetGateSynthesisFn = tweedledum::stg_from_pprm>
+bool estimate_resources( resource_counting_sink& resources, LogicNetwork const& ntk,
+                         mapping_strategy<LogicNetwork>& strategy,
+                         SingleTargetGateSynthesisFn const& stg_fn = {},
+                         logic_network_synthesis_params const& ps = {},
+                         logic_network_synthesis_stats* pst = nullptr )
+{
+  static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+
+  const cached_stg_fn<SingleTargetGateSynthesisFn> cached( stg_fn );
+  const auto result = logic_network_synthesis( resources, ntk, strategy, cached, ps, pst );
+  if ( ps.verbose )
+  {
+    resources.report();
+    std::cout << fmt::format( "[i] cache misses = {}   cache hits = {}\n", cached.num_misses(), cached.num_hits() );
+  }
+  return result;
+}
+
+} /* namespace caterpillar */
@@ -5,19 +5,29 @@
 | Author(s): Giulia Meuli
 *-----------------------------------------------------------------------------*/
 #pragma once
+#include "../structures/cancellation_token.hpp"
 #include "../structures/stg_gate.hpp"
+#include "ancilla_allocator.hpp"
 #include "strategies/mapping_strategy.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdint>
 #include <fmt/format.h>
+#include <memory>
 #include <mockturtle/algorithms/cut_enumeration/spectr_cut.hpp>
 #include <mockturtle/traits.hpp>
 #include <mockturtle/utils/node_map.hpp>
 #include <mockturtle/utils/stopwatch.hpp>
 #include <mockturtle/views/topo_view.hpp>
 #include <tweedledum/algorithms/synthesis/stg.hpp>
-#include <stack>
+#include <kitty/hash.hpp>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <variant>
 #include <vector>
@@ -34,6 +44,46 @@ struct logic_network_synthesis_params
 {
   /*! \brief Be verbose. */
   bool verbose{false};
+
+  /*! \brief Replay the gates of a computed cell when uncomputing it.
+   *
+   * If false, the single-target gate synthesis function is called again
+   * when a cell is uncomputed.
+   */
+  bool replay_cells{true};
+
+  /*! \brief Policy to reuse free ancilla qubits. */
+  ancilla_allocation allocation{ancilla_allocation::lifo};
+
+  /*! \brief Consume steps while they are generated.
+   *
+   * If the mapping strategy provides a step generator (see
+   * `mapping_strategy::make_step_generator`), gates are emitted while the
+   * steps are generated and the steps are not stored in the strategy.  This
+   * option is ignored for interval coloring, which requires all steps ahead.
+   *
+   * Memory for the steps is then bounded by the steps that are buffered by
+   * the generator, but the qubit of each node is still kept in a map that
+   * is proportional to the size of the network.
+   */
+  bool lazy_steps{false};
+
+  /*! \brief Record the qubit timeline for lazily generated steps.
+   *
+   * The timeline in the statistics has one entry per step.  It is always
+   * recorded for stored steps, but for lazily generated steps only if this
+   * option is set, since it would grow with the number of steps.
+   */
+  bool lazy_qubit_timeline{false};
+
+  /*! \brief Stops the mapping strategy, if cancelled or past its deadline.
+   *
+   * The token is passed to the mapping strategy or to its step generator,
+   * unless it is default-constructed.  Synthesis fails, if the strategy
+   * could not compute its steps, or if the step generator failed or was
+   * cancelled before the last step.
+   */
+  cancellation_token cancellation{};
 };
 
 struct logic_network_synthesis_stats
@@ -50,15 +100,410 @@ struct logic_network_synthesis_stats
   /*! \brief input qubits. */
   std::vector<uint32_t> i_indexes;
 
+  /*! \brief Histogram of ancilla lifetimes in steps.
+   *
+   * Entry `i` counts the values that were stored in an ancilla for at least
+   * `2^i` and less than `2^(i+1)` steps.  Values that are never uncomputed
+   * live until the last step.
+   */
+  std::vector<uint32_t> ancilla_lifetimes;
+
+  /*! \brief Total number of steps in which reused ancillae were idle before reuse. */
+  uint64_t ancilla_idle_steps{0u};
+
+  /*! \brief Fragmentation of the ancillae.
+   *
+   * Sum over all steps of the number of free ancillae with a smaller index
+   * than the highest live ancilla.
+   */
+  uint64_t ancilla_holes{0u};
+
+  /*! \brief Time spent in the mapping strategy. */
+  mockturtle::stopwatch<>::duration time_strategy{0};
+
+  /*! \brief Time spent in the single-target gate synthesis function. */
+  mockturtle::stopwatch<>::duration time_stg{0};
+
+  /*! \brief Gates emitted by compute steps without cell override. */
+  uint64_t compute_gates{0u};
+
+  /*! \brief Gates emitted by uncompute steps without cell override. */
+  uint64_t uncompute_gates{0u};
+
+  /*! \brief Gates emitted by in-place compute steps. */
+  uint64_t compute_inplace_gates{0u};
+
+  /*! \brief Gates emitted by in-place uncompute steps. */
+  uint64_t uncompute_inplace_gates{0u};
+
+  /*! \brief Gates emitted by compute and uncompute steps with cell override. */
+  uint64_t cell_gates{0u};
+
+  /*! \brief Gates emitted to prepare constants and outputs. */
+  uint64_t io_gates{0u};
+
+  /*! \brief Number of distinct functions passed to the single-target gate synthesis function. */
+  uint32_t num_cell_functions{0u};
+
+  /*! \brief Maximum number of simultaneously live qubits. */
+  uint32_t peak_live_qubits{0u};
+
+  /*! \brief Number of live qubits after each step (see `lazy_qubit_timeline`). */
+  std::vector<uint32_t> qubit_timeline;
+
   void report() const
   {
-    std::cout << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+    std::cout << fmt::format( "[i] total time = {:>5.2f} secs   strategy = {:>5.2f} secs   stg = {:>5.2f} secs\n",
+                              mockturtle::to_seconds( time_total ), mockturtle::to_seconds( time_strategy ), mockturtle::to_seconds( time_stg ) );
+    std::cout << fmt::format( "[i] required ancillae = {}   idle steps = {}   holes = {}   peak live qubits = {}\n", required_ancillae, ancilla_idle_steps, ancilla_holes, peak_live_qubits );
+    std::cout << fmt::format( "[i] gates: compute = {}   uncompute = {}   compute inplace = {}   uncompute inplace = {}   cells = {}   io = {}\n",
+                              compute_gates, uncompute_gates, compute_inplace_gates, uncompute_inplace_gates, cell_gates, io_gates );
+    std::cout << fmt::format( "[i] distinct cell functions = {}\n", num_cell_functions );
+    for ( auto i = 0u; i < ancilla_lifetimes.size(); ++i )
+    {
+      std::cout << fmt::format( "[i] ancilla lifetime [{}, {}) = {}\n", 1u << i, 1u << ( i + 1 ), ancilla_lifetimes[i] );
+    }
+  }
+
+  /*! \brief Writes the statistics as JSON object. */
+  void to_json( std::ostream& os ) const
+  {
+    const auto list = []( auto const& values ) {
+      std::string s;
+      for ( auto const& v : values )
+      {
+        s += ( s.empty() ? "" : "," ) + std::to_string( v );
+      }
+      return "[" + s + "]";
+    };
+
+    os << "{\n";
+    os << fmt::format( "  \"time_total\": {},\n", mockturtle::to_seconds( time_total ) );
+    os << fmt::format( "  \"time_strategy\": {},\n", mockturtle::to_seconds( time_strategy ) );
+    os << fmt::format( "  \"time_stg\": {},\n", mockturtle::to_seconds( time_stg ) );
+    os << fmt::format( "  \"required_ancillae\": {},\n", required_ancillae );
+    os << fmt::format( "  \"peak_live_qubits\": {},\n", peak_live_qubits );
+    os << fmt::format( "  \"ancilla_idle_steps\": {},\n", ancilla_idle_steps );
+    os << fmt::format( "  \"ancilla_holes\": {},\n", ancilla_holes );
+    os << fmt::format( "  \"gates\": {{\"compute\": {}, \"uncompute\": {}, \"compute_inplace\": {}, \"uncompute_inplace\": {}, \"cell\": {}, \"io\": {}}},\n",
+                       compute_gates, uncompute_gates, compute_inplace_gates, uncompute_inplace_gates, cell_gates, io_gates );
+    os << fmt::format( "  \"num_cell_functions\": {},\n", num_cell_functions );
+    os << fmt::format( "  \"i_indexes\": {},\n", list( i_indexes ) );
+    os << fmt::format( "  \"o_indexes\": {},\n", list( o_indexes ) );
+    os << fmt::format( "  \"ancilla_lifetimes\": {},\n", list( ancilla_lifetimes ) );
+    os << fmt::format( "  \"qubit_timeline\": {}\n", list( qubit_timeline ) );
+    os << "}\n";
   }
 };
 
 namespace detail
 {
 
+/*! \brief Gates emitted by the synthesis of a single cell
+ *
+ * Qubits are stored as positions in the qubit map that was passed to the
+ * single-target gate synthesis function, such that the gates can be replayed
+ * on a different assignment of qubits.
+ */
+struct gate_span
+{
+  struct gate
+  {
+    tweedledum::gate_base op;
+    uint32_t begin;
+    uint8_t num_controls;
+    uint8_t num_targets;
+    /*! \brief 1 and 2 if added as `(op, target)` or `(op, control, target)`, 0 otherwise */
+    uint8_t arity;
+  };
+
+  std::vector<gate> gates;
+  std::vector<Qubit> positions;
+
+  /*! \brief true, if each gate in the span is its own inverse */
+  bool self_inverse{true};
+
+  /*! \brief Replays the span on a qubit map
+   *
+   * If all gates are self-inverse, the gates are replayed in the same order,
+   * otherwise the span is replayed in reverse order with adjoint gates.
+   */
+  template<class QuantumNetwork>
+  void replay( QuantumNetwork& qnet, SetQubits const& qubit_map ) const
+  {
+    if ( self_inverse )
+    {
+      append( qnet, qubit_map );
+    }
+    else
+    {
+      for ( auto it = gates.rbegin(); it != gates.rend(); ++it )
+      {
+        replay_gate( qnet, qubit_map, *it, adjoint( it->op ) );
+      }
+    }
+  }
+
+  /*! \brief Appends the gates of the span in the same order on a qubit map */
+  template<class QuantumNetwork>
+  void append( QuantumNetwork& qnet, SetQubits const& qubit_map ) const
+  {
+    for ( auto const& g : gates )
+    {
+      replay_gate( qnet, qubit_map, g, g.op );
+    }
+  }
+
+  static tweedledum::gate_base adjoint( tweedledum::gate_base const& op )
+  {
+    using tweedledum::gate_set;
+    switch ( op.operation() )
+    {
+    default:
+      return op;
+    case gate_set::t:
+      return tweedledum::gate::t_dagger;
+    case gate_set::t_dagger:
+      return tweedledum::gate::t;
+    case gate_set::phase:
+      return tweedledum::gate::phase_dagger;
+    case gate_set::phase_dagger:
+      return tweedledum::gate::phase;
+    case gate_set::rotation_x:
+    case gate_set::rotation_y:
+    case gate_set::rotation_z:
+      return tweedledum::gate_base( op.operation(), -op.rotation_angle().numeric_value() );
+    }
+  }
+
+  static bool is_self_inverse( tweedledum::gate_base const& op )
+  {
+    return op.is_one_of( tweedledum::gate_set::hadamard, tweedledum::gate_set::pauli_x, tweedledum::gate_set::pauli_y, tweedledum::gate_set::pauli_z,
+                         tweedledum::gate_set::cx, tweedledum::gate_set::cz, tweedledum::gate_set::mcx, tweedledum::gate_set::mcz );
+  }
+
+private:
+  template<class QuantumNetwork>
+  void replay_gate( QuantumNetwork& qnet, SetQubits const& qubit_map, gate const& g, tweedledum::gate_base const& op ) const
+  {
+    const auto map = [&]( Qubit q ) { return Qubit( qubit_map[q.index()], q.is_complemented() ); };
+
+    if ( g.arity == 1u )
+    {
+      qnet.add_gate( op, map( positions[g.begin] ) );
+    }
+    else if ( g.arity == 2u )
+    {
+      qnet.add_gate( op, map( positions[g.begin] ), map( positions[g.begin + 1] ) );
+    }
+    else
+    {
+      SetQubits controls, targets;
+      for ( auto i = 0u; i < g.num_controls; ++i )
+      {
+        controls.push_back( map( positions[g.begin + i] ) );
+      }
+      for ( auto i = 0u; i < g.num_targets; ++i )
+      {
+        targets.push_back( map( positions[g.begin + g.num_controls + i] ) );
+      }
+      qnet.add_gate( op, controls, targets );
+    }
+  }
+};
+
+/*! \brief Gate sink that stores gates in a gate span
+ *
+ * The positions in the span are the qubits of the sink, such that the gates
+ * can be appended to a quantum network on an arbitrary qubit assignment.
+ */
+class gate_span_sink
+{
+public:
+  uint32_t num_qubits() const
+  {
+    return _num_qubits;
+  }
+
+  uint32_t add_qubit()
+  {
+    return _num_qubits++;
+  }
+
+  void add_gate( tweedledum::gate_base op, Qubit target )
+  {
+    record( op, {}, {target}, 1u );
+  }
+
+  void add_gate( tweedledum::gate_base op, Qubit control, Qubit target )
+  {
+    record( op, {control}, {target}, 2u );
+  }
+
+  void add_gate( tweedledum::gate_base op, SetQubits const& controls, SetQubits const& targets )
+  {
+    record( op, controls, targets, 0u );
+  }
+
+  gate_span& span()
+  {
+    return _span;
+  }
+
+private:
+  void record( tweedledum::gate_base op, SetQubits const& controls, SetQubits const& targets, uint8_t arity )
+  {
+    assert( controls.size() <= 255u && targets.size() <= 255u );
+    const auto begin = static_cast<uint32_t>( _span.positions.size() );
+    _span.positions.insert( _span.positions.end(), controls.begin(), controls.end() );
+    _span.positions.insert( _span.positions.end(), targets.begin(), targets.end() );
+    _span.gates.push_back( {op, begin, static_cast<uint8_t>( controls.size() ), static_cast<uint8_t>( targets.size() ), arity} );
+  }
+
+private:
+  uint32_t _num_qubits{0u};
+  gate_span _span;
+};
+
+/*! \brief Forwards gates to a quantum network and records them as gate span
+ *
+ * The recording is invalid, if the synthesis function adds qubits or uses
+ * qubits that are not in the qubit map.
+ */
+template<class QuantumNetwork>
+class gate_span_recorder
+{
+public:
+  gate_span_recorder( QuantumNetwork& qnet, SetQubits const& qubit_map )
+      : qnet( qnet ), qubit_map( qubit_map )
+  {
+  }
+
+  auto num_qubits() const
+  {
+    return qnet.num_qubits();
+  }
+
+  auto add_qubit()
+  {
+    _valid = false;
+    return qnet.add_qubit();
+  }
+
+  void add_gate( tweedledum::gate_base op, Qubit target )
+  {
+    record( op, {}, {target}, 1u );
+    qnet.add_gate( op, target );
+  }
+
+  void add_gate( tweedledum::gate_base op, Qubit control, Qubit target )
+  {
+    record( op, {control}, {target}, 2u );
+    qnet.add_gate( op, control, target );
+  }
+
+  void add_gate( tweedledum::gate_base op, SetQubits const& controls, SetQubits const& targets )
+  {
+    record( op, controls, targets, 0u );
+    qnet.add_gate( op, controls, targets );
+  }
+
+  bool valid() const
+  {
+    return _valid;
+  }
+
+  gate_span& span()
+  {
+    return _span;
+  }
+
+private:
+  void record( tweedledum::gate_base op, SetQubits const& controls, SetQubits const& targets, uint8_t arity )
+  {
+    if ( !_valid )
+      return;
+
+    if ( controls.size() > 255u || targets.size() > 255u )
+    {
+      _valid = false;
+      return;
+    }
+
+    const auto begin = static_cast<uint32_t>( _span.positions.size() );
+    for ( auto const& qs : {std::cref( controls ), std::cref( targets )} )
+    {
+      for ( auto q : qs.get() )
+      {
+        const auto it = std::find_if( qubit_map.begin(), qubit_map.end(), [&]( auto p ) { return p.index() == q.index(); } );
+        if ( it == qubit_map.end() )
+        {
+          _valid = false;
+          return;
+        }
+        _span.positions.emplace_back( static_cast<uint32_t>( std::distance( qubit_map.begin(), it ) ), q.is_complemented() );
+      }
+    }
+    _span.gates.push_back( {op, begin, static_cast<uint8_t>( controls.size() ), static_cast<uint8_t>( targets.size() ), arity} );
+    _span.self_inverse = _span.self_inverse && gate_span::is_self_inverse( op );
+  }
+
+private:
+  QuantumNetwork& qnet;
+  SetQubits const& qubit_map;
+  gate_span _span;
+  bool _valid{true};
+};
+
+/*! \brief Forwards gates to a quantum network and counts them */
+template<class QuantumNetwork>
+class gate_counter
+{
+public:
+  gate_counter( QuantumNetwork& qnet, uint64_t& counter )
+      : qnet( qnet ), counter( &counter )
+  {
+  }
+
+  auto num_qubits() const
+  {
+    return qnet.num_qubits();
+  }
+
+  auto add_qubit()
+  {
+    return qnet.add_qubit();
+  }
+
+  void add_gate( tweedledum::gate_base op, Qubit target )
+  {
+    ++*counter;
+    qnet.add_gate( op, target );
+  }
+
+  void add_gate( tweedledum::gate_base op, Qubit control, Qubit target )
+  {
+    ++*counter;
+    qnet.add_gate( op, control, target );
+  }
+
+  void add_gate( tweedledum::gate_base op, SetQubits const& controls, SetQubits const& targets )
+  {
+    ++*counter;
+    qnet.add_gate( op, controls, targets );
+  }
+
+  /*! \brief Counts the following gates in `c` */
+  void count_into( uint64_t& c )
+  {
+    counter = &c;
+  }
+
+private:
+  QuantumNetwork& qnet;
+  uint64_t* counter;
+};
+
 template<class QuantumNetwork, class LogicNetwork, class SingleTargetGateSynthesisFn>
 class logic_network_synthesis_impl
 {
@@ -68,7 +513,7 @@ public:
                                 SingleTargetGateSynthesisFn const& stg_fn,
                                 logic_network_synthesis_params const& ps,
                                 logic_network_synthesis_stats& st )
-      : qnet( qnet ), ntk( ntk ), strategy( strategy ), stg_fn( stg_fn ), ps( ps ), st( st ), node_to_qubit( ntk )
+      : qnet( qnet, st.io_gates ), ntk( ntk ), strategy( strategy ), stg_fn( stg_fn ), ps( ps ), st( st ), node_to_qubit( ntk ), ancillae( ps.allocation )
   {
   }
 
@@ -80,19 +525,14 @@ public:
     if ( ntk.get_node( ntk.get_constant( false ) ) != ntk.get_node( ntk.get_constant( true ) ) )
       prepare_constant( true );
 
-    if ( const auto result = strategy.compute_steps( ntk ); !result )
-    {
-      if(ps.verbose)
-      {
-        std::cout << "[i] strategy could not be computed\n";
-      }
-      return false;
-    }
-    strategy.foreach_step( [&]( auto node, auto action ) {
+    bool record_timeline{true};
+    const auto process_step = [&]( auto node, auto const& action ) {
+      ++current_step;
+      qnet.count_into( gate_counter_for( action ) );
       std::visit(
           overloaded{
               []( auto ) {},
-              [&]( compute_action const& action ) {
+              [&]( compute_action_view const& action ) {
                 const auto t = node_to_qubit[node] = request_ancilla();
                 if ( ps.verbose )
                 {
@@ -109,8 +549,8 @@ public:
                 }
                 if ( action.cell_override )
                 {
-                  const auto [func, leaves] = *action.cell_override;
-                  compute_node_as_cell( node, t, func, leaves );
+                  const auto& [func, leaves] = *action.cell_override;
+                  compute_node_as_cell( node, t, func, leaves, false );
                 }
                 else if (action.leaves)
                 {
@@ -121,7 +561,7 @@ public:
                   compute_node( node, t );
                 }
               },
-              [&]( uncompute_action const& action ) {
+              [&]( uncompute_action_view const& action ) {
                 const auto t = node_to_qubit[node];
                 if ( ps.verbose )
                 {  
@@ -138,8 +578,8 @@ public:
                 }
                 if ( action.cell_override )
                 {
-                  const auto [func, leaves] = *action.cell_override;
-                  compute_node_as_cell( node, t, func, leaves );
+                  const auto& [func, leaves] = *action.cell_override;
+                  compute_node_as_cell( node, t, func, leaves, true );
                 }
                 else if (action.leaves)
                 {
@@ -151,7 +591,7 @@ public:
                 }
                 release_ancilla( t );
               },
-              [&]( compute_inplace_action const& action ) {
+              [&]( compute_inplace_action_view const& action ) {
                 if ( ps.verbose )
                 {  
                   std::cout << "[i] compute " << ntk.node_to_index( node ) << " inplace onto " << action.target_index << " in qubit " << node_to_qubit[ntk.index_to_node( action.target_index )];
@@ -175,7 +615,7 @@ public:
                   compute_node_inplace( node, t );
                 }
               },
-              [&]( uncompute_inplace_action const& action ) {
+              [&]( uncompute_inplace_action_view const& action ) {
                 if ( ps.verbose )
                 {
                   std::cout << "[i] uncompute " << ntk.node_to_index( node ) << " inplace onto " << action.target_index << " from qubit " << node_to_qubit[ntk.index_to_node( action.target_index )];
@@ -199,13 +639,79 @@ public:
                 }
               }},
           action );
-    } );
+      if ( record_timeline )
+      {
+        st.qubit_timeline.push_back( live_qubits );
+      }
+      count_holes();
+    };
 
+    if ( ps.cancellation.is_cancellable() )
+    {
+      strategy.set_cancellation( ps.cancellation );
+    }
+
+    std::unique_ptr<step_generator<LogicNetwork>> generator;
+    if ( ps.lazy_steps && ps.allocation != ancilla_allocation::interval_coloring )
+    {
+      generator = strategy.make_step_generator( ntk );
+    }
+
+    if ( generator )
+    {
+      generator->set_cancellation( ps.cancellation );
+      record_timeline = ps.lazy_qubit_timeline;
+      while ( const auto step = mockturtle::call_with_stopwatch( st.time_strategy, [&]() { return generator->next(); } ) )
+      {
+        process_step( step->first, make_action_view( step->second ) );
+      }
+      if ( generator->failed() )
+      {
+        if ( ps.verbose )
+        {
+          std::cout << "[i] strategy could not generate all steps\n";
+        }
+        return false;
+      }
+    }
+    else
+    {
+      if ( const auto result = mockturtle::call_with_stopwatch( st.time_strategy, [&]() { return strategy.compute_steps( ntk ); } ); !result )
+      {
+        if ( ps.verbose )
+        {
+          std::cout << "[i] strategy could not be computed\n";
+        }
+        return false;
+      }
+      if ( ps.allocation == ancilla_allocation::interval_coloring )
+      {
+        plan_ancillae();
+      }
+      strategy.foreach_step_view( process_step );
+    }
+
+    qnet.count_into( st.io_gates );
     prepare_outputs();
+    finalize_lifetimes();
+    st.num_cell_functions = static_cast<uint32_t>( cell_functions.size() );
 
     return true;
   }
 
+  /*! \brief Ancilla qubits that are released and in their initial state after `run` */
+  std::vector<uint32_t> free_ancillae() const
+  {
+    std::vector<uint32_t> qubits;
+    for ( auto const& [q, step] : released_at )
+    {
+      (void)step;
+      qubits.push_back( q );
+    }
+    std::sort( qubits.begin(), qubits.end() );
+    return qubits;
+  }
+
 private:
   void prepare_inputs()
   {
@@ -214,6 +720,7 @@ private:
       node_to_qubit[n] = qnet.num_qubits();
       st.i_indexes.push_back( node_to_qubit[n] );
       qnet.add_qubit();
+      add_live_qubit();
     } );
   }
 
@@ -226,25 +733,70 @@ private:
     const auto v = ntk.constant_value( n ) ^ ntk.is_complemented( f );
     node_to_qubit[n] = qnet.num_qubits();
     qnet.add_qubit();
+    add_live_qubit();
     if ( v )
       qnet.add_gate( tweedledum::gate::pauli_x, node_to_qubit[n] );
   }
 
   uint32_t request_ancilla()
   {
-    if ( free_ancillae.empty() )
-    {
-      const auto r = qnet.num_qubits();
+    const auto r = ancillae.request( [&]() {
+      const auto q = qnet.num_qubits();
       st.required_ancillae++;
       qnet.add_qubit();
-      return r;
+      ancilla_qubits.push_back( q );
+      return q;
+    } );
+
+    if ( const auto it = released_at.find( r ); it != released_at.end() )
+    {
+      st.ancilla_idle_steps += current_step - it->second;
+      released_at.erase( it );
     }
-    else
+    live_since[r] = current_step;
+    live_ancillae.insert( r );
+    add_live_qubit();
+    return r;
+  }
+
+  /* free ancillae below the highest live ancilla, ancillae are created in increasing order of index */
+  void count_holes()
+  {
+    if ( live_ancillae.empty() )
     {
-      const auto r = free_ancillae.top();
-      free_ancillae.pop();
-      return r;
+      return;
     }
+    const auto top = std::lower_bound( ancilla_qubits.begin(), ancilla_qubits.end(), *live_ancillae.rbegin() );
+    st.ancilla_holes += static_cast<uint64_t>( top - ancilla_qubits.begin() ) + 1u - live_ancillae.size();
+  }
+
+  void add_live_qubit()
+  {
+    st.peak_live_qubits = std::max( st.peak_live_qubits, ++live_qubits );
+  }
+
+  /* counter in the statistics for the gates of an action */
+  uint64_t& gate_counter_for( mapping_strategy_action_view const& action )
+  {
+    switch ( action.index() )
+    {
+    case 0u:
+      return std::get<compute_action_view>( action ).cell_override ? st.cell_gates : st.compute_gates;
+    case 1u:
+      return std::get<uncompute_action_view>( action ).cell_override ? st.cell_gates : st.uncompute_gates;
+    case 2u:
+      return st.compute_inplace_gates;
+    default:
+      return st.uncompute_inplace_gates;
+    }
+  }
+
+  template<class Network>
+  void call_stg_fn( Network& network, SetQubits const& qubit_map, kitty::dynamic_truth_table const& function )
+  {
+    cell_functions.insert( function );
+    mockturtle::stopwatch t( st.time_stg );
+    stg_fn( network, qubit_map, function );
   }
 
   void prepare_outputs()
@@ -278,7 +830,67 @@ private:
 
   void release_ancilla( uint32_t q )
   {
-    free_ancillae.push( q );
+    if ( const auto it = live_since.find( q ); it != live_since.end() )
+    {
+      record_lifetime( current_step - it->second );
+      live_since.erase( it );
+    }
+    released_at[q] = current_step;
+    live_ancillae.erase( q );
+    --live_qubits;
+    ancillae.release( q );
+  }
+
+  /* computes the lifetime intervals of all computed nodes and plans their qubits */
+  void plan_ancillae()
+  {
+    std::vector<ancilla_allocator::interval_t> intervals;
+    std::unordered_map<uint32_t, uint32_t> open;
+    uint32_t step{0u};
+    strategy.foreach_step_view( [&]( auto node, auto const& action ) {
+      ++step;
+      const auto index = ntk.node_to_index( node );
+      if ( std::holds_alternative<compute_action_view>( action ) )
+      {
+        open[index] = static_cast<uint32_t>( intervals.size() );
+        intervals.emplace_back( step, ancilla_allocator::infinite );
+      }
+      else if ( std::holds_alternative<uncompute_action_view>( action ) )
+      {
+        if ( const auto it = open.find( index ); it != open.end() )
+        {
+          intervals[it->second].second = step;
+          open.erase( it );
+        }
+      }
+    } );
+    ancillae.plan( intervals );
+  }
+
+  void record_lifetime( uint32_t steps )
+  {
+    uint32_t bucket{0u};
+    while ( ( steps >> 1 ) > 0u )
+    {
+      steps >>= 1;
+      ++bucket;
+    }
+    if ( st.ancilla_lifetimes.size() <= bucket )
+    {
+      st.ancilla_lifetimes.resize( bucket + 1, 0u );
+    }
+    st.ancilla_lifetimes[bucket]++;
+  }
+
+  /* ancillae that are never released live until the last step */
+  void finalize_lifetimes()
+  {
+    for ( auto const& [q, since] : live_since )
+    {
+      (void)q;
+      record_lifetime( current_step + 1 - since );
+    }
+    live_since.clear();
   }
 
   template<int Fanin>
@@ -301,7 +913,7 @@ private:
     return controls;
   }
 
-  void compute_big_xor( uint32_t t, std::vector<uint32_t> leaves)
+  void compute_big_xor( uint32_t t, leaves_view leaves )
   {
     for ( auto control : leaves )
     {
@@ -439,18 +1051,51 @@ private:
     }
   }
 
-  void compute_node_as_cell( mt::node<LogicNetwork> const& node, uint32_t t, kitty::dynamic_truth_table const& func, std::vector<uint32_t> const& leave_indexes )
+  void compute_node_as_cell( mt::node<LogicNetwork> const& node, uint32_t t, kitty::dynamic_truth_table const& func, leaves_view leave_indexes, bool uncompute )
   {
-    (void)node;
-
     /* get control qubits */
-    SetQubits controls;
+    SetQubits qubit_map;
     for ( auto l : leave_indexes )
     {
-      controls.push_back( tweedledum::qubit_id( node_to_qubit[ntk.node_to_index( l )] ) );
+      qubit_map.push_back( tweedledum::qubit_id( node_to_qubit[ntk.node_to_index( l )] ) );
     }
+    qubit_map.push_back( tweedledum::qubit_id( t ) );
 
-    compute_lut( func, controls, tweedledum::qubit_id( t ) );
+    if ( !ps.replay_cells )
+    {
+      call_stg_fn( qnet, qubit_map, func );
+      return;
+    }
+
+    const auto index = ntk.node_to_index( node );
+    if ( uncompute )
+    {
+      /* replay the gates of the computation, if the cell did not change */
+      if ( const auto it = cell_spans.find( index ); it != cell_spans.end() )
+      {
+        const auto& [cell_func, cell_leaves, span] = it->second;
+        if ( std::equal( cell_leaves.begin(), cell_leaves.end(), leave_indexes.begin(), leave_indexes.end() ) && cell_func == func )
+        {
+          span.replay( qnet, qubit_map );
+          cell_spans.erase( it );
+          return;
+        }
+        cell_spans.erase( it );
+      }
+      call_stg_fn( qnet, qubit_map, func );
+      return;
+    }
+
+    gate_span_recorder<decltype( qnet )> recorder( qnet, qubit_map );
+    call_stg_fn( recorder, qubit_map, func );
+    if ( recorder.valid() )
+    {
+      cell_spans[index] = {func, leave_indexes.to_vector(), std::move( recorder.span() )};
+    }
+    else
+    {
+      cell_spans.erase( index );
+    }
   }
 
   void compute_node_inplace( mt::node<LogicNetwork> const& node, uint32_t t )
@@ -571,7 +1216,7 @@ private:
   {
     auto qubit_map = controls;
     qubit_map.push_back( t );
-    stg_fn( qnet, qubit_map, function );
+    call_stg_fn( qnet, qubit_map, function );
   }
 
   void compute_xor_inplace( uint32_t c1, uint32_t c2, bool inv, uint32_t t )
@@ -622,14 +1267,24 @@ private:
   }
 
 private:
-  QuantumNetwork& qnet;
+  gate_counter<QuantumNetwork> qnet;
   LogicNetwork const& ntk;
   mapping_strategy<LogicNetwork>& strategy;
   SingleTargetGateSynthesisFn const& stg_fn;
   logic_network_synthesis_params const& ps;
   logic_network_synthesis_stats& st;
   mt::node_map<uint32_t, LogicNetwork> node_to_qubit;
-  std::stack<uint32_t> free_ancillae;
+  ancilla_allocator ancillae;
+  uint32_t current_step{0u};
+  std::unordered_map<uint32_t, uint32_t> live_since;
+  std::unordered_map<uint32_t, uint32_t> released_at;
+  std::vector<uint32_t> ancilla_qubits;
+  std::set<uint32_t> live_ancillae;
+  uint32_t live_qubits{0u};
+  std::unordered_set<kitty::dynamic_truth_table, kitty::hash<kitty::dynamic_truth_table>> cell_functions;
+
+  /* gates of computed cells, which are replayed when the cell is uncomputed */
+  std::unordered_map<uint32_t, std::tuple<kitty::dynamic_truth_table, std::vector<uint32_t>, gate_span>> cell_spans;
 }; // namespace detail
 
 } // namespace detail
@@ -643,6 +1298,11 @@ private:
  * computed out-of-place or in-place is determined by a separate mapper
  * component `MappingStrategy` that is passed as template parameter to the
  * function.
+ *
+ * `QuantumNetwork` is typically a `tweedledum::netlist`, but it may be any
+ * gate sink, e.g., `qasm_gate_sink` or `resource_counting_sink` (see
+ * `structures/gate_sinks.hpp`) in order not to keep the complete circuit in
+ * memory.
  */
 template<class QuantumNetwork, class LogicNetwork,
          class SingleTargetGateSynthesisFn = tweedledum::stg_from_pprm>
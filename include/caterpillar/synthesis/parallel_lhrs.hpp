@@ -0,0 +1,493 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken and Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file parallel_lhrs.hpp
+  \brief hierarchical synthesis of independent output cones in parallel
+*/
+
+#pragma once
+
+#include "lhrs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <fmt/format.h>
+#include <iostream>
+#include <mockturtle/traits.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace caterpillar
+{
+
+struct parallel_logic_network_synthesis_params
+{
+  /*! \brief Number of worker threads (0: hardware concurrency). */
+  uint32_t num_threads{0u};
+
+  /*! \brief Overlap to merge an output into an existing cluster.
+   *
+   * An output is synthesized together with the cluster that shares most of
+   * the nodes in its transitive fanin cone, if the shared fraction is at
+   * least this value.  Otherwise, the output starts a new cluster.
+   */
+  double merge_overlap{0.5};
+
+  /*! \brief Parameters for the synthesis of each cluster. */
+  logic_network_synthesis_params synthesis_ps{};
+
+  /*! \brief Be verbose. */
+  bool verbose{false};
+};
+
+struct parallel_logic_network_synthesis_stats
+{
+  /*! \brief Total runtime. */
+  mockturtle::stopwatch<>::duration time_total{0};
+
+  /*! \brief Number of clusters that were synthesized independently. */
+  uint32_t num_clusters{0u};
+
+  /*! \brief Number of qubits that were reused across clusters. */
+  uint32_t reused_qubits{0u};
+
+  void report() const
+  {
+    std::cout << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+    std::cout << fmt::format( "[i] clusters = {}   reused qubits = {}\n", num_clusters, reused_qubits );
+  }
+};
+
+namespace detail
+{
+
+template<class LogicNetwork>
+class output_clustering
+{
+public:
+  using node = mt::node<LogicNetwork>;
+
+  output_clustering( LogicNetwork const& ntk, double merge_overlap )
+      : ntk( ntk ), merge_overlap( merge_overlap )
+  {
+  }
+
+  /*! \brief Returns the output indexes of each cluster
+   *
+   * Outputs driven by primary inputs or constants are not part of any cluster.
+   */
+  std::vector<std::vector<uint32_t>> run()
+  {
+    std::vector<std::vector<uint32_t>> clusters;
+    std::unordered_map<node, uint32_t> node_to_cluster;
+
+    ntk.foreach_po( [&]( auto const& f, auto index ) {
+      if ( ntk.is_constant( ntk.get_node( f ) ) || ntk.is_pi( ntk.get_node( f ) ) )
+      {
+        return;
+      }
+      const auto cone = collect_cone( {ntk.get_node( f )} );
+
+      std::unordered_map<uint32_t, uint32_t> shared;
+      for ( auto const& n : cone )
+      {
+        if ( const auto it = node_to_cluster.find( n ); it != node_to_cluster.end() )
+        {
+          shared[it->second]++;
+        }
+      }
+
+      auto best = static_cast<uint32_t>( clusters.size() );
+      uint32_t best_shared{0u};
+      for ( auto const& [c, count] : shared )
+      {
+        if ( count > best_shared || ( count == best_shared && c < best ) )
+        {
+          best = c;
+          best_shared = count;
+        }
+      }
+      if ( best_shared < merge_overlap * cone.size() )
+      {
+        best = static_cast<uint32_t>( clusters.size() );
+      }
+
+      if ( best == clusters.size() )
+      {
+        clusters.emplace_back();
+      }
+      clusters[best].push_back( index );
+      for ( auto const& n : cone )
+      {
+        node_to_cluster.emplace( n, best );
+      }
+    } );
+
+    return clusters;
+  }
+
+  /*! \brief Collects the gates in the transitive fanin of `roots` in topological order */
+  std::vector<node> collect_cone( std::vector<node> const& roots ) const
+  {
+    std::vector<node> cone;
+    std::unordered_set<node> visited;
+    std::vector<std::pair<node, bool>> stack;
+
+    for ( auto const& r : roots )
+    {
+      stack.emplace_back( r, false );
+    }
+    std::reverse( stack.begin(), stack.end() );
+
+    while ( !stack.empty() )
+    {
+      const auto [n, expanded] = stack.back();
+      stack.pop_back();
+
+      if ( expanded )
+      {
+        cone.push_back( n );
+        continue;
+      }
+      if ( ntk.is_constant( n ) || ntk.is_pi( n ) || !visited.insert( n ).second )
+      {
+        continue;
+      }
+      stack.emplace_back( n, true );
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        stack.emplace_back( ntk.get_node( f ), false );
+      } );
+    }
+
+    return cone;
+  }
+
+  /*! \brief Copies the cone of some outputs into a network with all primary inputs */
+  LogicNetwork extract( std::vector<uint32_t> const& outputs ) const
+  {
+    std::vector<mt::signal<LogicNetwork>> pos;
+    ntk.foreach_po( [&]( auto const& f ) {
+      pos.push_back( f );
+    } );
+
+    std::vector<node> roots;
+    for ( auto o : outputs )
+    {
+      roots.push_back( ntk.get_node( pos[o] ) );
+    }
+
+    LogicNetwork dest;
+    std::unordered_map<node, mt::signal<LogicNetwork>> old_to_new;
+    old_to_new[ntk.get_node( ntk.get_constant( false ) )] = dest.get_constant( false );
+    if ( ntk.get_node( ntk.get_constant( true ) ) != ntk.get_node( ntk.get_constant( false ) ) )
+    {
+      old_to_new[ntk.get_node( ntk.get_constant( true ) )] = dest.get_constant( true );
+    }
+    ntk.foreach_pi( [&]( auto const& n ) {
+      old_to_new[n] = dest.create_pi();
+    } );
+
+    const auto map_signal = [&]( mt::signal<LogicNetwork> const& f ) {
+      const auto g = old_to_new.at( ntk.get_node( f ) );
+      return ntk.is_complemented( f ) ? dest.create_not( g ) : g;
+    };
+
+    for ( auto const& n : collect_cone( roots ) )
+    {
+      std::vector<mt::signal<LogicNetwork>> children;
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        children.push_back( map_signal( f ) );
+      } );
+      old_to_new[n] = dest.clone_node( ntk, n, children );
+    }
+
+    for ( auto o : outputs )
+    {
+      dest.create_po( map_signal( pos[o] ) );
+    }
+
+    return dest;
+  }
+
+private:
+  LogicNetwork const& ntk;
+  double merge_overlap;
+};
+
+} // namespace detail
+
+/*! \brief Hierarchical synthesis of independent output cones in parallel
+ *
+ * The primary outputs are clustered by the overlap of their transitive fanin
+ * cones.  Each cluster is extracted into a separate logic network, which is
+ * synthesized with `logic_network_synthesis` on a worker thread, using a copy
+ * of `strategy` and of `stg_fn`.  Afterwards, the partial circuits are
+ * appended to `qnet` in cluster order.  All clusters share the qubits of the
+ * primary inputs, and ancillae that a cluster leaves clean are reused by the
+ * following clusters.  Outputs driven by primary inputs or constants are
+ * prepared after all clusters, such that no cluster modifies a shared input
+ * qubit.  A cluster whose synthesis throws an exception counts as failed.
+ *
+ * Since each cluster is synthesized separately, nodes in the intersection of
+ * two clusters are computed once per cluster.  The overlap threshold
+ * `merge_overlap` trades this duplication against parallelism.
+ *
+ * The statistics in `pst` describe the complete circuit: `i_indexes` and
+ * `o_indexes` are in the order of the primary inputs and outputs of `ntk`.
+ * Times and counters are summed over all clusters, in particular, cell
+ * functions are counted once per cluster and times add up the work of all
+ * threads.
+ */
+template<class QuantumNetwork, class LogicNetwork, class MappingStrategy,
+         class SingleTargetGateSynthesisFn = tweedledum::stg_from_pprm>
+bool parallel_logic_network_synthesis( QuantumNetwork& qnet, LogicNetwork const& ntk,
+                                       MappingStrategy const& strategy,
+                                       SingleTargetGateSynthesisFn const& stg_fn = {},
+                                       parallel_logic_network_synthesis_params const& ps = {},
+                                       logic_network_synthesis_stats* pst = nullptr,
+                                       parallel_logic_network_synthesis_stats* ppst = nullptr )
+{
+  static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+  static_assert( mt::has_clone_node_v<LogicNetwork>, "LogicNetwork does not implement the clone_node method" );
+  static_assert( mt::has_create_not_v<LogicNetwork>, "LogicNetwork does not implement the create_not method" );
+  static_assert( std::is_base_of_v<mapping_strategy<LogicNetwork>, MappingStrategy>, "MappingStrategy is not a mapping strategy" );
+
+  logic_network_synthesis_stats st;
+  parallel_logic_network_synthesis_stats pst_local;
+
+  struct partial_result
+  {
+    detail::gate_span_sink circuit;
+    logic_network_synthesis_stats st;
+    std::vector<uint32_t> free_ancillae;
+    bool success{false};
+  };
+
+  std::vector<std::vector<uint32_t>> clusters;
+  std::vector<partial_result> results;
+  {
+    mockturtle::stopwatch t( pst_local.time_total );
+
+    detail::output_clustering<LogicNetwork> clustering( ntk, ps.merge_overlap );
+    clusters = clustering.run();
+    results.resize( clusters.size() );
+    pst_local.num_clusters = static_cast<uint32_t>( clusters.size() );
+
+    /* synthesize clusters */
+    std::atomic<uint32_t> next_cluster{0u};
+    const auto worker = [&]() {
+      for ( auto i = next_cluster++; i < clusters.size(); i = next_cluster++ )
+      {
+        auto& r = results[i];
+        try
+        {
+          const auto sub = clustering.extract( clusters[i] );
+          auto sub_strategy = strategy;
+          const auto sub_stg_fn = stg_fn;
+
+          detail::logic_network_synthesis_impl<detail::gate_span_sink, LogicNetwork, SingleTargetGateSynthesisFn> impl( r.circuit, sub, sub_strategy, sub_stg_fn, ps.synthesis_ps, r.st );
+          r.success = impl.run();
+          r.free_ancillae = impl.free_ancillae();
+        }
+        catch ( ... )
+        {
+          /* reported as failure of the cluster, exceptions must not leave the thread */
+          r.success = false;
+        }
+      }
+    };
+
+    auto num_threads = ps.num_threads == 0u ? std::thread::hardware_concurrency() : ps.num_threads;
+    num_threads = std::max( 1u, std::min<uint32_t>( num_threads, static_cast<uint32_t>( clusters.size() ) ) );
+    std::vector<std::thread> threads;
+    for ( auto i = 1u; i < num_threads; ++i )
+    {
+      threads.emplace_back( worker );
+    }
+    worker();
+    for ( auto& thread : threads )
+    {
+      thread.join();
+    }
+
+    /* stitch partial circuits */
+    const auto num_pis = ntk.num_pis();
+    for ( auto i = 0u; i < num_pis; ++i )
+    {
+      st.i_indexes.push_back( qnet.num_qubits() );
+      qnet.add_qubit();
+    }
+
+    std::vector<uint32_t> outputs( ntk.num_pos() );
+    std::vector<uint32_t> clean_qubits;
+    auto result = true;
+    for ( auto c = 0u; c < clusters.size(); ++c )
+    {
+      auto& r = results[c];
+      if ( !r.success )
+      {
+        result = false;
+        break;
+      }
+
+      /* qubits of earlier clusters that stay live */
+      const auto retained = static_cast<uint32_t>( qnet.num_qubits() - num_pis - clean_qubits.size() );
+
+      SetQubits qubit_map;
+      for ( auto q = 0u; q < r.circuit.num_qubits(); ++q )
+      {
+        if ( q < num_pis )
+        {
+          qubit_map.emplace_back( st.i_indexes[q] );
+        }
+        else if ( !clean_qubits.empty() )
+        {
+          qubit_map.emplace_back( clean_qubits.back() );
+          clean_qubits.pop_back();
+          pst_local.reused_qubits++;
+        }
+        else
+        {
+          qubit_map.emplace_back( qnet.num_qubits() );
+          qnet.add_qubit();
+        }
+      }
+
+      r.circuit.span().append( qnet, qubit_map );
+
+      for ( auto o = 0u; o < clusters[c].size(); ++o )
+      {
+        outputs[clusters[c][o]] = qubit_map[r.st.o_indexes[o]].index();
+      }
+      for ( auto it = r.free_ancillae.rbegin(); it != r.free_ancillae.rend(); ++it )
+      {
+        clean_qubits.push_back( qubit_map[*it].index() );
+      }
+
+      st.ancilla_idle_steps += r.st.ancilla_idle_steps;
+      st.time_strategy += r.st.time_strategy;
+      st.time_stg += r.st.time_stg;
+      st.compute_gates += r.st.compute_gates;
+      st.uncompute_gates += r.st.uncompute_gates;
+      st.compute_inplace_gates += r.st.compute_inplace_gates;
+      st.uncompute_inplace_gates += r.st.uncompute_inplace_gates;
+      st.cell_gates += r.st.cell_gates;
+      st.io_gates += r.st.io_gates;
+      st.num_cell_functions += r.st.num_cell_functions;
+      st.peak_live_qubits = std::max( st.peak_live_qubits, retained + r.st.peak_live_qubits );
+      for ( auto live : r.st.qubit_timeline )
+      {
+        st.qubit_timeline.push_back( retained + live );
+      }
+      if ( st.ancilla_lifetimes.size() < r.st.ancilla_lifetimes.size() )
+      {
+        st.ancilla_lifetimes.resize( r.st.ancilla_lifetimes.size(), 0u );
+      }
+      for ( auto i = 0u; i < r.st.ancilla_lifetimes.size(); ++i )
+      {
+        st.ancilla_lifetimes[i] += r.st.ancilla_lifetimes[i];
+      }
+
+      /* free memory of the partial circuit */
+      r.circuit = {};
+    }
+
+    if ( !result )
+    {
+      if ( ps.verbose )
+      {
+        std::cout << "[i] strategy could not be computed for some cluster\n";
+      }
+      return false;
+    }
+
+    /* outputs driven by primary inputs or constants are prepared last, since all clusters share the input qubits */
+    std::vector<mt::signal<LogicNetwork>> pos;
+    ntk.foreach_po( [&]( auto const& f ) { pos.push_back( f ); } );
+    std::unordered_map<mt::node<LogicNetwork>, uint32_t> pi_index;
+    ntk.foreach_pi( [&]( auto const& n, auto i ) { pi_index[n] = i; } );
+
+    const auto request_qubit = [&]() {
+      if ( !clean_qubits.empty() )
+      {
+        const auto q = clean_qubits.back();
+        clean_qubits.pop_back();
+        pst_local.reused_qubits++;
+        return q;
+      }
+      qnet.add_qubit();
+      return qnet.num_qubits() - 1u;
+    };
+
+    /* the first output of a node is prepared in place, further outputs are copies, as in logic_network_synthesis */
+    std::unordered_map<mt::node<LogicNetwork>, uint32_t> first_output;
+    for ( auto o = 0u; o < pos.size(); ++o )
+    {
+      const auto n = ntk.get_node( pos[o] );
+      if ( !ntk.is_constant( n ) && !ntk.is_pi( n ) )
+      {
+        continue;
+      }
+
+      if ( const auto it = first_output.find( n ); it != first_output.end() )
+      {
+        outputs[o] = request_qubit();
+        qnet.add_gate( tweedledum::gate::cx, outputs[it->second], outputs[o] );
+        if ( ntk.is_complemented( pos[o] ) != ntk.is_complemented( pos[it->second] ) )
+        {
+          qnet.add_gate( tweedledum::gate::pauli_x, outputs[o] );
+        }
+        continue;
+      }
+
+      first_output.emplace( n, o );
+      if ( ntk.is_constant( n ) )
+      {
+        outputs[o] = request_qubit();
+        if ( ntk.constant_value( n ) != ntk.is_complemented( pos[o] ) )
+        {
+          qnet.add_gate( tweedledum::gate::pauli_x, outputs[o] );
+        }
+      }
+      else
+      {
+        outputs[o] = st.i_indexes[pi_index.at( n )];
+        if ( ntk.is_complemented( pos[o] ) )
+        {
+          qnet.add_gate( tweedledum::gate::pauli_x, outputs[o] );
+        }
+      }
+    }
+
+    st.o_indexes = outputs;
+    st.required_ancillae = qnet.num_qubits() - num_pis;
+  }
+  st.time_total = pst_local.time_total;
+
+  if ( ps.verbose )
+  {
+    pst_local.report();
+    st.report();
+  }
+  if ( pst )
+  {
+    *pst = st;
+  }
+  if ( ppst )
+  {
+    *ppst = pst_local;
+  }
+  return true;
+}
+
+} /* namespace caterpillar */
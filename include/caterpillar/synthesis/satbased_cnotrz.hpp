@@ -6,7 +6,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <fmt/format.h>
@@ -17,6 +20,9 @@
 #include <tweedledum/utils/bit_matrix_rm.hpp>
 #include <tweedledum/utils/parity_terms.hpp>
 
+#include "../solvers/sat_backend.hpp"
+#include "../structures/cancellation_token.hpp"
+
 namespace caterpillar
 {
 
@@ -27,8 +33,14 @@ struct satbased_cnotrz_params
   /* \brief SAT solver conflict limit. */
   int conflict_limit{0};
 
+  /*! \brief SAT solver. */
+  sat_backend backend{sat_backend::bsat};
+
   /*! \brief Be verbose. */
   bool verbose{false};
+
+  /*! \brief Stops the search between two solver calls (a heuristic circuit is returned). */
+  cancellation_token cancellation{};
 };
 
 struct satbased_cnotrz_stats
@@ -39,17 +51,24 @@ struct satbased_cnotrz_stats
   /*! \brief Solving time */
   mockturtle::stopwatch<>::duration time_solving{};
 
+  /*! \brief The search was cancelled, the circuit is heuristic and not optimum. */
+  bool cancelled{false};
+
   void report()
   {
     std::cout << fmt::format( "[i] time (SAT solving) = {:7.2f} secs\n", mockturtle::to_seconds( time_solving ) );
     std::cout << fmt::format( "[i] time (total)       = {:7.2f} secs\n", mockturtle::to_seconds( time_total ) );
+    if ( cancelled )
+    {
+      std::cout << "[i] search cancelled, circuit is heuristic\n";
+    }
   }
 };
 
 namespace detail
 {
 
-template<class Network>
+template<class Network, class Solver = percy::bsat_wrapper>
 class satbased_cnotrz_impl
 {
 public:
@@ -71,7 +90,7 @@ public:
     assert_initial();
 
     auto time = 0u;
-    while ( true )
+    while ( !ps.cancellation.is_cancelled() )
     {
       if ( ps.verbose )
       {
@@ -100,8 +119,8 @@ public:
       ++time;
     }
 
-    Network netlist;
-    return netlist;
+    st.cancelled = true;
+    return heuristic_solution();
   }
 
 private:
@@ -402,6 +421,88 @@ private:
     return netlist;
   }
 
+  /* each parity term is computed into one of its qubits and uncomputed, then the transform is synthesized by Gaussian elimination */
+  Network heuristic_solution()
+  {
+    Network netlist;
+
+    std::vector<uint32_t> qubits_states;
+    for ( auto i = 0u; i < num_qubits; ++i )
+    {
+      netlist.add_qubit();
+      qubits_states.emplace_back( ( 1u << i ) );
+    }
+
+    const auto add_cx = [&]( uint32_t c, uint32_t t ) {
+      netlist.add_gate( gate::cx, c, t );
+      qubits_states[t] ^= qubits_states[c];
+      if ( auto rotation = parities.extract_term( qubits_states[t] ); rotation != 0.0 )
+      {
+        netlist.add_gate( gate_base( gate_set::rotation_z, rotation ), t );
+      }
+    };
+
+    for ( auto i = 0u; i < num_qubits; ++i )
+    {
+      if ( auto rotation = parities.extract_term( qubits_states[i] ); rotation != 0.0 )
+      {
+        netlist.add_gate( gate_base( gate_set::rotation_z, rotation ), i );
+      }
+    }
+
+    std::vector<uint32_t> terms;
+    for ( auto const& [term, angle] : parities )
+    {
+      (void)angle;
+      terms.push_back( term );
+    }
+    for ( auto term : terms )
+    {
+      const auto target = static_cast<uint32_t>( __builtin_ctz( term ) );
+      for ( auto c = target + 1u; c < num_qubits; ++c )
+        if ( ( term >> c ) & 1u )
+          add_cx( c, target );
+      for ( auto c = num_qubits; c-- > target + 1u; )
+        if ( ( term >> c ) & 1u )
+          add_cx( c, target );
+    }
+
+    /* row operations that reduce the transform to the identity, in reverse, build the transform */
+    std::vector<uint32_t> rows( num_qubits, 0u );
+    for ( auto row = 0u; row < num_qubits; ++row )
+      for ( auto column = 0u; column < num_qubits; ++column )
+        if ( transform.at( row, column ) )
+          rows[row] |= 1u << column;
+
+    std::vector<std::pair<uint32_t, uint32_t>> operations;
+    const auto add_row = [&]( uint32_t c, uint32_t t ) {
+      rows[t] ^= rows[c];
+      operations.emplace_back( c, t );
+    };
+    for ( auto column = 0u; column < num_qubits; ++column )
+    {
+      if ( !( ( rows[column] >> column ) & 1u ) )
+      {
+        for ( auto row = column + 1u; row < num_qubits; ++row )
+        {
+          if ( ( rows[row] >> column ) & 1u )
+          {
+            add_row( row, column );
+            break;
+          }
+        }
+      }
+      assert( ( ( rows[column] >> column ) & 1u ) && "transform is not invertible" );
+      for ( auto row = 0u; row < num_qubits; ++row )
+        if ( row != column && ( ( rows[row] >> column ) & 1u ) )
+          add_row( column, row );
+    }
+    for ( auto it = operations.rbegin(); it != operations.rend(); ++it )
+      add_cx( it->first, it->second );
+
+    return netlist;
+  }
+
 private:
   inline int matrix_var( uint32_t time, uint32_t row, uint32_t column ) const
   {
@@ -437,23 +538,34 @@ private:
 
   uint32_t offset;
 
-  percy::bsat_wrapper solver;
+  Solver solver;
 };
 
 } // namespace detail
 
+/*! \brief Optimum {CNOT, Rz} circuit for a linear transform and parity terms
+ *
+ * Finds the circuit with the fewest CNOT gates by SAT solving for increasing
+ * numbers of CNOT gates.  If the search is cancelled, a heuristic circuit is
+ * returned and `pst->cancelled` is set.
+ */
 template<class Network>
-Network satbased_cnotrz( bit_matrix_rm<> const& transform, parity_terms const& parities, satbased_cnotrz_params const& ps = {} )
+Network satbased_cnotrz( bit_matrix_rm<> const& transform, parity_terms const& parities, satbased_cnotrz_params const& ps = {}, satbased_cnotrz_stats* pst = nullptr )
 {
   satbased_cnotrz_stats st;
-  detail::satbased_cnotrz_impl<Network> impl( transform, parities, ps, st );
-
-  const auto result = impl.run();
+  const auto result = dispatch_sat_backend( ps.backend, [&]( auto tag ) {
+    detail::satbased_cnotrz_impl<Network, std::remove_pointer_t<decltype( tag )>> impl( transform, parities, ps, st );
+    return impl.run();
+  } );
 
   if ( ps.verbose )
   {
     st.report();
   }
+  if ( pst )
+  {
+    *pst = st;
+  }
 
   return result;
 }
@@ -7,10 +7,14 @@
 
 #include "../optimization/optimization_graph.hpp"
 #include "../optimization/post_opt_esop.hpp"
+#include "../solvers/maxsat_rc2.hpp"
+#include "../structures/cancellation_token.hpp"
 
 #include <cstdint>
 #include <functional>
 #include <iostream>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include <kitty/constructors.hpp>
@@ -26,6 +30,7 @@
 
 #include <easy/esop/constructors.hpp>
 #include <easy/esop/cost.hpp>
+#include <easy/esop/helliwell.hpp>
 
 namespace caterpillar
 {
@@ -68,11 +73,20 @@ private:
   bool optimize_esop_{false};
 };
 
+/*! \brief Single-target gate synthesis from exact ESOPs
+ *
+ * Once `cancellation` is cancelled, the smaller of the PPRM and the optimum
+ * PKRM is used instead of the exact ESOP for functions that are not yet
+ * cached.  The MaxSAT solver for the exact ESOP checks the token between
+ * its iterations, such that a cancelled synthesis also uses the fallback.
+ */
 struct stg_from_exact_synthesis
 {
 public:
-  explicit stg_from_exact_synthesis( std::function<int( kitty::cube )> const& cost_fn = []( kitty::cube const& cube ) { (void)cube; return 1; } )
-      : cost_fn( cost_fn )
+  explicit stg_from_exact_synthesis( std::function<int( kitty::cube )> const& cost_fn = []( kitty::cube const& cube ) { (void)cube; return 1; },
+                                     cancellation_token const& cancellation = {} )
+      : cost_fn( cost_fn ),
+        cancellation( cancellation )
   {
   }
 
@@ -99,9 +113,6 @@ public:
     assert( qubit_map.size() == std::size_t( num_controls ) + 1u );
 
     /* synthesize ESOP */
-    easy::esop::helliwell_maxsat_statistics stats;
-    easy::esop::helliwell_maxsat_params ps;
-
     easy::esop::esop_t esop;
 
     /* check if function is already in the cache */
@@ -125,18 +136,21 @@ public:
         esop = pkrm;
         cache.emplace( function, esop );
       }
-      else
+      else if ( auto const exact = exact_esop( function ) )
       {
-        auto const& exact = easy::esop::esop_from_tt<kitty::dynamic_truth_table, easy::sat2::maxsat_rc2, easy::esop::helliwell_maxsat>( stats, ps ).synthesize( function, cost_fn );
-
         auto const pprm_Tcost = easy::esop::T_count( pprm, num_controls );
         auto const pkrm_Tcost = easy::esop::T_count( pkrm, num_controls );
-        auto const exact_Tcost = easy::esop::T_count( exact, num_controls );
+        auto const exact_Tcost = easy::esop::T_count( *exact, num_controls );
 
         auto const min = std::min( exact_Tcost, std::min( pprm_Tcost, pkrm_Tcost ) );
-        esop = ( min == exact_Tcost ? exact : ( min == pkrm_Tcost ? pkrm : pprm ) );
+        esop = ( min == exact_Tcost ? *exact : ( min == pkrm_Tcost ? pkrm : pprm ) );
         cache.emplace( function, esop );
       }
+      else
+      {
+        /* cancelled, the fallback is not cached */
+        esop = easy::esop::T_count( pkrm, num_controls ) <= easy::esop::T_count( pprm, num_controls ) ? pkrm : pprm;
+      }
     }
 
     std::vector<tweedledum::qubit_id> target = {qubit_map.back()};
@@ -171,7 +185,44 @@ public:
   }
 
 protected:
-  std::function<int( kitty::cube )> const& cost_fn;
+  /* exact ESOP from the Helliwell decision problem, std::nullopt if cancelled */
+  std::optional<easy::esop::esop_t> exact_esop( kitty::dynamic_truth_table const& function ) const
+  {
+    if ( cancellation.is_cancelled() )
+    {
+      return std::nullopt;
+    }
+
+    int sid{1};
+    easy::esop::detail::helliwell_decision_variables g( sid );
+    std::vector<std::vector<int>> xor_clauses;
+    easy::esop::detail::derive_xor_clauses( xor_clauses, g, function, ~function.construct() );
+
+    easy::sat2::maxsat_solver_statistics stats;
+    easy::sat2::maxsat_solver_params ps;
+    maxsat_rc2_solver solver( stats, ps, sid );
+    for ( auto const& c : easy::esop::detail::translate_to_cnf( sid, xor_clauses, g.size() ) )
+    {
+      solver.add_clause( c );
+    }
+
+    /* one soft clause per cube, which maps onto its decision variable */
+    std::unordered_map<int, int> soft_clause_map;
+    for ( auto const& v : g )
+    {
+      soft_clause_map.emplace( solver.add_soft_clause( {-v.first}, cost_fn( v.second ) ), v.first );
+    }
+
+    if ( solver.solve( cancellation ) != maxsat_rc2_solver::state::success )
+    {
+      return std::nullopt;
+    }
+    return easy::esop::detail::esop_from_clause_selectors( solver.get_disabled_clauses(), g, soft_clause_map );
+  }
+
+protected:
+  std::function<int( kitty::cube )> cost_fn;
+  cancellation_token cancellation;
   mutable std::unordered_map<kitty::dynamic_truth_table, easy::esop::esop_t, kitty::hash<kitty::dynamic_truth_table>> cache;
 };
 
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -56,6 +57,95 @@ struct uncompute_inplace_action
 
 using mapping_strategy_action = std::variant<compute_action, uncompute_action, compute_inplace_action, uncompute_inplace_action>;
 
+/*! \brief Non-owning view of the leaves of an action. */
+class leaves_view
+{
+public:
+  leaves_view( uint32_t const* data, uint32_t size )
+      : _data( data ), _size( size )
+  {
+  }
+
+  leaves_view( std::vector<uint32_t> const& leaves )
+      : _data( leaves.data() ), _size( static_cast<uint32_t>( leaves.size() ) )
+  {
+  }
+
+  uint32_t const* begin() const
+  {
+    return _data;
+  }
+
+  uint32_t const* end() const
+  {
+    return _data + _size;
+  }
+
+  uint32_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0u;
+  }
+
+  uint32_t operator[]( uint32_t i ) const
+  {
+    return _data[i];
+  }
+
+  /*! \brief Copies the leaves into a vector. */
+  std::vector<uint32_t> to_vector() const
+  {
+    return std::vector<uint32_t>( begin(), end() );
+  }
+
+private:
+  uint32_t const* _data;
+  uint32_t _size;
+};
+
+/*! \brief Non-owning view of a cell override. */
+struct cell_view
+{
+  kitty::dynamic_truth_table const& function;
+  leaves_view leaves;
+};
+
+/*! \brief Non-owning views of the actions.
+ *
+ * Views refer to the leaves and functions of an action or of a packed step
+ * and are only valid as long as these are not modified.  They avoid copies
+ * when steps are processed one after another.
+ */
+struct compute_action_view
+{
+  std::optional<leaves_view> leaves;
+  std::optional<cell_view> cell_override;
+};
+
+struct uncompute_action_view
+{
+  std::optional<leaves_view> leaves;
+  std::optional<cell_view> cell_override;
+};
+
+struct compute_inplace_action_view
+{
+  uint32_t target_index;
+  std::optional<leaves_view> leaves;
+};
+
+struct uncompute_inplace_action_view
+{
+  uint32_t target_index;
+  std::optional<leaves_view> leaves;
+};
+
+using mapping_strategy_action_view = std::variant<compute_action_view, uncompute_action_view, compute_inplace_action_view, uncompute_inplace_action_view>;
+
 namespace detail
 {
 template<class... Ts>
@@ -65,6 +155,44 @@ struct overloaded : Ts...
 };
 template<class... Ts>
 overloaded( Ts... )->overloaded<Ts...>;
+
+inline std::optional<leaves_view> view_of( std::optional<std::vector<uint32_t>> const& leaves )
+{
+  if ( !leaves )
+  {
+    return std::nullopt;
+  }
+  return leaves_view( *leaves );
+}
+
+inline std::optional<cell_view> view_of( std::optional<std::pair<kitty::dynamic_truth_table, std::vector<uint32_t>>> const& cell )
+{
+  if ( !cell )
+  {
+    return std::nullopt;
+  }
+  return cell_view{cell->first, leaves_view( cell->second )};
+}
 } // namespace detail
 
+/*! \brief Returns a view of the action, which must outlive the view. */
+inline mapping_strategy_action_view make_action_view( mapping_strategy_action const& action )
+{
+  return std::visit(
+      detail::overloaded{
+          []( compute_action const& a ) -> mapping_strategy_action_view {
+            return compute_action_view{detail::view_of( a.leaves ), detail::view_of( a.cell_override )};
+          },
+          []( uncompute_action const& a ) -> mapping_strategy_action_view {
+            return uncompute_action_view{detail::view_of( a.leaves ), detail::view_of( a.cell_override )};
+          },
+          []( compute_inplace_action const& a ) -> mapping_strategy_action_view {
+            return compute_inplace_action_view{a.target_index, detail::view_of( a.leaves )};
+          },
+          []( uncompute_inplace_action const& a ) -> mapping_strategy_action_view {
+            return uncompute_inplace_action_view{a.target_index, detail::view_of( a.leaves )};
+          }},
+      action );
+}
+
 }
@@ -12,12 +12,17 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "mapping_strategy.hpp"
 
+#include <mockturtle/utils/node_map.hpp>
 #include <mockturtle/views/topo_view.hpp>
 
 #include <fmt/format.h>
@@ -27,6 +32,57 @@ namespace caterpillar
 
 namespace mt = mockturtle;
 
+struct bennett_checkpoint_mapping_strategy_params
+{
+  /*! \brief Number of segments into which each level is split. */
+  uint32_t segments{2u};
+
+  /*! \brief Number of recursion levels (0 is Bennett's strategy). */
+  uint32_t levels{1u};
+};
+
+namespace detail
+{
+
+template<class LogicNetwork>
+class bennett_step_generator : public step_generator<LogicNetwork>
+{
+public:
+  using step_t = typename step_generator<LogicNetwork>::step_t;
+
+  explicit bennett_step_generator( LogicNetwork const& ntk )
+      : walk( ntk )
+  {
+    ntk.foreach_po( [&]( auto const& f ) { drivers.insert( ntk.get_node( f ) ); } );
+  }
+
+protected:
+  bool refill( std::deque<step_t>& steps ) override
+  {
+    if ( const auto n = walk.next() )
+    {
+      steps.emplace_back( *n, compute_action{} );
+      if ( !drivers.count( *n ) )
+        uncompute.push_back( *n );
+      return true;
+    }
+
+    if ( uncompute.empty() )
+      return false;
+
+    steps.emplace_back( uncompute.back(), uncompute_action{} );
+    uncompute.pop_back();
+    return true;
+  }
+
+private:
+  incremental_topo_walk<LogicNetwork> walk;
+  std::unordered_set<mt::node<LogicNetwork>> drivers;
+  std::vector<mt::node<LogicNetwork>> uncompute;
+};
+
+} // namespace detail
+
 /*!   
   \verbatim embed:rst
     A strategy that consists in computing all the nodes in topological order and uncomputing them in inverse topological order. 
@@ -54,24 +110,32 @@ public:
     std::unordered_set<mt::node<LogicNetwork>> drivers;
     ntk.foreach_po( [&]( auto const& f ) { drivers.insert( ntk.get_node( f ) ); } );
 
-    auto it = this->steps().begin();
+    step_builder<LogicNetwork> builder;
     mt::topo_view view{ntk};
     view.foreach_node( [&]( auto n ) {
       if ( ntk.is_constant( n ) || ntk.is_pi( n ) )
         return true;
 
       /* compute step */
-      it = this->steps().insert( it, {n, compute_action{}} );
-      ++it;
+      builder.push_forward( n, compute_action{} );
 
       if ( !drivers.count( n ) )
-        it = this->steps().insert( it, {n, uncompute_action{}} );
+        builder.push_backward( n, uncompute_action{} );
 
       return true;
     } );
+    builder.append_to( this->steps() );
 
     return true;
   }
+
+  /*! Computes the nodes while traversing the network, and stores only the
+   *  nodes that are uncomputed at the end.
+   */
+  std::unique_ptr<step_generator<LogicNetwork>> make_step_generator( LogicNetwork const& ntk ) override
+  {
+    return std::make_unique<detail::bennett_step_generator<LogicNetwork>>( ntk );
+  }
 };
 
 template<class LogicNetwork>
@@ -103,7 +167,7 @@ public:
     ntk.clear_values();
     ntk.foreach_node( [&]( const auto& n ) { ntk.set_value( n, ntk.fanout_size( n ) ); } );
 
-    auto it = this->steps().begin();
+    step_builder<LogicNetwork> builder;
     //mt::topo_view view{ntk};
     ntk.foreach_node( [&]( auto n ) {
       if ( ntk.is_constant( n ) || ntk.is_pi( n ) )
@@ -128,13 +192,8 @@ public:
         {
           if ( ntk.is_xor( n ) )
           {
-            it = this->steps().insert( it, {n, compute_inplace_action{
-                                                   static_cast<uint32_t>(
-                                                       target ), std::nullopt}} );
-            ++it;
-            it = this->steps().insert( it, {n, uncompute_inplace_action{
-                                                   static_cast<uint32_t>(
-                                                       target ), std::nullopt}} );
+            builder.push_forward( n, compute_inplace_action{static_cast<uint32_t>( target ), std::nullopt} );
+            builder.push_backward( n, uncompute_inplace_action{static_cast<uint32_t>( target ), std::nullopt} );
             return true;
           }
         }
@@ -142,30 +201,200 @@ public:
         {
           if ( ntk.is_xor3( n ) )
           {
-            it = this->steps().insert( it, {n, compute_inplace_action{
-                                                   static_cast<uint32_t>(
-                                                       target ), std::nullopt}} );
-            ++it;
-            it = this->steps().insert( it, {n, uncompute_inplace_action{
-                                                   static_cast<uint32_t>(
-                                                       target ), std::nullopt}} );
+            builder.push_forward( n, compute_inplace_action{static_cast<uint32_t>( target ), std::nullopt} );
+            builder.push_backward( n, uncompute_inplace_action{static_cast<uint32_t>( target ), std::nullopt} );
             return true;
           }
         }
       }
 
       /* compute step */
-      it = this->steps().insert( it, {n, compute_action{}} );
-      ++it;
+      builder.push_forward( n, compute_action{} );
 
       if ( !drivers.count( n ) )
-        it = this->steps().insert( it, {n, uncompute_action{}} );
+        builder.push_backward( n, uncompute_action{} );
 
       return true;
     } );
+    builder.append_to( this->steps() );
 
     return true;
   }
 };
 
-} // namespace caterpillar
\ No newline at end of file
+/*! \brief Bennett's time-space tradeoff by recursive checkpointing
+ *
+ * The gates are ordered by their depth, such that the critical path is a
+ * line of `d` levels.  The range of depths is split into `segments` parts
+ * of equal length, recursively for `levels` levels.  A range is pebbled by
+ * pebbling its parts one after the other and then unpebbling all but the
+ * last part in reverse order, keeping only the gates that are used beyond
+ * the range (its checkpoint).  The parts on the last level are pebbled as in
+ * Bennett's strategy.
+ *
+ * For `k` segments and `n` levels, each gate is computed at most `(2k - 1)^n`
+ * times, and the pebbles are the gates of one range on the last level plus
+ * the checkpoints of at most `n (k - 1)` ranges.  The runtime is linear in
+ * the number of steps.
+ */
+template<class LogicNetwork>
+class bennett_checkpoint_mapping_strategy : public mapping_strategy<LogicNetwork>
+{
+  using node = mt::node<LogicNetwork>;
+
+public:
+  bennett_checkpoint_mapping_strategy( bennett_checkpoint_mapping_strategy_params const& ps = {} )
+      : ps( ps )
+  {
+    static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+    static_assert( mt::has_foreach_po_v<LogicNetwork>, "LogicNetwork does not implement the foreach_po method" );
+    static_assert( mt::has_is_constant_v<LogicNetwork>, "LogicNetwork does not implement the is_constant method" );
+    static_assert( mt::has_is_pi_v<LogicNetwork>, "LogicNetwork does not implement the is_pi method" );
+    static_assert( mt::has_get_node_v<LogicNetwork>, "LogicNetwork does not implement the get_node method" );
+    static_assert( mt::has_foreach_fanin_v<LogicNetwork>, "LogicNetwork does not implement the foreach_fanin method" );
+  }
+
+  bool compute_steps( LogicNetwork const& ntk ) override
+  {
+    this->steps().clear();
+    gates.clear();
+    last_use.clear();
+
+    /* gates sorted by depth, stable with respect to a topological order */
+    mt::topo_view view{ntk};
+    mt::node_map<uint32_t, LogicNetwork> depth( ntk, 0u );
+    std::vector<node> topo;
+    uint32_t max_depth{0u};
+    view.foreach_node( [&]( auto const& n ) {
+      if ( ntk.is_constant( n ) || ntk.is_pi( n ) )
+        return;
+      ntk.foreach_fanin( n, [&]( auto const& f ) { depth[n] = std::max( depth[n], depth[ntk.get_node( f )] ); } );
+      max_depth = std::max( max_depth, ++depth[n] );
+      topo.push_back( n );
+    } );
+
+    first.assign( max_depth + 2u, 0u );
+    for ( auto const& n : topo )
+    {
+      ++first[depth[n] + 1u];
+    }
+    for ( auto d = 1u; d < first.size(); ++d )
+    {
+      first[d] += first[d - 1u];
+    }
+    gates.resize( topo.size() );
+    auto next = first;
+    mt::node_map<uint32_t, LogicNetwork> position( ntk );
+    for ( auto const& n : topo )
+    {
+      position[n] = next[depth[n]]++;
+      gates[position[n]] = n;
+    }
+
+    /* last position at which a gate is used, outputs are used at the end */
+    const auto end = static_cast<uint32_t>( gates.size() );
+    last_use.assign( gates.size(), 0u );
+    for ( auto const& n : gates )
+    {
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        if ( !ntk.is_constant( c ) && !ntk.is_pi( c ) )
+        {
+          last_use[position[c]] = std::max( last_use[position[c]], position[n] );
+        }
+      } );
+    }
+    ntk.foreach_po( [&]( auto const& f ) {
+      const auto c = ntk.get_node( f );
+      if ( !ntk.is_constant( c ) && !ntk.is_pi( c ) )
+      {
+        last_use[position[c]] = end;
+      }
+    } );
+
+    pebble( 1u, max_depth + 1u, ps.levels, end + 1u );
+    return true;
+  }
+
+private:
+  /* true, if the gate is still used after position end */
+  bool is_live( uint32_t p, uint32_t end ) const
+  {
+    return last_use[p] >= end;
+  }
+
+  /* splits the depths [lo, hi) into ranges */
+  template<class Fn>
+  void foreach_part( uint32_t lo, uint32_t hi, Fn&& fn ) const
+  {
+    const auto parts = std::min( ps.segments, hi - lo );
+    for ( auto j = 0u; j < parts; ++j )
+    {
+      fn( lo + ( hi - lo ) * j / parts, lo + ( hi - lo ) * ( j + 1u ) / parts, j + 1u == parts );
+    }
+  }
+
+  void move( uint32_t p, bool compute )
+  {
+    if ( compute )
+      this->steps().emplace_back( gates[p], compute_action{} );
+    else
+      this->steps().emplace_back( gates[p], uncompute_action{} );
+  }
+
+  /* pebbles the checkpoint of the gates with depths in [lo, hi), without moves on gates live after skip */
+  void pebble( uint32_t lo, uint32_t hi, uint32_t level, uint32_t skip )
+  {
+    const auto begin = first[lo], end = first[hi];
+    if ( level == 0u || hi - lo <= 1u || ps.segments <= 1u )
+    {
+      for ( auto p = begin; p < end; ++p )
+        if ( !is_live( p, skip ) )
+          move( p, true );
+      for ( auto p = end; p-- > begin; )
+        if ( !is_live( p, end ) )
+          move( p, false );
+      return;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> parts;
+    foreach_part( lo, hi, [&]( auto l, auto h, auto is_last ) {
+      pebble( l, h, level - 1u, skip );
+      if ( !is_last )
+        parts.emplace_back( l, h );
+    } );
+    for ( auto it = parts.rbegin(); it != parts.rend(); ++it )
+      unpebble( it->first, it->second, level - 1u, end );
+  }
+
+  /* reverse of pebble */
+  void unpebble( uint32_t lo, uint32_t hi, uint32_t level, uint32_t skip )
+  {
+    const auto begin = first[lo], end = first[hi];
+    if ( level == 0u || hi - lo <= 1u || ps.segments <= 1u )
+    {
+      for ( auto p = begin; p < end; ++p )
+        if ( !is_live( p, end ) )
+          move( p, true );
+      for ( auto p = end; p-- > begin; )
+        if ( !is_live( p, skip ) )
+          move( p, false );
+      return;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> parts;
+    foreach_part( lo, hi, [&]( auto l, auto h, auto ) { parts.emplace_back( l, h ); } );
+    for ( auto j = 0u; j + 1u < parts.size(); ++j )
+      pebble( parts[j].first, parts[j].second, level - 1u, end );
+    for ( auto it = parts.rbegin(); it != parts.rend(); ++it )
+      unpebble( it->first, it->second, level - 1u, skip );
+  }
+
+private:
+  bennett_checkpoint_mapping_strategy_params ps;
+  std::vector<node> gates;
+  std::vector<uint32_t> first;
+  std::vector<uint32_t> last_use;
+};
+
+} // namespace caterpillar
@@ -232,7 +232,7 @@ private:
         lm_ps.cut_enumeration_ps.cut_size = best_cut_size;
         mt::lut_mapping<decltype( mapped_cut ), true>( mapped_cut, lm_ps );
 
-        auto it = this->steps().end();
+        step_builder<LogicNetwork> builder;
         mt::node<LogicNetwork> po;
         bool is_computing = std::holds_alternative<compute_action>( action );
         cut.foreach_po( [&]( auto f ) {
@@ -251,24 +251,22 @@ private:
           {
             if ( is_computing )
             {
-              it = this->steps().emplace( it, cell, compute_action{{}, std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
+              builder.push_forward( cell, compute_action{{}, std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
             }
             else
             {
-              it = this->steps().emplace( it, cell, uncompute_action{{}, std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
+              builder.push_forward( cell, uncompute_action{{}, std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
             }
-            
-            ++it;
           }
           else
           {
-            it = this->steps().emplace( it, cell, compute_action{{},std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
-            ++it;
-            it = this->steps().emplace( it, cell, uncompute_action{{},std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
+            builder.push_forward( cell, compute_action{{}, std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
+            builder.push_backward( cell, uncompute_action{{}, std::make_pair( mapped_cut.cell_function( cell ), cell_leaves )} );
           }
 
           return true;
         } );
+        builder.append_to( this->steps() );
       }
     }
   }
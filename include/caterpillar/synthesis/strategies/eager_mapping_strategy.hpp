@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
 #include <unordered_set>
 
@@ -27,8 +28,8 @@ template<class LogicNetwork>
 class eager_mapping_strategy_impl
 {
 public:
-  eager_mapping_strategy_impl( LogicNetwork const& ntk, typename mapping_strategy<LogicNetwork>::step_vec_t& steps )
-   : _ntk( ntk ), _steps( steps ), _ref_counts( ntk, 0 )
+  explicit eager_mapping_strategy_impl( LogicNetwork const& ntk )
+   : _ntk( ntk ), _ref_counts( ntk, 0 )
   {
     static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
     static_assert( mt::has_is_constant_v<LogicNetwork>, "LogicNetwork does not implement the is_constant method" );
@@ -38,28 +39,35 @@ public:
     static_assert( mt::has_foreach_po_v<LogicNetwork>, "LogicNetwork does not implement the foreach_po method" );
     static_assert( mt::has_foreach_fanin_v<LogicNetwork>, "LogicNetwork does not implement the foreach_fanin method" );
     static_assert( mt::has_get_node_v<LogicNetwork>, "LogicNetwork does not implement the get_node method" );
-  }
 
-  void run()
-  {
     init_refs();
+  }
 
+  template<class Steps>
+  void run( Steps& steps )
+  {
     mt::topo_view<LogicNetwork> topo{_ntk};
 
     topo.foreach_node( [&]( auto n ) {
       if ( _ntk.is_constant( n ) || _ntk.is_pi( n ) )
         return true;
 
-      _steps.emplace_back( n, compute_action{} );
-      if ( _pos.count( n ) )
-      {
-        uncompute_eagerly( n );
-      }
-
+      process( n, steps );
       return true;
     } );
   }
 
+  /* computes a gate and uncomputes all nodes that are no longer required */
+  template<class Steps>
+  void process( mt::node<LogicNetwork> const& n, Steps& steps )
+  {
+    steps.emplace_back( n, compute_action{} );
+    if ( _pos.count( n ) )
+    {
+      uncompute_eagerly( n, steps );
+    }
+  }
+
 private:
   /* compute reference counters */
   void init_refs()
@@ -72,7 +80,8 @@ private:
     } );
   }
 
-  void uncompute_eagerly( mt::node<LogicNetwork> n )
+  template<class Steps>
+  void uncompute_eagerly( mt::node<LogicNetwork> n, Steps& steps )
   {
     if ( _ntk.is_constant( n ) || _ntk.is_pi( n ) )
       return;
@@ -84,19 +93,44 @@ private:
 
       if ( --_ref_counts[f] == 0u )
       {
-        _steps.emplace_back( child, uncompute_action{} );
-        uncompute_eagerly( child );
+        steps.emplace_back( child, uncompute_action{} );
+        uncompute_eagerly( child, steps );
       }
     } );
   }
 
 private:
   LogicNetwork const& _ntk;
-  typename mapping_strategy<LogicNetwork>::step_vec_t& _steps;
   mt::node_map<uint32_t, LogicNetwork> _ref_counts;
   std::unordered_set<mt::node<LogicNetwork>> _pos;
 };
 
+template<class LogicNetwork>
+class eager_step_generator : public step_generator<LogicNetwork>
+{
+public:
+  using step_t = typename step_generator<LogicNetwork>::step_t;
+
+  explicit eager_step_generator( LogicNetwork const& ntk )
+      : impl( ntk ), walk( ntk )
+  {
+  }
+
+protected:
+  bool refill( std::deque<step_t>& steps ) override
+  {
+    const auto n = walk.next();
+    if ( !n )
+      return false;
+    impl.process( *n, steps );
+    return true;
+  }
+
+private:
+  eager_mapping_strategy_impl<LogicNetwork> impl;
+  incremental_topo_walk<LogicNetwork> walk;
+};
+
 }
 
 /*! 
@@ -114,9 +148,14 @@ class eager_mapping_strategy : public mapping_strategy<LogicNetwork>
 public:
   bool compute_steps( LogicNetwork const& ntk ) override
   {
-    detail::eager_mapping_strategy_impl<LogicNetwork>( ntk, this->steps() ).run();
+    detail::eager_mapping_strategy_impl<LogicNetwork>( ntk ).run( this->steps() );
     return true;
   }
+
+  std::unique_ptr<step_generator<LogicNetwork>> make_step_generator( LogicNetwork const& ntk ) override
+  {
+    return std::make_unique<detail::eager_step_generator<LogicNetwork>>( ntk );
+  }
 };
 
 } // namespace caterpillar
@@ -0,0 +1,599 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken and Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file greedy_pebbling_mapping_strategy.hpp
+  \brief heuristic pebbling under a hard pebble limit
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <mockturtle/traits.hpp>
+#include <mockturtle/utils/node_map.hpp>
+
+#include "mapping_strategy.hpp"
+
+namespace caterpillar
+{
+
+namespace mt = mockturtle;
+
+struct greedy_pebbling_mapping_strategy_params
+{
+  /*! \brief Maximum number of pebbles (0 means no limit). */
+  uint32_t pebble_limit{0u};
+
+  /*! \brief Maximum number of steps (0 means no limit). */
+  uint64_t max_steps{0u};
+};
+
+namespace detail
+{
+
+template<class LogicNetwork>
+class greedy_pebbling_impl
+{
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+public:
+  greedy_pebbling_impl( LogicNetwork const& ntk, greedy_pebbling_mapping_strategy_params const& ps, uint32_t reserve )
+      : ntk( ntk ),
+        ps( ps ),
+        reserve( reserve ),
+        node_to_pos( ntk, none )
+  {
+  }
+
+  template<class Steps>
+  bool run( Steps& steps )
+  {
+    order_gates();
+
+    pebbled.resize( gates.size(), 0u );
+    keep.resize( gates.size(), 0u );
+    pins.resize( gates.size(), 0u );
+    next_use.resize( gates.size(), 0u );
+    supports.resize( gates.size(), 0u );
+    visited.resize( gates.size(), 0u );
+
+    /* compute outputs one after the other and keep them */
+    for ( auto o : outputs )
+    {
+      if ( !ensure( o, steps ) )
+      {
+        return false;
+      }
+      release( o );
+    }
+
+    /* uncompute all other nodes in reverse order, recomputing children if needed */
+    cleanup = true;
+    for ( auto p = 0u; p < gates.size(); ++p )
+    {
+      if ( pebbled[p] && !keep[p] )
+      {
+        pending.push( p );
+      }
+    }
+    while ( !pending.empty() )
+    {
+      const auto p = pending.top();
+      pending.pop();
+      if ( !pebbled[p] || keep[p] )
+      {
+        continue;
+      }
+
+      ++pins[p];
+      for ( auto c : children[p] )
+      {
+        if ( !ensure( c, steps ) )
+        {
+          return false;
+        }
+        ++pins[c];
+      }
+      --pins[p];
+      uncompute( p, steps );
+      for ( auto c : children[p] )
+      {
+        --pins[c];
+      }
+    }
+
+    return !failed;
+  }
+
+private:
+  bool is_gate( mt::node<LogicNetwork> const& n ) const
+  {
+    return !ntk.is_constant( n ) && !ntk.is_pi( n );
+  }
+
+  /* orders all gates in the transitive fanin of the outputs in DFS post-order */
+  void order_gates()
+  {
+    std::vector<std::pair<mt::node<LogicNetwork>, bool>> stack;
+    std::vector<mt::node<LogicNetwork>> fanins;
+
+    ntk.foreach_po( [&]( auto const& f ) {
+      const auto n = ntk.get_node( f );
+      if ( !is_gate( n ) )
+      {
+        return;
+      }
+
+      stack.emplace_back( n, false );
+      while ( !stack.empty() )
+      {
+        const auto [v, expanded] = stack.back();
+        if ( node_to_pos[v] != none )
+        {
+          stack.pop_back();
+          continue;
+        }
+
+        fanins.clear();
+        ntk.foreach_fanin( v, [&]( auto const& g ) {
+          if ( is_gate( ntk.get_node( g ) ) )
+          {
+            fanins.push_back( ntk.get_node( g ) );
+          }
+        } );
+
+        if ( !expanded )
+        {
+          stack.back().second = true;
+          for ( auto it = fanins.rbegin(); it != fanins.rend(); ++it )
+          {
+            if ( node_to_pos[*it] == none )
+            {
+              stack.emplace_back( *it, false );
+            }
+          }
+          continue;
+        }
+
+        stack.pop_back();
+        const auto p = static_cast<uint32_t>( gates.size() );
+        node_to_pos[v] = p;
+        gates.push_back( v );
+        fanouts.emplace_back();
+        children.emplace_back();
+        for ( auto const& c : fanins )
+        {
+          const auto cp = node_to_pos[c];
+          if ( std::find( children[p].begin(), children[p].end(), cp ) == children[p].end() )
+          {
+            children[p].push_back( cp );
+            fanouts[cp].push_back( p );
+          }
+        }
+      }
+
+      outputs.push_back( node_to_pos[n] );
+    } );
+  }
+
+  /* pebbles target, recomputing its transitive fanin if needed */
+  template<class Steps>
+  bool ensure( uint32_t target, Steps& steps )
+  {
+    std::vector<std::pair<uint32_t, uint32_t>> frames;
+    if ( !pebbled[target] )
+    {
+      frames.emplace_back( target, 0u );
+    }
+
+    while ( !frames.empty() )
+    {
+      const auto [p, i] = frames.back();
+      if ( i < children[p].size() )
+      {
+        const auto c = children[p][i];
+        if ( pebbled[c] )
+        {
+          /* children of nodes on the stack are not evicted */
+          ++pins[c];
+          ++frames.back().second;
+        }
+        else
+        {
+          frames.emplace_back( c, 0u );
+        }
+        continue;
+      }
+
+      if ( !make_room( steps ) )
+      {
+        return false;
+      }
+      compute( p, steps );
+      if ( failed )
+      {
+        return false;
+      }
+      for ( auto c : children[p] )
+      {
+        --pins[c];
+      }
+      frames.pop_back();
+    }
+    return true;
+  }
+
+  template<class Steps>
+  bool make_room( Steps& steps )
+  {
+    const auto limit = collecting ? ps.pebble_limit : ps.pebble_limit - reserve;
+    while ( ps.pebble_limit && num_pebbles >= limit )
+    {
+      if ( !evict( steps ) )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /* uncomputes the pebbled node whose next use is farthest away */
+  template<class Steps>
+  bool evict( Steps& steps )
+  {
+    std::vector<std::pair<uint64_t, uint32_t>> pinned;
+    auto evicted = false;
+    while ( !candidates.empty() )
+    {
+      const auto [k, p] = candidates.top();
+      candidates.pop();
+      if ( !pebbled[p] || keep[p] )
+      {
+        continue;
+      }
+      if ( !children_pebbled( p ) )
+      {
+        /* blocked nodes are added again, once their children are recomputed
+         * or their fanouts are uncomputed */
+        if ( supports[p] == 0u )
+        {
+          if ( !pins[p] && collect( p, steps ) )
+          {
+            evicted = true;
+            break;
+          }
+          garbage.push_back( p );
+        }
+        continue;
+      }
+      if ( pins[p] )
+      {
+        pinned.emplace_back( k, p );
+        continue;
+      }
+      if ( const auto current = key( p ); current < k )
+      {
+        candidates.emplace( current, p );
+        continue;
+      }
+
+      uncompute( p, steps );
+      evicted = true;
+      break;
+    }
+
+    for ( auto const& entry : pinned )
+    {
+      candidates.push( entry );
+    }
+    return evicted || collect_deep( steps );
+  }
+
+  /* uncomputes a blocked node without forward use, if its missing transitive
+   * fanin fits into the remaining pebbles */
+  template<class Steps>
+  bool collect( uint32_t p, Steps& steps )
+  {
+    if ( key( p ) >> 32 == 0u || !missing_fanin( p, ps.pebble_limit - num_pebbles ) )
+    {
+      return false;
+    }
+
+    for ( auto c : missing )
+    {
+      compute( c, steps );
+    }
+    uncompute( p, steps );
+    for ( auto c = missing.rbegin(); c != missing.rend(); ++c )
+    {
+      uncompute( *c, steps );
+    }
+    return true;
+  }
+
+  /* uncomputes a blocked node without forward use by recomputing its children with eviction */
+  template<class Steps>
+  bool collect_deep( Steps& steps )
+  {
+    if ( collecting )
+    {
+      return false;
+    }
+    for ( auto i = 0u; i < garbage.size(); )
+    {
+      const auto p = garbage[i];
+      if ( !pebbled[p] || keep[p] || supports[p] != 0u || children_pebbled( p ) )
+      {
+        garbage[i] = garbage.back();
+        garbage.pop_back();
+        continue;
+      }
+      if ( pins[p] || key( p ) >> 32 == 0u )
+      {
+        ++i;
+        continue;
+      }
+      garbage[i] = garbage.back();
+      garbage.pop_back();
+
+      collecting = true;
+      ++pins[p];
+      for ( auto c : children[p] )
+      {
+        if ( !ensure( c, steps ) )
+        {
+          return false;
+        }
+        ++pins[c];
+      }
+      --pins[p];
+      uncompute( p, steps );
+      for ( auto c : children[p] )
+      {
+        --pins[c];
+      }
+      collecting = false;
+      return true;
+    }
+    return false;
+  }
+
+  /* collects the unpebbled transitive fanin of p in topological order, fails if there are more than limit nodes */
+  bool missing_fanin( uint32_t p, uint32_t limit )
+  {
+    missing.clear();
+    ++stamp;
+    auto num_visited = 0u;
+    std::vector<std::pair<uint32_t, uint32_t>> frames{{p, 0u}};
+    while ( !frames.empty() )
+    {
+      const auto [q, i] = frames.back();
+      if ( i < children[q].size() )
+      {
+        ++frames.back().second;
+        const auto c = children[q][i];
+        if ( !pebbled[c] && visited[c] != stamp )
+        {
+          if ( ++num_visited > limit )
+          {
+            return false;
+          }
+          visited[c] = stamp;
+          frames.emplace_back( c, 0u );
+        }
+        continue;
+      }
+      frames.pop_back();
+      if ( q != p )
+      {
+        missing.push_back( q );
+      }
+    }
+    return true;
+  }
+
+  bool children_pebbled( uint32_t p ) const
+  {
+    return std::all_of( children[p].begin(), children[p].end(), [&]( auto c ) { return pebbled[c] != 0u; } );
+  }
+
+  /* Nodes with a larger key are evicted first.  Nodes that are not needed to
+   * uncompute a pebbled fanout are preferred, since evicting them does not
+   * block other nodes.  Within both groups, nodes are ordered by the position
+   * of their next forward use, then by their last pebbled fanout, and nodes
+   * that are no longer needed come first. */
+  uint64_t key( uint32_t p )
+  {
+    const uint64_t free = supports[p] == 0u ? 1u : 0u;
+
+    auto& i = next_use[p];
+    while ( i < fanouts[p].size() && fanouts[p][i] < forward_time )
+    {
+      ++i;
+    }
+    if ( i < fanouts[p].size() )
+    {
+      return ( free << 32 ) | fanouts[p][i];
+    }
+
+    uint32_t last = 0u;
+    for ( auto f : fanouts[p] )
+    {
+      if ( pebbled[f] && !keep[f] )
+      {
+        last = std::max( last, f + 1 );
+      }
+    }
+    return ( free << 32 ) | ( none - last );
+  }
+
+  /* outputs are never uncomputed and do not need their children anymore */
+  void release( uint32_t p )
+  {
+    if ( keep[p] )
+    {
+      return;
+    }
+    keep[p] = 1u;
+    for ( auto c : children[p] )
+    {
+      --supports[c];
+      candidates.emplace( key( c ), c );
+    }
+  }
+
+  template<class Steps>
+  void compute( uint32_t p, Steps& steps )
+  {
+    add_step( steps, p, compute_action{} );
+    pebbled[p] = 1u;
+    ++num_pebbles;
+    forward_time = std::max( forward_time, p + 1 );
+
+    for ( auto c : children[p] )
+    {
+      ++supports[c];
+    }
+    candidates.emplace( key( p ), p );
+    for ( auto f : fanouts[p] )
+    {
+      if ( pebbled[f] )
+      {
+        candidates.emplace( key( f ), f );
+      }
+    }
+    if ( cleanup )
+    {
+      pending.push( p );
+    }
+  }
+
+  template<class Steps>
+  void uncompute( uint32_t p, Steps& steps )
+  {
+    add_step( steps, p, uncompute_action{} );
+    pebbled[p] = 0u;
+    --num_pebbles;
+
+    for ( auto c : children[p] )
+    {
+      --supports[c];
+      if ( pebbled[c] )
+      {
+        candidates.emplace( key( c ), c );
+      }
+    }
+  }
+
+  template<class Steps, class Action>
+  void add_step( Steps& steps, uint32_t p, Action const& action )
+  {
+    steps.emplace_back( gates[p], action );
+    if ( ps.max_steps && ++num_steps > ps.max_steps )
+    {
+      failed = true;
+    }
+  }
+
+private:
+  LogicNetwork const& ntk;
+  greedy_pebbling_mapping_strategy_params const& ps;
+  uint32_t reserve;
+
+  mt::node_map<uint32_t, LogicNetwork> node_to_pos;
+  std::vector<mt::node<LogicNetwork>> gates;
+  std::vector<std::vector<uint32_t>> children;
+  std::vector<std::vector<uint32_t>> fanouts;
+  std::vector<uint32_t> outputs;
+
+  std::vector<uint8_t> pebbled;
+  std::vector<uint8_t> keep;
+  std::vector<uint32_t> pins;
+  std::vector<uint32_t> next_use;
+  std::vector<uint32_t> supports; /* number of pebbled fanouts that are not kept */
+  std::vector<uint32_t> visited;
+  std::vector<uint32_t> garbage;
+  std::vector<uint32_t> missing;
+  uint32_t stamp{0u};
+  uint32_t num_pebbles{0u};
+  uint32_t forward_time{0u};
+  uint64_t num_steps{0u};
+  bool cleanup{false};
+  bool failed{false};
+  bool collecting{false};
+
+  std::priority_queue<std::pair<uint64_t, uint32_t>> candidates;
+  std::priority_queue<uint32_t> pending;
+};
+
+} // namespace detail
+
+/*! \brief Heuristic pebbling under a hard pebble limit
+ *
+ * Outputs are computed one after the other, recomputing uncomputed nodes on
+ * demand.  If the pebble limit is reached, a pebbled node whose children are
+ * pebbled is uncomputed, preferring nodes that are not needed to uncompute
+ * their fanouts and then the node whose next use in the computation order is
+ * farthest away.  Nodes that are no longer needed, but whose children have
+ * been uncomputed, are uncomputed by recomputing their missing transitive
+ * fanin in a number of reserved pebbles.  Finally, all non-output nodes are
+ * uncomputed in reverse order.
+ *
+ * The search is repeated with a doubled number of reserved pebbles, until it
+ * succeeds or half of the pebbles are reserved.  Without pebble limit, the
+ * strategy is equivalent to the Bennett strategy.  Fails, if the pebble limit
+ * is too small to make progress or the step limit is exceeded.
+ */
+template<class LogicNetwork>
+class greedy_pebbling_mapping_strategy : public mapping_strategy<LogicNetwork>
+{
+public:
+  greedy_pebbling_mapping_strategy( greedy_pebbling_mapping_strategy_params const& ps = {} )
+      : ps( ps )
+  {
+    static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+    static_assert( mt::has_is_constant_v<LogicNetwork>, "LogicNetwork does not implement the is_constant method" );
+    static_assert( mt::has_is_pi_v<LogicNetwork>, "LogicNetwork does not implement the is_pi method" );
+    static_assert( mt::has_foreach_po_v<LogicNetwork>, "LogicNetwork does not implement the foreach_po method" );
+    static_assert( mt::has_foreach_fanin_v<LogicNetwork>, "LogicNetwork does not implement the foreach_fanin method" );
+    static_assert( mt::has_get_node_v<LogicNetwork>, "LogicNetwork does not implement the get_node method" );
+  }
+
+  bool compute_steps( LogicNetwork const& ntk ) override
+  {
+    for ( auto reserve = 0u; ; reserve = std::max( 2 * reserve, 2u ) )
+    {
+      if ( ps.pebble_limit && reserve > ps.pebble_limit / 2 )
+      {
+        return false;
+      }
+
+      this->steps().clear();
+      detail::greedy_pebbling_impl<LogicNetwork> impl( ntk, ps, reserve );
+      if ( impl.run( this->steps() ) )
+      {
+        return true;
+      }
+      this->steps().clear();
+
+      if ( !ps.pebble_limit )
+      {
+        return false;
+      }
+    }
+  }
+
+private:
+  greedy_pebbling_mapping_strategy_params ps;
+};
+
+} // namespace caterpillar
@@ -11,48 +11,281 @@
 */
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 #include <fmt/format.h>
 
 #include <mockturtle/traits.hpp>
+#include <mockturtle/utils/node_map.hpp>
 
+#include "../../structures/cancellation_token.hpp"
 #include "action.hpp"
+#include "step_store.hpp"
 
 namespace caterpillar
 {
 
+/*! \brief Builds a step sequence from both ends in linear time.
+ *
+ * Many strategies compute nodes in some order and uncompute them in the
+ * reverse order.  Forward steps are appended to the front part of the
+ * sequence, backward steps are pushed to the back part, which is emitted in
+ * reverse order, i.e., the backward step that is pushed last is the first
+ * one after all forward steps.  A block of backward steps keeps its order.
+ */
+template<class LogicNetwork>
+class step_builder
+{
+public:
+  using step_t = std::pair<mockturtle::node<LogicNetwork>, mapping_strategy_action>;
+
+  void push_forward( mockturtle::node<LogicNetwork> const& n, mapping_strategy_action const& action )
+  {
+    forward.emplace_back( n, action );
+  }
+
+  template<class Iterator>
+  void push_forward( Iterator begin, Iterator end )
+  {
+    forward.insert( forward.end(), begin, end );
+  }
+
+  void push_backward( mockturtle::node<LogicNetwork> const& n, mapping_strategy_action const& action )
+  {
+    backward.emplace_back( n, action );
+  }
+
+  template<class Iterator>
+  void push_backward( Iterator begin, Iterator end )
+  {
+    backward.insert( backward.end(), std::make_reverse_iterator( end ), std::make_reverse_iterator( begin ) );
+  }
+
+  /*! \brief Appends the sequence to `steps` and clears the builder. */
+  template<class Steps>
+  void append_to( Steps& steps )
+  {
+    steps.reserve( steps.size() + forward.size() + backward.size() );
+    for ( auto const& [n, action] : forward )
+    {
+      steps.emplace_back( n, action );
+    }
+    for ( auto it = backward.rbegin(); it != backward.rend(); ++it )
+    {
+      steps.emplace_back( it->first, it->second );
+    }
+    forward.clear();
+    backward.clear();
+  }
+
+private:
+  std::vector<step_t> forward;
+  std::vector<step_t> backward;
+};
+
+namespace detail
+{
+
+/*! \brief Visits the gates of a network in topological order, one at a time.
+ *
+ * The order is the same as in `mockturtle::topo_view`, but the traversal
+ * only keeps the current DFS path and a visited flag per node.
+ */
+template<class LogicNetwork>
+class incremental_topo_walk
+{
+public:
+  using node = mockturtle::node<LogicNetwork>;
+
+  explicit incremental_topo_walk( LogicNetwork const& ntk )
+      : ntk( ntk ), visited( ntk, 0u )
+  {
+    ntk.foreach_po( [&]( auto const& f ) { roots.push_back( ntk.get_node( f ) ); } );
+  }
+
+  /*! Returns the next gate, or `std::nullopt` after the last gate.
+   */
+  std::optional<node> next()
+  {
+    while ( true )
+    {
+      if ( stack.empty() )
+      {
+        if ( next_root == roots.size() )
+          return std::nullopt;
+        stack.emplace_back( roots[next_root++], false );
+      }
+
+      const auto [n, expanded] = stack.back();
+      stack.pop_back();
+      if ( expanded )
+        return n;
+      if ( ntk.is_constant( n ) || ntk.is_pi( n ) || visited[n] )
+        continue;
+
+      visited[n] = 1u;
+      stack.emplace_back( n, true );
+      const auto first_child = stack.size();
+      ntk.foreach_fanin( n, [&]( auto const& f ) { stack.emplace_back( ntk.get_node( f ), false ); } );
+      std::reverse( stack.begin() + first_child, stack.end() );
+    }
+  }
+
+private:
+  LogicNetwork const& ntk;
+  mockturtle::node_map<uint8_t, LogicNetwork> visited;
+  std::vector<node> roots;
+  std::size_t next_root{0u};
+  std::vector<std::pair<node, bool>> stack;
+};
+
+} // namespace detail
+
+/*! \brief Produces the steps of a mapping strategy on demand.
+ *
+ * Implementations refill a buffer with the steps of one or more nodes at a
+ * time, such that steps can be consumed while the network is traversed.
+ */
+template<class LogicNetwork>
+class step_generator
+{
+public:
+  using step_t = std::pair<mockturtle::node<LogicNetwork>, mapping_strategy_action>;
+
+  virtual ~step_generator() = default;
+
+  /*! Returns the next step, or `std::nullopt` after the last step or if the
+   *  generator failed.
+   */
+  std::optional<step_t> next()
+  {
+    while ( buffer.empty() )
+    {
+      if ( _failed || _cancellation.is_cancelled() )
+      {
+        _failed = true;
+        return std::nullopt;
+      }
+      if ( !refill( buffer ) )
+        return std::nullopt;
+    }
+    /* constructed in place, a moved-into local step triggers -Wmaybe-uninitialized in GCC 12 */
+    std::optional<step_t> step{std::in_place, std::move( buffer.front() )};
+    buffer.pop_front();
+    return step;
+  }
+
+  /*! Returns true, if the generated steps are incomplete, because the
+   *  generator was cancelled or could not produce further steps.
+   */
+  bool failed() const
+  {
+    return _failed;
+  }
+
+  /*! Sets the token that stops the generation of further steps.
+   */
+  void set_cancellation( cancellation_token const& token )
+  {
+    _cancellation = token;
+  }
+
+protected:
+  /*! Appends further steps to `steps`, returns false if there are none.
+   *  Implementations call `fail` before returning false, if the steps are
+   *  incomplete.
+   */
+  virtual bool refill( std::deque<step_t>& steps ) = 0;
+
+  void fail()
+  {
+    _failed = true;
+  }
+
+private:
+  std::deque<step_t> buffer;
+  cancellation_token _cancellation;
+  bool _failed{false};
+};
 
 template<class LogicNetwork>
 class mapping_strategy
 {
 public:
   using step_function_t = std::function<void( mockturtle::node<LogicNetwork> const&, mapping_strategy_action const& )>;
+  using step_view_function_t = std::function<void( mockturtle::node<LogicNetwork> const&, mapping_strategy_action_view const& )>;
   using step_vec_t = std::vector<std::pair<mockturtle::node<LogicNetwork>, mapping_strategy_action>>;
 
   /*! Takes the logic network as input and defines the strategy's steps sequence.
    */
   virtual bool compute_steps( LogicNetwork const& ntk ) = 0;
 
+  /*! Returns a generator that produces the steps for the logic network on
+   *  demand, without storing them in the strategy.  Returns `nullptr`, if the
+   *  strategy can only compute all steps at once with `compute_steps`.
+   */
+  virtual std::unique_ptr<step_generator<LogicNetwork>> make_step_generator( LogicNetwork const& ntk )
+  {
+    (void)ntk;
+    return nullptr;
+  }
+
   /*! Iterates through the strategy's steps applying the given function.
    */
   void foreach_step( step_function_t const& fn ) const
   {
-    for ( auto const& [n, a] : _steps )
-    {
-      fn( n, a );
-    }
+    _steps.foreach_step( fn );
+  }
+
+  /*! Iterates through the strategy's steps as views, which refer to the
+   *  leaves and cell functions of the stored steps instead of copying them.
+   */
+  void foreach_step_view( step_view_function_t const& fn ) const
+  {
+    _steps.foreach_step_view( fn );
+  }
+
+  /*! Returns the number of steps.
+   */
+  std::size_t num_steps() const
+  {
+    return _steps.size();
+  }
+
+  /*! Sets the token that stops the computation of the steps.
+   *
+   *  Strategies that support cancellation check the token between expensive
+   *  calls and keep the best schedule found so far.  The documentation of
+   *  each strategy describes its result after cancellation; strategies that
+   *  do not mention the token run to completion.
+   */
+  void set_cancellation( cancellation_token const& token )
+  {
+    _cancellation = token;
   }
 
 protected:
-  step_vec_t& steps()
+  step_store<LogicNetwork>& steps()
   {
     return _steps;
   }
 
+  cancellation_token const& cancellation() const
+  {
+    return _cancellation;
+  }
+
 private:
-  step_vec_t _steps;
+  step_store<LogicNetwork> _steps;
+  cancellation_token _cancellation;
 };
 
 template<class MappingStrategy>
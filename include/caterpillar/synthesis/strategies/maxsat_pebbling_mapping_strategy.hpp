@@ -0,0 +1,264 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file maxsat_pebbling_mapping_strategy.hpp
+  \brief pebbling with minimum cost of moves by MaxSAT
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include <easy/sat2/cardinality.hpp>
+#include <easy/sat2/maxsat.hpp>
+#include <fmt/format.h>
+#include <mockturtle/traits.hpp>
+#include <mockturtle/utils/node_map.hpp>
+
+#include "../../solvers/maxsat_rc2.hpp"
+#include "mapping_strategy.hpp"
+
+namespace caterpillar
+{
+
+namespace mt = mockturtle;
+
+struct maxsat_pebbling_mapping_strategy_params
+{
+  /*! \brief Maximum number of pebbles (0 means no limit). */
+  uint32_t pebble_limit{0u};
+
+  /*! \brief Number of steps of the game (0 means twice the number of gates).
+   *
+   * Steps in which no pebble changes are free, such that the schedule has
+   * minimum cost among all schedules with at most this number of steps.
+   */
+  uint32_t num_steps{0u};
+
+  /*! \brief Cost of each move of the gate with the given node index.
+   *
+   * For example, the T-count of the gate.  Costs of 0 are counted as 1, and
+   * all moves cost 1, if no function is given.  Values of the network are
+   * not used implicitly, a cost function may return `ntk.value( n )`.
+   */
+  std::function<uint32_t( uint32_t )> move_cost{};
+};
+
+struct maxsat_pebbling_mapping_strategy_stats
+{
+  /*! \brief Number of variables. */
+  uint64_t num_vars{0};
+
+  /*! \brief Number of hard clauses. */
+  uint64_t num_clauses{0};
+
+  /*! \brief Total cost of the moves in the schedule. */
+  uint64_t cost{0};
+
+  void report() const
+  {
+    std::cout << fmt::format( "[i] MaxSAT variables = {}   hard clauses = {}   cost = {}\n", num_vars, num_clauses, cost );
+  }
+};
+
+/*! \brief Pebbling with minimum number or cost of moves
+ *
+ * The reversible pebbling game is encoded once for a fixed number of steps,
+ * with the pebble limit as hard cardinality constraint in each step, and a
+ * soft clause for each possible move of a gate in each step.  A single call
+ * of the RC2 MaxSAT algorithm returns a schedule that minimizes the total
+ * weight of all compute and uncompute moves.  Fails, if there is no schedule
+ * within the number of steps.
+ *
+ * The token set with `set_cancellation` is checked between the iterations of
+ * RC2.  Since RC2 only finds a schedule in its last iteration, the strategy
+ * fails without steps when it is cancelled.
+ */
+template<class LogicNetwork>
+class maxsat_pebbling_mapping_strategy : public mapping_strategy<LogicNetwork>
+{
+public:
+  maxsat_pebbling_mapping_strategy( maxsat_pebbling_mapping_strategy_params const& ps = {}, maxsat_pebbling_mapping_strategy_stats* pst = nullptr )
+      : ps( ps ),
+        pst( pst )
+  {
+    static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+    static_assert( mt::has_is_constant_v<LogicNetwork>, "LogicNetwork does not implement the is_constant method" );
+    static_assert( mt::has_is_pi_v<LogicNetwork>, "LogicNetwork does not implement the is_pi method" );
+    static_assert( mt::has_foreach_fanin_v<LogicNetwork>, "LogicNetwork does not implement the foreach_fanin method" );
+    static_assert( mt::has_foreach_gate_v<LogicNetwork>, "LogicNetwork does not implement the foreach_gate method" );
+    static_assert( mt::has_foreach_po_v<LogicNetwork>, "LogicNetwork does not implement the foreach_po method" );
+    static_assert( mt::has_get_node_v<LogicNetwork>, "LogicNetwork does not implement the get_node method" );
+  }
+
+  bool compute_steps( LogicNetwork const& ntk ) override
+  {
+    this->steps().clear();
+    if ( this->cancellation().is_cancelled() )
+    {
+      return false;
+    }
+
+    std::vector<mt::node<LogicNetwork>> gates;
+    mt::node_map<uint32_t, LogicNetwork> gate_index( ntk );
+    ntk.foreach_gate( [&]( auto const& n ) {
+      gate_index[n] = static_cast<uint32_t>( gates.size() );
+      gates.push_back( n );
+    } );
+    const auto num_gates = static_cast<uint32_t>( gates.size() );
+
+    std::vector<uint8_t> is_output( num_gates, 0u );
+    uint32_t num_outputs{0u};
+    ntk.foreach_po( [&]( auto const& f ) {
+      const auto n = ntk.get_node( f );
+      if ( !ntk.is_constant( n ) && !ntk.is_pi( n ) && !is_output[gate_index[n]] )
+      {
+        is_output[gate_index[n]] = 1u;
+        ++num_outputs;
+      }
+    } );
+    if ( num_outputs == 0u )
+    {
+      return true;
+    }
+    if ( ps.pebble_limit && ps.pebble_limit < num_outputs )
+    {
+      return false;
+    }
+
+    std::vector<int> weights( num_gates, 1 );
+    if ( ps.move_cost )
+    {
+      for ( auto i = 0u; i < num_gates; ++i )
+      {
+        weights[i] = std::max<int>( 1, static_cast<int>( ps.move_cost( ntk.node_to_index( gates[i] ) ) ) );
+      }
+    }
+
+    /* pebble variables of all steps come first, auxiliary variables are allocated from sid */
+    const auto num_steps = ps.num_steps ? ps.num_steps : 2u * num_gates;
+    const auto pebble = [&]( uint32_t step, uint32_t i ) { return static_cast<int>( 1u + step * num_gates + i ); };
+    int sid = pebble( num_steps + 1u, 0u );
+
+    easy::sat2::maxsat_solver_statistics maxsat_stats;
+    easy::sat2::maxsat_solver_params maxsat_ps;
+    maxsat_rc2_solver solver( maxsat_stats, maxsat_ps, sid );
+    uint64_t num_clauses{0u};
+    const auto add_clause = [&]( std::vector<int> const& clause ) {
+      solver.add_clause( clause );
+      ++num_clauses;
+    };
+
+    for ( auto i = 0u; i < num_gates; ++i )
+    {
+      add_clause( {-pebble( 0u, i )} );
+      add_clause( {is_output[i] ? pebble( num_steps, i ) : -pebble( num_steps, i )} );
+    }
+
+    std::vector<int> inputs( num_gates );
+    for ( auto step = 0u; step < num_steps; ++step )
+    {
+      for ( auto i = 0u; i < num_gates; ++i )
+      {
+        const auto p = pebble( step, i );
+        const auto p_next = pebble( step + 1u, i );
+
+        /* the children of a gate are pebbled in both steps, if the gate changes */
+        ntk.foreach_fanin( gates[i], [&]( auto const& f ) {
+          const auto c = ntk.get_node( f );
+          if ( ntk.is_constant( c ) || ntk.is_pi( c ) )
+          {
+            return;
+          }
+          for ( auto ch : {pebble( step, gate_index[c] ), pebble( step + 1u, gate_index[c] )} )
+          {
+            add_clause( {-p, p_next, ch} );
+            add_clause( {p, -p_next, ch} );
+          }
+        } );
+
+        /* a move costs the weight of the gate */
+        const auto move = sid++;
+        add_clause( {-p, p_next, move} );
+        add_clause( {p, -p_next, move} );
+        solver.add_soft_clause( {-move}, weights[i] );
+      }
+
+      if ( ps.pebble_limit && ps.pebble_limit < num_gates )
+      {
+        for ( auto i = 0u; i < num_gates; ++i )
+        {
+          inputs[i] = pebble( step + 1u, i );
+        }
+        std::vector<std::vector<int>> clauses;
+        const auto counter = easy::sat2::create_totalizer( clauses, sid, inputs, ps.pebble_limit );
+        for ( auto const& clause : clauses )
+        {
+          add_clause( clause );
+        }
+        if ( counter->vars.size() > ps.pebble_limit )
+        {
+          add_clause( {-counter->vars[ps.pebble_limit]} );
+        }
+      }
+    }
+
+    if ( pst )
+    {
+      pst->num_vars += static_cast<uint64_t>( sid - 1 );
+      pst->num_clauses += num_clauses;
+    }
+
+    if ( solver.solve( this->cancellation() ) != maxsat_rc2_solver::state::success )
+    {
+      return false;
+    }
+
+    /* in each step, the uncompute moves precede the compute moves */
+    const auto model = solver.model();
+    uint64_t cost{0u};
+    for ( auto step = 1u; step <= num_steps; ++step )
+    {
+      for ( auto compute : {false, true} )
+      {
+        for ( auto i = 0u; i < num_gates; ++i )
+        {
+          const auto before = model[pebble( step - 1u, i )];
+          const auto after = model[pebble( step, i )];
+          if ( before != after && after == compute )
+          {
+            if ( compute )
+            {
+              this->steps().emplace_back( gates[i], compute_action{} );
+            }
+            else
+            {
+              this->steps().emplace_back( gates[i], uncompute_action{} );
+            }
+            cost += weights[i];
+          }
+        }
+      }
+    }
+    if ( pst )
+    {
+      pst->cost += cost;
+    }
+
+    return true;
+  }
+
+private:
+  maxsat_pebbling_mapping_strategy_params ps;
+  maxsat_pebbling_mapping_strategy_stats* pst;
+};
+
+} // namespace caterpillar
@@ -7,12 +7,25 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "greedy_pebbling_mapping_strategy.hpp"
 #include "mapping_strategy.hpp"
 #include "../../solvers/bsat_solver.hpp"
+#include "../../solvers/sat_backend.hpp"
 
+#include <fmt/format.h>
 #include <mockturtle/utils/progress_bar.hpp>
 
 namespace caterpillar
@@ -31,6 +44,14 @@ struct pebbling_mapping_strategy_params
   /*! \brief Maximum number of steps */
   uint32_t max_steps{100000};
 
+  /*! \brief Double the number of steps until a schedule is found, then bisect.
+   *
+   * By default, the number of steps is incremented by one, starting from a
+   * structural lower bound.  The exponential search finds a schedule with the
+   * smallest number of steps with fewer SAT calls on deep networks.
+   */
+  bool exponential_step_search{false};
+
   /*! \brief Conflict limit for the SAT solver (0 means no limit). */
   uint32_t conflict_limit{0u};
 
@@ -40,20 +61,115 @@ struct pebbling_mapping_strategy_params
   /*! \brief Decrement pebble numbers, if satisfiable. */
   bool decrement_on_success{false};
 
+  /*! \brief Number of pebble limits that are searched in parallel (1 disables the portfolio search).
+   *
+   * The portfolio search tries limits between the number of outputs and
+   * `pebble_limit` (or the number of gates, if no limit is given) and returns
+   * the schedule for the smallest satisfiable limit.
+   */
+  uint32_t num_threads{1u};
+
+  /*! \brief Encoding of the pebble limit in each step. */
+  cardinality_encoding encoding{cardinality_encoding::totalizer};
+
+  /*! \brief Maximum total weight of all compute and uncompute steps (0 means no limit).
+   *
+   * The weight of each step is given by `move_weight`.
+   */
+  uint32_t max_weight{0u};
+
+  /*! \brief Weight of each move of the gate with the given node index.
+   *
+   * For example, the T-count of the gate or the size of its ESOP.  All moves
+   * weigh 1, if no function is given.  Values of the network are not used
+   * implicitly, a weight function may return `ntk.value( n )`.
+   */
+  std::function<uint32_t( uint32_t )> move_weight{};
+
+  /*! \brief Maximum number of compute and uncompute moves in each step (0 means no limit).
+   *
+   * A gate and its children never change in the same step.  A small bound
+   * gives more steps with fewer moves each, a large bound favors schedules
+   * with shallow layers of moves that are applied in parallel.
+   */
+  uint32_t max_moves_per_step{0u};
+
+  /*! \brief Seed the search with a schedule of the greedy pebbling strategy.
+   *
+   * The greedy schedule for the same pebble limit, with its moves packed into
+   * steps, bounds the number of steps to search.  It is returned, if the SAT
+   * solver finds no schedule within this bound and the conflict limit.
+   */
+  bool warm_start{false};
+
+  /*! \brief SAT solver. */
+  sat_backend backend{sat_backend::bsat};
+};
+
+struct pebbling_mapping_strategy_stats
+{
+  /*! \brief Number of SAT variables over all solvers. */
+  uint64_t num_vars{0};
+
+  /*! \brief Number of SAT clauses over all solvers. */
+  uint64_t num_clauses{0};
+
+  /*! \brief Variables and clauses of the cardinality constraints. */
+  cardinality_stats cardinality;
+
+  void report() const
+  {
+    std::cout << fmt::format( "[i] SAT variables = {}   SAT clauses = {}\n", num_vars, num_clauses );
+    cardinality.report();
+  }
 };
 
+namespace detail
+{
+
+/*! \brief Orders the values in [lower, upper] by repeated bisection, starting with upper. */
+inline std::vector<uint32_t> bisection_order( uint32_t lower, uint32_t upper )
+{
+  std::vector<uint32_t> order{upper};
+  std::deque<std::pair<uint32_t, uint32_t>> intervals{{lower, upper - 1}};
+  while ( !intervals.empty() )
+  {
+    const auto [l, u] = intervals.front();
+    intervals.pop_front();
+    if ( l > u )
+    {
+      continue;
+    }
+    const auto m = l + ( u - l ) / 2;
+    order.push_back( m );
+    if ( m > l )
+    {
+      intervals.emplace_back( l, m - 1 );
+    }
+    intervals.emplace_back( m + 1, u );
+  }
+  return order;
+}
+
+} // namespace detail
+
 /*!
   \verbatim embed:rst
   The pebbling strategy is obtained by solving iteratively the reversible pebbling game on the given network.
   The problem is encoded as a SAT problem. Details can be found in :cite:`MS19`.
+
+  When the strategy is cancelled, the search stops before the next solver
+  call.  The schedule for the smallest pebble limit solved so far, or the
+  warm-start schedule, is kept; without any schedule the strategy fails.
   \endverbatim
 */
 template<class LogicNetwork>
 class pebbling_mapping_strategy : public mapping_strategy<LogicNetwork>
 {
 public:
-  pebbling_mapping_strategy( pebbling_mapping_strategy_params const& ps = {} )
-    : ps( ps )
+  pebbling_mapping_strategy( pebbling_mapping_strategy_params const& ps = {}, pebbling_mapping_strategy_stats* pst = nullptr )
+    : ps( ps ),
+      pst( pst )
   {
     static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
     static_assert( mt::has_is_pi_v<LogicNetwork>, "LogicNetwork does not implement the is_pi method" );
@@ -65,61 +181,386 @@ public:
   }
 
   bool compute_steps( LogicNetwork const& ntk ) override
+  {
+    return dispatch_sat_backend( ps.backend, [&]( auto tag ) {
+      using Solver = std::remove_pointer_t<decltype( tag )>;
+      return ps.num_threads > 1u ? compute_steps_portfolio<Solver>( ntk ) : compute_steps_sequential<Solver>( ntk );
+    } );
+  }
+
+private:
+  template<class Solver>
+  bool compute_steps_sequential( LogicNetwork const& ntk )
   {
     assert( !ps.decrement_on_success || !ps.increment_on_timeout );
-    std::vector<std::pair<mockturtle::node<LogicNetwork>, mapping_strategy_action>> store_steps;
     auto limit = ps.pebble_limit;
-    unsigned max_steps = ps.max_steps;
-    while ( true )
+    if ( limit == 0u && ps.decrement_on_success )
     {
-      pebble_solver<LogicNetwork> solver( ntk, limit );
-      solver.initialize();
-
-      mockturtle::progress_bar bar( 100, "|{0}| current step = {1}", ps.progress );
-      percy::synth_result result;
+      limit = ntk.num_gates();
+    }
 
-      do
+    /* a smaller limit is selected in the same solver, a larger one requires a new solver */
+    std::unique_ptr<pebble_solver<LogicNetwork, Solver>> solver;
+    uint32_t first_step{1u};
+    while ( true )
+    {
+      if ( solver && limit <= solver->max_pebbles() )
+      {
+        solver->set_pebbles( limit );
+      }
+      else
       {
-        if ( solver.current_step() >= max_steps )
+        if ( solver )
         {
-          result = percy::timeout;
-          break;
+          record( *solver );
         }
+        solver = std::make_unique<pebble_solver<LogicNetwork, Solver>>( ntk, limit, ps.encoding, ps.max_weight, ps.max_moves_per_step, ps.move_weight );
+        solver->initialize();
+      }
 
-        bar( std::min<uint32_t>( solver.current_step(), 100 ), solver.current_step() );
-        solver.add_step();
-        result = solver.solve( ps.conflict_limit );
-      } while ( result == percy::failure );
+      mockturtle::progress_bar bar( 100, "|{0}| current step = {1}", ps.progress );
+
+      step_store<LogicNetwork> warm_steps;
+      const auto horizon = ps.warm_start ? warm_start( ntk, limit, warm_steps ) : 0u;
+
+      /* no schedule for the previous limit has fewer steps, so the search continues from the previous number of steps */
+      step_store<LogicNetwork> steps;
+      uint32_t num_steps{0u};
+      auto result = search_steps( *solver, std::max( first_step, solver->lower_bound_steps() ), horizon, steps, num_steps, [&]( uint32_t step ) {
+        bar( std::min<uint32_t>( step, 100 ), step );
+        return false;
+      } );
+      const auto use_warm_steps = result != percy::success && horizon != 0u;
+      if ( use_warm_steps )
+      {
+        result = percy::success;
+      }
+      if ( result == percy::failure )
+      {
+        result = percy::timeout;
+      }
 
       if ( result == percy::timeout )
       {
-        if ( ps.increment_on_timeout )
+        if ( ps.increment_on_timeout && !this->cancellation().is_cancelled() )
         {
           limit++;
           continue;
         }
         else if ( !ps.decrement_on_success )
+        {
+          record( *solver );
           return false;
+        }
       }
       else if ( result == percy::success )
       {
-        this->steps() = solver.extract_result();
-        if ( ps.decrement_on_success )
+        if ( use_warm_steps )
+        {
+          this->steps() = std::move( warm_steps );
+        }
+        else
+        {
+          this->steps() = std::move( steps );
+          first_step = num_steps;
+        }
+        if ( ps.decrement_on_success && limit > 1u && !this->cancellation().is_cancelled() )
         {
           limit--;
           continue;
         }
       }
 
-      if ( this->steps().empty() )
-        return false;
+      record( *solver );
+      return !this->steps().empty();
+    }
+  }
+
+  /* Searches several pebble limits at once.  A schedule for limit `l` is also a
+   * schedule for all larger limits, and a limit without a schedule within
+   * `max_steps` steps has no smaller limit with such a schedule.  Limits outside
+   * of these two bounds are cancelled between two solver calls. */
+  template<class Solver>
+  bool compute_steps_portfolio( LogicNetwork const& ntk )
+  {
+    std::unordered_set<mockturtle::node<LogicNetwork>> outputs;
+    ntk.foreach_po( [&]( auto const& f ) {
+      const auto n = ntk.get_node( f );
+      if ( !ntk.is_constant( n ) && !ntk.is_pi( n ) )
+      {
+        outputs.insert( n );
+      }
+    } );
+
+    const auto lower = std::max<uint32_t>( 1u, static_cast<uint32_t>( outputs.size() ) );
+    const auto upper = ps.pebble_limit ? ps.pebble_limit : ntk.num_gates();
+    if ( upper < lower )
+    {
+      return false;
+    }
+
+    const auto limits = detail::bisection_order( lower, upper );
+    std::atomic<uint32_t> next{0u};
+    std::atomic<uint32_t> best_sat{upper + 1u};
+    std::atomic<uint32_t> unsat_bound{lower - 1u};
+    std::mutex mutex;
+    step_store<LogicNetwork> best_steps;
+
+    const auto is_cancelled = [&]( uint32_t limit ) {
+      return limit >= best_sat.load() || limit <= unsat_bound.load() || this->cancellation().is_cancelled();
+    };
+    const auto update = []( std::atomic<uint32_t>& bound, uint32_t value, auto&& better ) {
+      auto current = bound.load();
+      while ( better( value, current ) && !bound.compare_exchange_weak( current, value ) )
+        ;
+    };
+
+    const auto worker = [&]() {
+      for ( auto i = next++; i < limits.size(); i = next++ )
+      {
+        const auto limit = limits[i];
+        if ( is_cancelled( limit ) )
+        {
+          continue;
+        }
+
+        pebble_solver<LogicNetwork, Solver> solver( ntk, limit, ps.encoding, ps.max_weight, ps.max_moves_per_step, ps.move_weight );
+        solver.initialize();
+
+        step_store<LogicNetwork> warm_steps;
+        const auto horizon = ps.warm_start ? warm_start( ntk, limit, warm_steps ) : 0u;
+
+        step_store<LogicNetwork> steps;
+        uint32_t num_steps{0u};
+        const auto result = search_steps( solver, solver.lower_bound_steps(), horizon, steps, num_steps, [&]( uint32_t ) { return is_cancelled( limit ); } );
+
+        std::lock_guard<std::mutex> lock( mutex );
+        record( solver );
+        if ( result == percy::success || horizon != 0u )
+        {
+          if ( limit < best_sat.load() )
+          {
+            best_steps = std::move( result == percy::success ? steps : warm_steps );
+            update( best_sat, limit, std::less<uint32_t>() );
+          }
+        }
+        else if ( result == percy::failure && !is_cancelled( limit ) )
+        {
+          update( unsat_bound, limit, std::greater<uint32_t>() );
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for ( auto t = 0u; t < ps.num_threads; ++t )
+    {
+      threads.emplace_back( worker );
+    }
+    for ( auto& t : threads )
+    {
+      t.join();
+    }
+
+    this->steps() = std::move( best_steps );
+    return !this->steps().empty();
+  }
+
+  /* Finds the smallest number of steps from `first` on, for which the solver
+   * has a schedule, and extracts the schedule into `steps` and its number of
+   * steps into `num_steps`.  If `horizon` is not 0, a schedule with `horizon`
+   * steps is known and larger numbers of steps are not searched.  Returns
+   * failure, if there is no schedule within `max_steps` steps.  If
+   * `cancelled` returns true or the strategy is cancelled, no further solver
+   * call is made, and the schedule found so far is kept or failure is
+   * returned. */
+  template<class Solver, class Fn>
+  percy::synth_result search_steps( pebble_solver<LogicNetwork, Solver>& solver, uint32_t first, uint32_t horizon, step_store<LogicNetwork>& steps, uint32_t& num_steps, Fn&& cancelled )
+  {
+    const auto last = horizon ? std::min( horizon, ps.max_steps ) : ps.max_steps;
+    first = std::max( first, 1u );
+    if ( first > last )
+    {
+      return percy::failure;
+    }
+
+    const auto stop = [&]( uint32_t step ) {
+      return this->cancellation().is_cancelled() || cancelled( step );
+    };
+
+    /* the schedule is extracted after each success, such that a later probe cannot lose it */
+    const auto solve = [&]( uint32_t step ) {
+      while ( solver.current_step() < step )
+      {
+        solver.add_step();
+      }
+      const auto result = solver.solve( ps.conflict_limit, step );
+      if ( result == percy::success )
+      {
+        steps.clear();
+        solver.extract_result( steps );
+        num_steps = step;
+      }
+      return result;
+    };
+
+    if ( !ps.exponential_step_search )
+    {
+      for ( auto step = first; step <= last; ++step )
+      {
+        if ( stop( step ) )
+        {
+          return percy::failure;
+        }
+        if ( const auto result = solve( step ); result != percy::failure )
+        {
+          return result;
+        }
+      }
+      return percy::failure;
+    }
+
+    /* all steps up to lower are known to fail, upper has a schedule */
+    auto lower = first - 1u;
+    auto upper = horizon == last ? last : first;
+    auto has_schedule = false;
+    while ( upper != horizon )
+    {
+      if ( stop( upper ) )
+      {
+        return percy::failure;
+      }
+      const auto result = solve( upper );
+      if ( result == percy::success )
+      {
+        has_schedule = true;
+        break;
+      }
+      if ( result == percy::timeout )
+      {
+        return result;
+      }
+      if ( upper == last )
+      {
+        return percy::failure;
+      }
+      lower = upper;
+      upper = static_cast<uint32_t>( std::min<uint64_t>( 2ull * upper, last ) );
+    }
+
+    while ( upper - lower > 1u )
+    {
+      if ( stop( upper ) )
+      {
+        /* keep a schedule that was found, the warm-start schedule is not solved again */
+        return has_schedule ? percy::success : percy::failure;
+      }
+      const auto middle = lower + ( upper - lower ) / 2u;
+      const auto result = solve( middle );
+      if ( result == percy::timeout )
+      {
+        return has_schedule ? percy::success : percy::timeout;
+      }
+      if ( result == percy::success )
+      {
+        has_schedule = true;
+      }
+      ( result == percy::success ? upper : lower ) = middle;
+    }
+
+    /* the horizon itself has not been solved, if all probes below it failed */
+    if ( has_schedule )
+    {
+      return percy::success;
+    }
+    return stop( upper ) ? percy::failure : solve( upper );
+  }
+
+  /* Computes the greedy schedule for `limit` pebbles into `steps` and returns
+   * its number of steps, when moves of gates that are not adjacent share a
+   * step, or 0, if there is no greedy schedule within the bounds. */
+  uint32_t warm_start( LogicNetwork const& ntk, uint32_t limit, step_store<LogicNetwork>& steps ) const
+  {
+    greedy_pebbling_mapping_strategy_params gps;
+    gps.pebble_limit = limit;
+    greedy_pebbling_mapping_strategy<LogicNetwork> greedy( gps );
+    if ( !greedy.compute_steps( ntk ) )
+    {
+      return 0u;
+    }
+
+    std::unordered_map<mockturtle::node<LogicNetwork>, std::vector<mockturtle::node<LogicNetwork>>> adjacent;
+    ntk.foreach_gate( [&]( auto const& n ) {
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        if ( !ntk.is_constant( c ) && !ntk.is_pi( c ) )
+        {
+          adjacent[n].push_back( c );
+          adjacent[c].push_back( n );
+        }
+      } );
+    } );
+
+    /* each move follows the previous moves of the gate and its adjacent gates */
+    std::unordered_map<mockturtle::node<LogicNetwork>, uint32_t> last_step;
+    std::vector<uint32_t> move_step;
+    std::vector<int32_t> delta;
+    uint64_t weight{0u};
+    steps.clear();
+    greedy.foreach_step( [&]( auto const& n, auto const& action ) {
+      auto step = last_step[n];
+      for ( auto const& a : adjacent[n] )
+      {
+        step = std::max( step, last_step[a] );
+      }
+      last_step[n] = ++step;
+      move_step.push_back( step );
+      if ( delta.size() <= step )
+      {
+        delta.resize( step + 1u, 0 );
+      }
+      delta[step] += std::holds_alternative<compute_action>( action ) ? 1 : -1;
+      steps.emplace_back( n, action );
+
+      weight += ps.move_weight ? ps.move_weight( ntk.node_to_index( n ) ) : 1u;
+    } );
+    if ( steps.empty() || ( ps.max_weight && weight > ps.max_weight ) )
+    {
+      return 0u;
+    }
 
-      return true;
+    /* moves of a step are applied at once, such that the packed schedule may exceed the limits */
+    std::vector<uint32_t> moves( delta.size(), 0u );
+    for ( auto step : move_step )
+    {
+      ++moves[step];
+    }
+    int32_t pebbles{0};
+    for ( auto step = 1u; step < delta.size(); ++step )
+    {
+      pebbles += delta[step];
+      if ( ( limit && pebbles > static_cast<int32_t>( limit ) ) || ( ps.max_moves_per_step && moves[step] > ps.max_moves_per_step ) )
+      {
+        return static_cast<uint32_t>( steps.size() );
+      }
+    }
+    return static_cast<uint32_t>( delta.size() ) - 1u;
+  }
+
+  template<class Solver>
+  void record( pebble_solver<LogicNetwork, Solver>& solver )
+  {
+    if ( pst )
+    {
+      pst->num_vars += solver.nr_vars();
+      pst->num_clauses += solver.nr_clauses();
+      pst->cardinality.num_vars += solver.card_stats().num_vars;
+      pst->cardinality.num_clauses += solver.card_stats().num_clauses;
     }
   }
 
 private:
   pebbling_mapping_strategy_params ps;
+  pebbling_mapping_strategy_stats* pst;
 };
 
 }
@@ -0,0 +1,356 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken and Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file step_store.hpp
+  \brief packed storage for the steps of a mapping strategy
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <mockturtle/traits.hpp>
+
+#include "../../structures/stg_gate.hpp"
+#include "action.hpp"
+
+namespace caterpillar
+{
+
+/*! \brief Packed sequence of mapping strategy steps.
+ *
+ * Each step is stored as a fixed-size record with a tag for the action type.
+ * Leaves are stored in a shared arena and referenced by offset, cell
+ * functions are interned in `stg_function_store`, which also holds the
+ * control functions of the synthesized gates, and referenced by id.  The
+ * store holds a reference to each interned function until it is cleared or
+ * destroyed.  Steps are decoded into `mapping_strategy_action` values when
+ * they are accessed.
+ */
+template<class LogicNetwork>
+class step_store
+{
+public:
+  using node = mockturtle::node<LogicNetwork>;
+  using step_t = std::pair<node, mapping_strategy_action>;
+
+  static_assert( std::is_integral_v<node>, "step_store requires integral node types" );
+
+  /*! \brief Number of bytes of a step without leaves and cell functions */
+  static constexpr uint32_t record_size = 20u;
+
+  step_store() = default;
+
+  step_store( step_store const& other )
+      : records( other.records ),
+        leaves( other.leaves )
+  {
+    acquire_functions();
+  }
+
+  step_store( step_store&& other ) noexcept
+      : records( std::move( other.records ) ),
+        leaves( std::move( other.leaves ) )
+  {
+    other.records.clear();
+    other.leaves.clear();
+  }
+
+  step_store& operator=( step_store const& other )
+  {
+    if ( this != &other )
+    {
+      step_store copy( other );
+      *this = std::move( copy );
+    }
+    return *this;
+  }
+
+  step_store& operator=( step_store&& other ) noexcept
+  {
+    if ( this != &other )
+    {
+      clear();
+      records = std::move( other.records );
+      leaves = std::move( other.leaves );
+      other.records.clear();
+      other.leaves.clear();
+    }
+    return *this;
+  }
+
+  ~step_store()
+  {
+    release_functions();
+  }
+
+  void emplace_back( node const& n, mapping_strategy_action const& action )
+  {
+    assert( n <= std::numeric_limits<uint32_t>::max() );
+
+    record r;
+    r.node = static_cast<uint32_t>( n );
+    r.tag = static_cast<uint8_t>( action.index() );
+    std::visit( [&]( auto const& a ) { encode( r, a ); }, action );
+    records.push_back( r );
+  }
+
+  void push_back( step_t const& step )
+  {
+    emplace_back( step.first, step.second );
+  }
+
+  template<class Iterator>
+  void assign( Iterator begin, Iterator end )
+  {
+    clear();
+    for ( auto it = begin; it != end; ++it )
+    {
+      emplace_back( it->first, it->second );
+    }
+  }
+
+  /*! \brief Appends the steps of `other` without decoding them */
+  void append( step_store const& other )
+  {
+    const auto offset = static_cast<uint32_t>( leaves.size() );
+    leaves.insert( leaves.end(), other.leaves.begin(), other.leaves.end() );
+    records.reserve( records.size() + other.records.size() );
+    for ( auto r : other.records )
+    {
+      r.leaves = r.leaves == none ? none : r.leaves + offset;
+      r.cell_leaves = r.cell_leaves == none ? none : r.cell_leaves + offset;
+      if ( has_function( r ) )
+      {
+        stg_function_store::instance().acquire( r.value );
+      }
+      records.push_back( r );
+    }
+  }
+
+  void reserve( std::size_t size )
+  {
+    records.reserve( size );
+  }
+
+  void clear()
+  {
+    release_functions();
+    records.clear();
+    leaves.clear();
+  }
+
+  std::size_t size() const
+  {
+    return records.size();
+  }
+
+  bool empty() const
+  {
+    return records.empty();
+  }
+
+  node node_at( std::size_t i ) const
+  {
+    return static_cast<node>( records[i].node );
+  }
+
+  /*! \brief Decodes the `i`-th step */
+  step_t operator[]( std::size_t i ) const
+  {
+    return {node_at( i ), decode( records[i] )};
+  }
+
+  template<class Fn>
+  void foreach_step( Fn&& fn ) const
+  {
+    for ( auto const& r : records )
+    {
+      fn( static_cast<node>( r.node ), decode( r ) );
+    }
+  }
+
+  /*! \brief Iterates over the steps as views into the store
+   *
+   * Leaves and cell functions are not copied.  The views are valid until the
+   * store is modified.
+   */
+  template<class Fn>
+  void foreach_step_view( Fn&& fn ) const
+  {
+    for ( auto const& r : records )
+    {
+      fn( static_cast<node>( r.node ), view( r ) );
+    }
+  }
+
+  /*! \brief Number of bytes used by records and leaves
+   *
+   * Cell functions are shared with all gates in `stg_function_store` and are
+   * not counted.
+   */
+  std::size_t memory_usage() const
+  {
+    return records.capacity() * sizeof( record ) + leaves.capacity() * sizeof( uint32_t );
+  }
+
+private:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  struct record
+  {
+    uint32_t node;
+    /*! \brief target index of in-place actions, function id of cell overrides */
+    uint32_t value{none};
+    /*! \brief offset of leaves in leaves arena */
+    uint32_t leaves{none};
+    /*! \brief offset of cell leaves in leaves arena */
+    uint32_t cell_leaves{none};
+    uint8_t tag;
+  };
+  static_assert( sizeof( record ) == record_size, "unexpected record size" );
+
+  static bool has_function( record const& r )
+  {
+    return r.tag <= 1u && r.value != none;
+  }
+
+  void acquire_functions() const
+  {
+    for ( auto const& r : records )
+    {
+      if ( has_function( r ) )
+      {
+        stg_function_store::instance().acquire( r.value );
+      }
+    }
+  }
+
+  void release_functions() const
+  {
+    for ( auto const& r : records )
+    {
+      if ( has_function( r ) )
+      {
+        stg_function_store::instance().release( r.value );
+      }
+    }
+  }
+
+  template<class Action>
+  void encode( record& r, Action const& a )
+  {
+    if constexpr ( std::is_same_v<Action, compute_inplace_action> || std::is_same_v<Action, uncompute_inplace_action> )
+    {
+      r.value = a.target_index;
+    }
+    else
+    {
+      if ( a.cell_override )
+      {
+        r.value = stg_function_store::instance().intern( a.cell_override->first );
+        r.cell_leaves = store_leaves( a.cell_override->second );
+      }
+    }
+    if ( a.leaves )
+    {
+      r.leaves = store_leaves( *a.leaves );
+    }
+  }
+
+  mapping_strategy_action decode( record const& r ) const
+  {
+    switch ( r.tag )
+    {
+    case 0u:
+      return compute_action{load_leaves( r.leaves ), load_cell( r )};
+    case 1u:
+      return uncompute_action{load_leaves( r.leaves ), load_cell( r )};
+    case 2u:
+      return compute_inplace_action{r.value, load_leaves( r.leaves )};
+    default:
+      assert( r.tag == 3u );
+      return uncompute_inplace_action{r.value, load_leaves( r.leaves )};
+    }
+  }
+
+  mapping_strategy_action_view view( record const& r ) const
+  {
+    switch ( r.tag )
+    {
+    case 0u:
+      return compute_action_view{view_leaves( r.leaves ), view_cell( r )};
+    case 1u:
+      return uncompute_action_view{view_leaves( r.leaves ), view_cell( r )};
+    case 2u:
+      return compute_inplace_action_view{r.value, view_leaves( r.leaves )};
+    default:
+      assert( r.tag == 3u );
+      return uncompute_inplace_action_view{r.value, view_leaves( r.leaves )};
+    }
+  }
+
+  /* leaves are stored as size followed by the elements */
+  uint32_t store_leaves( std::vector<uint32_t> const& ls )
+  {
+    const auto offset = static_cast<uint32_t>( leaves.size() );
+    leaves.push_back( static_cast<uint32_t>( ls.size() ) );
+    leaves.insert( leaves.end(), ls.begin(), ls.end() );
+    return offset;
+  }
+
+  std::optional<std::vector<uint32_t>> load_leaves( uint32_t offset ) const
+  {
+    if ( offset == none )
+    {
+      return std::nullopt;
+    }
+    const auto begin = leaves.begin() + offset + 1;
+    return std::vector<uint32_t>( begin, begin + leaves[offset] );
+  }
+
+  std::optional<leaves_view> view_leaves( uint32_t offset ) const
+  {
+    if ( offset == none )
+    {
+      return std::nullopt;
+    }
+    return leaves_view( leaves.data() + offset + 1, leaves[offset] );
+  }
+
+  std::optional<cell_view> view_cell( record const& r ) const
+  {
+    if ( r.value == none )
+    {
+      return std::nullopt;
+    }
+    return cell_view{stg_function_store::instance()[r.value], *view_leaves( r.cell_leaves )};
+  }
+
+  std::optional<std::pair<kitty::dynamic_truth_table, std::vector<uint32_t>>> load_cell( record const& r ) const
+  {
+    if ( r.value == none )
+    {
+      return std::nullopt;
+    }
+    return std::make_pair( stg_function_store::instance()[r.value], *load_leaves( r.cell_leaves ) );
+  }
+
+private:
+  std::vector<record> records;
+  std::vector<uint32_t> leaves;
+};
+
+} // namespace caterpillar
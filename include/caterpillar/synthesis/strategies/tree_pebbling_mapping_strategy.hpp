@@ -0,0 +1,641 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken and Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file tree_pebbling_mapping_strategy.hpp
+  \brief dynamic programming pebbling of fanout-free cones
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <mockturtle/traits.hpp>
+#include <mockturtle/utils/node_map.hpp>
+#include <mockturtle/views/topo_view.hpp>
+
+#include "mapping_strategy.hpp"
+
+namespace caterpillar
+{
+
+namespace mt = mockturtle;
+
+struct tree_pebbling_mapping_strategy_params
+{
+  /*! \brief Largest fanout-free cone that is pebbled by dynamic programming.
+   *
+   * Larger cones are pebbled as in the eager strategy.
+   */
+  uint32_t max_tree_size{256u};
+
+  /*! \brief Maximum number of moves of a cone relative to the `2n - 1` moves without recomputation (at least 1). */
+  uint32_t max_move_factor{4u};
+};
+
+struct tree_pebbling_mapping_strategy_stats
+{
+  /*! \brief Number of fanout-free cones with more than one gate. */
+  uint32_t num_trees{0};
+
+  /*! \brief Number of gates in fanout-free cones with more than one gate. */
+  uint64_t num_tree_gates{0};
+
+  /*! \brief Largest number of pebbles of a cone. */
+  uint32_t max_tree_pebbles{0};
+
+  /*! \brief Number of gates in cones that are too large. */
+  uint64_t num_fallback_gates{0};
+
+  void report() const
+  {
+    std::cout << fmt::format( "[i] trees = {}   tree gates = {}   max tree pebbles = {}   fallback gates = {}\n",
+                              num_trees, num_tree_gates, max_tree_pebbles, num_fallback_gates );
+  }
+};
+
+namespace detail
+{
+
+/*! \brief Moves of Knill's optimal schedule for lines
+ *
+ * `cost(n, k)` is the smallest number of moves that pebbles the last of `n`
+ * nodes of a line above a pebbled base with at most `k` pebbles, leaving no
+ * other node of the line pebbled.  The costs only depend on `n` and `k` and
+ * are memoized across all trees.
+ */
+class line_pebbling_costs
+{
+public:
+  static constexpr uint64_t infinity = std::numeric_limits<uint64_t>::max() / 4u;
+
+  uint64_t cost( uint32_t n, uint32_t k )
+  {
+    if ( k >= n )
+    {
+      return 2u * n - 1u;
+    }
+    if ( k <= 1u || ( k < 33u && n > ( 1u << ( k - 1u ) ) ) )
+    {
+      return infinity;
+    }
+    if ( costs.size() <= n )
+    {
+      costs.resize( n + 1u );
+      splits.resize( n + 1u );
+    }
+    if ( costs[n].size() <= k )
+    {
+      costs[n].resize( k + 1u, 0u );
+      splits[n].resize( k + 1u, 0u );
+    }
+    if ( costs[n][k] == 0u )
+    {
+      costs[n][k] = infinity;
+      for ( auto m = 1u; m < n; ++m )
+      {
+        const auto c = add( add( cost( m, k ), cost( n - m, k - 1u ) ), cost( m, k - 1u ) );
+        if ( c < costs[n][k] )
+        {
+          costs[n][k] = c;
+          splits[n][k] = m;
+        }
+      }
+    }
+    return costs[n][k];
+  }
+
+  /*! \brief Number of nodes pebbled first with `k` pebbles, if `cost(n, k)` is finite and `k < n` */
+  uint32_t split( uint32_t n, uint32_t k ) const
+  {
+    return splits[n][k];
+  }
+
+  static uint64_t add( uint64_t a, uint64_t b )
+  {
+    return std::min( infinity, a + b );
+  }
+
+private:
+  std::vector<std::vector<uint64_t>> costs;
+  std::vector<std::vector<uint32_t>> splits;
+};
+
+/*! \brief Pebbling of a tree by dynamic programming over pebble budgets
+ *
+ * The tree is given by the children of each node in post-order, such that
+ * the subtree of node `i` occupies the positions `i - size[i] + 1` to `i`.
+ * `cost(i, b)` is the smallest number of moves that pebbles node `i` with at
+ * most `b` pebbles, leaving no other node of its subtree pebbled, among the
+ * following recursive schedules:
+ *
+ * - all nodes of the subtree are computed and all but `i` uncomputed
+ *   (Bennett's schedule, `b` is at least the size of the subtree),
+ * - if `i` has several children, the children are pebbled one after the
+ *   other in the order of decreasing pebble demand and kept, then `i` is
+ *   computed and the children are unpebbled in reverse order,
+ * - if `i` has a single child, some node of the chain below `i` is pebbled
+ *   and kept, the chain above it is pebbled with one pebble less as in
+ *   Knill's optimal schedule for lines, and the node is unpebbled.  If the
+ *   chain ends in a leaf, this is Knill's schedule for the whole chain.
+ *
+ * Only budgets up to `max_budget` (and the size of the subtree) are solved,
+ * larger budgets fall back to the schedule of `max_budget`.  The costs of
+ * the solved budgets are exact, since they only depend on smaller budgets.
+ */
+class tree_pebbling_dp
+{
+public:
+  static constexpr uint64_t infinity = line_pebbling_costs::infinity;
+
+  /*! \brief Single move in local node positions */
+  using move = std::pair<uint32_t, bool>;
+
+  tree_pebbling_dp( std::vector<std::vector<uint32_t>> const& children, line_pebbling_costs& lines, uint32_t max_budget = std::numeric_limits<uint32_t>::max() )
+      : lines( lines ),
+        max_budget( max_budget ),
+        children( children ),
+        size( children.size(), 1u ),
+        demand( children.size(), 0u ),
+        costs( children.size() ),
+        choices( children.size() ),
+        chains( children.size() )
+  {
+    for ( auto i = 0u; i < children.size(); ++i )
+    {
+      for ( auto c : children[i] )
+      {
+        size[i] += size[c];
+      }
+      solve( i );
+    }
+  }
+
+  uint64_t cost( uint32_t i, uint32_t budget ) const
+  {
+    budget = solved_budget( i, budget );
+    return budget == 0u ? infinity : costs[i][budget];
+  }
+
+  /*! \brief Smallest number of pebbles for node `i` */
+  uint32_t min_pebbles( uint32_t i ) const
+  {
+    return demand[i];
+  }
+
+  /*! \brief Appends the moves that pebble node `i` within `budget` pebbles */
+  void pebble( uint32_t i, uint32_t budget, std::vector<move>& moves ) const
+  {
+    budget = solved_budget( i, budget );
+    const auto [kind, j] = choices[i][budget];
+    std::vector<move> reverse;
+    switch ( kind )
+    {
+    case bennett:
+      for ( auto k = i + 1u - size[i]; k <= i; ++k )
+      {
+        moves.emplace_back( k, true );
+      }
+      for ( auto k = i; k-- > i + 1u - size[i]; )
+      {
+        moves.emplace_back( k, false );
+      }
+      break;
+
+    case hold:
+      for ( auto k = 0u; k < children[i].size(); ++k )
+      {
+        pebble( children[i][k], budget - k, moves );
+      }
+      moves.emplace_back( i, true );
+      for ( auto k = static_cast<uint32_t>( children[i].size() ); k-- > 0u; )
+      {
+        reverse.clear();
+        pebble( children[i][k], budget - k - 1u, reverse );
+        append_reverse( reverse, moves );
+      }
+      break;
+
+    case line:
+      pebble_line( chains[i], 0u, static_cast<uint32_t>( chains[i].size() ), budget, moves );
+      break;
+
+    case chain:
+    {
+      const auto& nodes = chains[i];
+      const auto pos = static_cast<uint32_t>( std::find( nodes.begin(), nodes.end(), j ) - nodes.begin() );
+      pebble( j, budget, moves );
+      pebble_line( nodes, pos + 1u, static_cast<uint32_t>( nodes.size() ), budget - 1u, moves );
+      pebble( j, budget - 1u, reverse );
+      append_reverse( reverse, moves );
+    }
+    break;
+    }
+  }
+
+private:
+  enum kind_t : uint8_t
+  {
+    bennett,
+    hold,
+    line,
+    chain
+  };
+
+  static uint64_t add( uint64_t a, uint64_t b )
+  {
+    return line_pebbling_costs::add( a, b );
+  }
+
+  uint32_t solved_budget( uint32_t i, uint32_t budget ) const
+  {
+    return budget >= size[i] ? size[i] : std::min( budget, max_budget );
+  }
+
+  static void append_reverse( std::vector<move> const& moves, std::vector<move>& out )
+  {
+    for ( auto it = moves.rbegin(); it != moves.rend(); ++it )
+    {
+      out.emplace_back( it->first, !it->second );
+    }
+  }
+
+  void solve( uint32_t i )
+  {
+    costs[i].assign( size[i] + 1u, infinity );
+    choices[i].assign( size[i] + 1u, {bennett, 0u} );
+    costs[i][size[i]] = 2u * size[i] - 1u;
+
+    auto& cs = children[i];
+    if ( cs.size() == 1u )
+    {
+      /* chain below i, from the first node with other than one child up to i */
+      auto& nodes = chains[i];
+      for ( auto k = i; ; k = children[k].front() )
+      {
+        nodes.push_back( k );
+        if ( children[k].size() != 1u )
+        {
+          break;
+        }
+      }
+      std::reverse( nodes.begin(), nodes.end() );
+      const auto n = static_cast<uint32_t>( nodes.size() );
+
+      if ( children[nodes.front()].empty() )
+      {
+        for ( auto budget = 2u; budget < size[i] && budget <= max_budget; ++budget )
+        {
+          costs[i][budget] = lines.cost( n, budget );
+          choices[i][budget] = {line, 0u};
+        }
+      }
+      else
+      {
+        /* the kept node needs its demand and the line above it at most 2^(budget - 2) nodes */
+        for ( auto budget = std::max( 2u, demand[nodes.front()] + 1u ); budget < size[i] && budget <= max_budget; ++budget )
+        {
+          const auto max_line = budget < 34u ? ( 1u << ( budget - 2u ) ) : n;
+          for ( auto pos = n - 1u - std::min( n - 1u, max_line ); pos + 1u < n && demand[nodes[pos]] < budget; ++pos )
+          {
+            const auto j = nodes[pos];
+            const auto c = add( add( cost( j, budget ), lines.cost( n - pos - 1u, budget - 1u ) ), cost( j, budget - 1u ) );
+            if ( c < costs[i][budget] )
+            {
+              costs[i][budget] = c;
+              choices[i][budget] = {chain, j};
+            }
+          }
+        }
+      }
+    }
+    else if ( cs.size() > 1u )
+    {
+      std::stable_sort( cs.begin(), cs.end(), [&]( auto a, auto b ) { return demand[a] > demand[b]; } );
+      /* child k is pebbled with budget - k and unpebbled with budget - k - 1 pebbles */
+      uint32_t min_budget{0u};
+      for ( auto k = 0u; k < cs.size(); ++k )
+      {
+        min_budget = std::max( min_budget, demand[cs[k]] + k + 1u );
+      }
+      for ( auto budget = min_budget; budget < size[i] && budget <= max_budget; ++budget )
+      {
+        uint64_t c{1u};
+        for ( auto k = 0u; k < cs.size(); ++k )
+        {
+          c = add( c, add( cost( cs[k], budget - k ), cost( cs[k], budget - k - 1u ) ) );
+        }
+        if ( c < costs[i][budget] )
+        {
+          costs[i][budget] = c;
+          choices[i][budget] = {hold, 0u};
+        }
+      }
+    }
+
+    /* costs do not increase with the budget, Bennett's schedule has the fewest moves */
+    for ( demand[i] = 1u; costs[i][demand[i]] == infinity; ++demand[i] )
+      ;
+  }
+
+  /* pebbles nodes[begin], ..., nodes[end - 1], where nodes[begin - 1] is pebbled or begin is 0 and nodes[0] a leaf */
+  void pebble_line( std::vector<uint32_t> const& nodes, uint32_t begin, uint32_t end, uint32_t k, std::vector<move>& moves ) const
+  {
+    const auto n = end - begin;
+    if ( k >= n )
+    {
+      for ( auto p = begin; p < end; ++p )
+      {
+        moves.emplace_back( nodes[p], true );
+      }
+      for ( auto p = end - 1u; p-- > begin; )
+      {
+        moves.emplace_back( nodes[p], false );
+      }
+      return;
+    }
+
+    const auto m = lines.split( n, k );
+    pebble_line( nodes, begin, begin + m, k, moves );
+    pebble_line( nodes, begin + m, end, k - 1u, moves );
+    std::vector<move> reverse;
+    pebble_line( nodes, begin, begin + m, k - 1u, reverse );
+    append_reverse( reverse, moves );
+  }
+
+private:
+  line_pebbling_costs& lines;
+  uint32_t max_budget;
+  std::vector<std::vector<uint32_t>> children;
+  std::vector<uint32_t> size;
+  std::vector<uint32_t> demand;
+  std::vector<std::vector<uint64_t>> costs;
+  std::vector<std::vector<std::pair<kind_t, uint32_t>>> choices;
+  std::vector<std::vector<uint32_t>> chains;
+};
+
+} // namespace detail
+
+/*! \brief Pebbling of fanout-free cones by dynamic programming
+ *
+ * The network is partitioned into fanout-free cones, whose roots are the
+ * primary outputs and the gates with several fanouts.  The roots are
+ * computed in topological order and uncomputed as in the eager strategy,
+ * where each cone is pebbled as a tree by `detail::tree_pebbling_dp`.  Each
+ * cone uses the fewest pebbles for which its number of moves is at most
+ * `max_move_factor` times the number of moves without recomputation.  Cones
+ * with more than `max_tree_size` gates are pebbled gate by gate, i.e., as in
+ * the eager strategy.  The runtime is linear in the size of the network for
+ * a fixed `max_tree_size`.
+ *
+ * The token set with `set_cancellation` is checked before each cone is
+ * solved.  Once it is cancelled, the remaining cones are pebbled without
+ * recomputation, i.e., as for a `max_move_factor` of 1, such that the
+ * schedule is still complete.
+ */
+template<class LogicNetwork>
+class tree_pebbling_mapping_strategy : public mapping_strategy<LogicNetwork>
+{
+  using node = mt::node<LogicNetwork>;
+
+public:
+  tree_pebbling_mapping_strategy( tree_pebbling_mapping_strategy_params const& ps = {}, tree_pebbling_mapping_strategy_stats* pst = nullptr )
+      : ps( ps ),
+        pst( pst )
+  {
+    static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+    static_assert( mt::has_is_constant_v<LogicNetwork>, "LogicNetwork does not implement the is_constant method" );
+    static_assert( mt::has_is_pi_v<LogicNetwork>, "LogicNetwork does not implement the is_pi method" );
+    static_assert( mt::has_fanout_size_v<LogicNetwork>, "LogicNetwork does not implement the fanout_size method" );
+    static_assert( mt::has_foreach_fanin_v<LogicNetwork>, "LogicNetwork does not implement the foreach_fanin method" );
+    static_assert( mt::has_foreach_po_v<LogicNetwork>, "LogicNetwork does not implement the foreach_po method" );
+    static_assert( mt::has_get_node_v<LogicNetwork>, "LogicNetwork does not implement the get_node method" );
+  }
+
+  bool compute_steps( LogicNetwork const& ntk ) override
+  {
+    this->steps().clear();
+
+    std::unordered_set<node> pos;
+    ntk.foreach_po( [&]( auto const& f ) { pos.insert( ntk.get_node( f ) ); } );
+
+    const auto is_gate = [&]( node const& n ) { return !ntk.is_constant( n ) && !ntk.is_pi( n ); };
+
+    /* roots are primary outputs and gates with other than one fanout, and all gates of too large cones */
+    mt::topo_view<LogicNetwork> topo{ntk};
+    mt::node_map<uint8_t, LogicNetwork> is_root( ntk, 0u );
+    mt::node_map<uint32_t, LogicNetwork> cone_size( ntk, 0u );
+    std::vector<node> roots;
+    topo.foreach_node( [&]( auto const& n ) {
+      if ( !is_gate( n ) )
+      {
+        return;
+      }
+      cone_size[n] = 1u;
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        if ( is_gate( c ) && !is_root[c] )
+        {
+          cone_size[n] += cone_size[c];
+        }
+      } );
+      if ( pos.count( n ) || ntk.fanout_size( n ) != 1u )
+      {
+        is_root[n] = 1u;
+        if ( cone_size[n] > ps.max_tree_size )
+        {
+          std::vector<node> cone;
+          collect_cone( ntk, n, is_root, cone );
+          for ( auto const& g : cone )
+          {
+            is_root[g] = 1u;
+          }
+          if ( pst )
+          {
+            pst->num_fallback_gates += cone.size();
+          }
+        }
+      }
+    } );
+    topo.foreach_node( [&]( auto const& n ) {
+      if ( is_gate( n ) && is_root[n] )
+      {
+        roots.push_back( n );
+      }
+    } );
+
+    /* references of each root by gates and primary outputs, as in the eager strategy */
+    mt::node_map<uint32_t, LogicNetwork> refs( ntk, 0u );
+    for ( auto const& r : roots )
+    {
+      refs[r] = ntk.fanout_size( r );
+    }
+
+    std::vector<node> released;
+    std::vector<node> cone;
+    for ( auto const& r : roots )
+    {
+      pebble_cone( ntk, r, is_root, true );
+      if ( !pos.count( r ) )
+      {
+        continue;
+      }
+
+      /* uncompute all roots that are no longer referenced */
+      released.push_back( r );
+      while ( !released.empty() )
+      {
+        const auto p = released.back();
+        released.pop_back();
+        cone.clear();
+        collect_cone( ntk, p, is_root, cone );
+        for ( auto const& g : cone )
+        {
+          ntk.foreach_fanin( g, [&]( auto const& f ) {
+            const auto c = ntk.get_node( f );
+            if ( is_gate( c ) && is_root[c] && --refs[c] == 0u )
+            {
+              pebble_cone( ntk, c, is_root, false );
+              released.push_back( c );
+            }
+          } );
+        }
+      }
+    }
+
+    return true;
+  }
+
+private:
+  /* collects the gates of the cone of root in post-order */
+  template<class IsRoot>
+  void collect_cone( LogicNetwork const& ntk, node const& root, IsRoot const& is_root, std::vector<node>& cone ) const
+  {
+    std::vector<std::pair<node, bool>> stack{{root, false}};
+    while ( !stack.empty() )
+    {
+      const auto [n, expanded] = stack.back();
+      stack.pop_back();
+      if ( expanded )
+      {
+        cone.push_back( n );
+        continue;
+      }
+      stack.emplace_back( n, true );
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        if ( !ntk.is_constant( c ) && !ntk.is_pi( c ) && !is_root[c] )
+        {
+          stack.emplace_back( c, false );
+        }
+      } );
+    }
+  }
+
+  /* computes (or uncomputes) the root of a cone, leaving the other gates of the cone unpebbled */
+  template<class IsRoot>
+  void pebble_cone( LogicNetwork const& ntk, node const& root, IsRoot const& is_root, bool compute )
+  {
+    std::vector<node> cone;
+    collect_cone( ntk, root, is_root, cone );
+
+    if ( cone.size() == 1u )
+    {
+      if ( compute )
+      {
+        this->steps().emplace_back( root, compute_action{} );
+      }
+      else
+      {
+        this->steps().emplace_back( root, uncompute_action{} );
+      }
+      return;
+    }
+
+    const auto r = static_cast<uint32_t>( cone.size() ) - 1u;
+    std::vector<detail::tree_pebbling_dp::move> moves;
+    uint32_t budget{0u};
+    if ( this->cancellation().is_cancelled() )
+    {
+      /* the post-order computes the children first, they are uncomputed after the root */
+      for ( auto i = 0u; i <= r; ++i )
+      {
+        moves.emplace_back( i, true );
+      }
+      for ( auto i = r; i-- > 0u; )
+      {
+        moves.emplace_back( i, false );
+      }
+      budget = r + 1u;
+    }
+    else
+    {
+      /* children in local positions, gates of a cone have a single fanout */
+      std::unordered_map<node, uint32_t> position;
+      std::vector<std::vector<uint32_t>> children( cone.size() );
+      for ( auto i = 0u; i < cone.size(); ++i )
+      {
+        position[cone[i]] = i;
+        ntk.foreach_fanin( cone[i], [&]( auto const& f ) {
+          if ( const auto it = position.find( ntk.get_node( f ) ); it != position.end() && it->second != i )
+          {
+            children[i].push_back( it->second );
+          }
+        } );
+      }
+
+      /* the budgets are solved up to a limit that is doubled until one of them has few enough moves */
+      const auto max_cost = static_cast<uint64_t>( std::max( 1u, ps.max_move_factor ) ) * ( 2u * cone.size() - 1u );
+      for ( auto max_budget = 16u; moves.empty(); max_budget *= 2u )
+      {
+        detail::tree_pebbling_dp dp( children, lines, max_budget );
+        for ( budget = dp.min_pebbles( r ); budget <= max_budget && dp.cost( r, budget ) > max_cost; ++budget )
+          ;
+        if ( dp.cost( r, budget ) <= max_cost )
+        {
+          dp.pebble( r, budget, moves );
+        }
+      }
+    }
+    if ( !compute )
+    {
+      std::reverse( moves.begin(), moves.end() );
+    }
+    for ( auto const& [i, is_compute] : moves )
+    {
+      if ( is_compute == compute )
+      {
+        this->steps().emplace_back( cone[i], compute_action{} );
+      }
+      else
+      {
+        this->steps().emplace_back( cone[i], uncompute_action{} );
+      }
+    }
+
+    if ( pst && compute )
+    {
+      ++pst->num_trees;
+      pst->num_tree_gates += cone.size();
+      pst->max_tree_pebbles = std::max( pst->max_tree_pebbles, budget );
+    }
+  }
+
+private:
+  tree_pebbling_mapping_strategy_params ps;
+  tree_pebbling_mapping_strategy_stats* pst;
+  detail::line_pebbling_costs lines;
+};
+
+} // namespace caterpillar
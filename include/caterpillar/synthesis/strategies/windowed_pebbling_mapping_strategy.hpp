@@ -0,0 +1,430 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Giulia Meuli
+*-----------------------------------------------------------------------------*/
+
+/*!
+  \file windowed_pebbling_mapping_strategy.hpp
+  \brief SAT-based pebbling of windows stitched into a global schedule
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "mapping_strategy.hpp"
+#include "../../solvers/bsat_solver.hpp"
+#include "../../solvers/sat_backend.hpp"
+
+#include <fmt/format.h>
+#include <mockturtle/networks/detail/foreach.hpp>
+#include <mockturtle/traits.hpp>
+#include <mockturtle/views/immutable_view.hpp>
+#include <mockturtle/views/topo_view.hpp>
+
+namespace caterpillar
+{
+
+namespace mt = mockturtle;
+
+struct windowed_pebbling_mapping_strategy_params
+{
+  /*! \brief Maximum number of gates in a window. */
+  uint32_t window_size{16u};
+
+  /*! \brief Pebble limit of each window (0 means no limit).
+   *
+   * The limit is raised for a window, if it has more outputs than pebbles or
+   * if no schedule within `max_steps` steps is found.
+   */
+  uint32_t pebble_limit{0u};
+
+  /*! \brief Maximum number of steps for each window. */
+  uint32_t max_steps{200u};
+
+  /*! \brief Conflict limit for the SAT solver (0 means no limit). */
+  uint32_t conflict_limit{0u};
+
+  /*! \brief Number of windows that are solved in parallel. */
+  uint32_t num_threads{1u};
+
+  /*! \brief Encoding of the pebble limit in each step. */
+  cardinality_encoding encoding{cardinality_encoding::totalizer};
+
+  /*! \brief SAT solver. */
+  sat_backend backend{sat_backend::bsat};
+};
+
+struct windowed_pebbling_mapping_strategy_stats
+{
+  /*! \brief Number of windows. */
+  uint32_t num_windows{0};
+
+  /*! \brief Largest pebble limit of a window after raising it. */
+  uint32_t max_window_pebbles{0};
+
+  /*! \brief Number of SAT variables over all solvers. */
+  uint64_t num_vars{0};
+
+  /*! \brief Number of SAT clauses over all solvers. */
+  uint64_t num_clauses{0};
+
+  void report() const
+  {
+    std::cout << fmt::format( "[i] windows = {}   max. window pebbles = {}\n", num_windows, max_window_pebbles );
+    std::cout << fmt::format( "[i] SAT variables = {}   SAT clauses = {}\n", num_vars, num_clauses );
+  }
+};
+
+namespace detail
+{
+
+/*! \brief View on a window of gates for the pebble solver
+ *
+ * All nodes outside of the window are primary inputs of the view, and the
+ * primary outputs are given explicitly.  Fanouts are restricted to the gates
+ * in the window.
+ */
+template<class Ntk>
+class pebbling_window_view : public mt::immutable_view<Ntk>
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+
+  pebbling_window_view( Ntk const& ntk, std::vector<node> const& gates, std::vector<node> const& outputs )
+      : mt::immutable_view<Ntk>( ntk ),
+        _gates( gates ),
+        _fanouts( gates.size() )
+  {
+    for ( auto i = 0u; i < _gates.size(); ++i )
+    {
+      _gate_to_index[_gates[i]] = i;
+    }
+    for ( auto const& g : _gates )
+    {
+      ntk.foreach_fanin( g, [&]( auto const& f ) {
+        if ( const auto it = _gate_to_index.find( ntk.get_node( f ) ); it != _gate_to_index.end() )
+        {
+          _fanouts[it->second].push_back( g );
+        }
+      } );
+    }
+    for ( auto const& o : outputs )
+    {
+      _outputs.push_back( ntk.make_signal( o ) );
+    }
+  }
+
+  inline uint32_t num_gates() const { return static_cast<uint32_t>( _gates.size() ); }
+  inline uint32_t num_pos() const { return static_cast<uint32_t>( _outputs.size() ); }
+
+  inline bool is_pi( node const& n ) const
+  {
+    return !this->is_constant( n ) && !_gate_to_index.count( n );
+  }
+
+  template<typename Fn>
+  void foreach_gate( Fn&& fn ) const
+  {
+    mt::detail::foreach_element( _gates.begin(), _gates.end(), fn );
+  }
+
+  template<typename Fn>
+  void foreach_node( Fn&& fn ) const
+  {
+    mt::detail::foreach_element( _gates.begin(), _gates.end(), fn );
+  }
+
+  template<typename Fn>
+  void foreach_po( Fn&& fn ) const
+  {
+    mt::detail::foreach_element( _outputs.begin(), _outputs.end(), fn );
+  }
+
+  template<typename Fn>
+  void foreach_fanout( node const& n, Fn&& fn ) const
+  {
+    if ( const auto it = _gate_to_index.find( n ); it != _gate_to_index.end() )
+    {
+      mt::detail::foreach_element( _fanouts[it->second].begin(), _fanouts[it->second].end(), fn );
+    }
+  }
+
+private:
+  std::vector<node> _gates;
+  std::vector<signal> _outputs;
+  std::unordered_map<node, uint32_t> _gate_to_index;
+  std::vector<std::vector<node>> _fanouts;
+};
+
+} // namespace detail
+
+/*!
+  \verbatim embed:rst
+  The network is partitioned into windows of consecutive gates in topological
+  order.  Each window is pebbled with the SAT-based pebbling game twice:
+  forward, from no pebbled gate to all window outputs, i.e., gates with fanout
+  in later windows or primary outputs, and backward, from all window outputs to
+  the primary outputs in the window.  The global schedule plays all forward
+  schedules in order and then all backward schedules in reverse order, such
+  that window outputs of earlier windows remain pebbled while a window is
+  played.  All windows are solved independently and in parallel.  Windows
+  that are not solved when the strategy is cancelled are pebbled as in
+  Bennett's strategy, ignoring the pebble limit.
+  \endverbatim
+*/
+template<class LogicNetwork>
+class windowed_pebbling_mapping_strategy : public mapping_strategy<LogicNetwork>
+{
+  using node = mt::node<LogicNetwork>;
+  using window_view = detail::pebbling_window_view<LogicNetwork>;
+  using Steps = step_store<LogicNetwork>;
+
+public:
+  windowed_pebbling_mapping_strategy( windowed_pebbling_mapping_strategy_params const& ps = {}, windowed_pebbling_mapping_strategy_stats* pst = nullptr )
+      : ps( ps ),
+        pst( pst )
+  {
+    static_assert( mt::is_network_type_v<LogicNetwork>, "LogicNetwork is not a network type" );
+    static_assert( mt::has_is_pi_v<LogicNetwork>, "LogicNetwork does not implement the is_pi method" );
+    static_assert( mt::has_is_constant_v<LogicNetwork>, "LogicNetwork does not implement the is_constant method" );
+    static_assert( mt::has_foreach_fanin_v<LogicNetwork>, "LogicNetwork does not implement the foreach_fanin method" );
+    static_assert( mt::has_foreach_gate_v<LogicNetwork>, "LogicNetwork does not implement the foreach_gate method" );
+    static_assert( mt::has_foreach_po_v<LogicNetwork>, "LogicNetwork does not implement the foreach_po method" );
+    static_assert( mt::has_make_signal_v<LogicNetwork>, "LogicNetwork does not implement the make_signal method" );
+  }
+
+  bool compute_steps( LogicNetwork const& ntk ) override
+  {
+    return dispatch_sat_backend( ps.backend, [&]( auto tag ) {
+      using Solver = std::remove_pointer_t<decltype( tag )>;
+      return compute_steps_windowed<Solver>( ntk );
+    } );
+  }
+
+private:
+  struct window
+  {
+    std::vector<node> gates;
+    std::vector<node> outputs;
+    std::vector<node> primary_outputs;
+  };
+
+  std::vector<window> partition( LogicNetwork const& ntk ) const
+  {
+    mt::node_map<uint32_t, LogicNetwork> window_of( ntk, 0u );
+    std::unordered_set<node> pos;
+    ntk.foreach_po( [&]( auto const& f ) {
+      pos.insert( ntk.get_node( f ) );
+    } );
+
+    std::vector<window> windows;
+    mt::topo_view<LogicNetwork> topo{ntk};
+    topo.foreach_gate( [&]( auto const& n ) {
+      if ( windows.empty() || windows.back().gates.size() >= std::max( ps.window_size, 1u ) )
+      {
+        windows.emplace_back();
+      }
+      windows.back().gates.push_back( n );
+      window_of[n] = static_cast<uint32_t>( windows.size() - 1 );
+    } );
+
+    /* window outputs are used by a later window or are primary outputs */
+    for ( auto i = 0u; i < windows.size(); ++i )
+    {
+      for ( auto const& n : windows[i].gates )
+      {
+        ntk.foreach_fanin( n, [&]( auto const& f ) {
+          const auto c = ntk.get_node( f );
+          if ( ntk.is_constant( c ) || ntk.is_pi( c ) || window_of[c] == i )
+          {
+            return;
+          }
+          auto& outputs = windows[window_of[c]].outputs;
+          if ( std::find( outputs.begin(), outputs.end(), c ) == outputs.end() )
+          {
+            outputs.push_back( c );
+          }
+        } );
+      }
+    }
+    for ( auto& w : windows )
+    {
+      for ( auto const& n : w.gates )
+      {
+        if ( pos.count( n ) )
+        {
+          w.primary_outputs.push_back( n );
+          if ( std::find( w.outputs.begin(), w.outputs.end(), n ) == w.outputs.end() )
+          {
+            w.outputs.push_back( n );
+          }
+        }
+      }
+    }
+    return windows;
+  }
+
+  template<class Solver>
+  bool compute_steps_windowed( LogicNetwork const& ntk )
+  {
+    const auto windows = partition( ntk );
+    if ( pst )
+    {
+      pst->num_windows += static_cast<uint32_t>( windows.size() );
+    }
+
+    /* job 2 * i is the forward and job 2 * i + 1 the backward schedule of window i */
+    std::vector<Steps> schedules( 2 * windows.size() );
+    std::atomic<uint32_t> next{0u};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+
+    const auto worker = [&]() {
+      for ( auto j = next++; j < schedules.size() && !failed; j = next++ )
+      {
+        auto const& w = windows[j / 2];
+        const auto forward = j % 2 == 0u;
+
+        /* the backward schedule is empty, if all window outputs are primary outputs */
+        if ( !forward && w.outputs.size() == w.primary_outputs.size() )
+        {
+          continue;
+        }
+
+        window_view view( ntk, w.gates, forward ? w.outputs : w.primary_outputs );
+        if ( !solve_window<Solver>( view, forward ? std::vector<node>{} : w.outputs, schedules[j], mutex ) )
+        {
+          failed = true;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for ( auto t = 1u; t < ps.num_threads; ++t )
+    {
+      threads.emplace_back( worker );
+    }
+    worker();
+    for ( auto& t : threads )
+    {
+      t.join();
+    }
+
+    this->steps().clear();
+    if ( failed )
+    {
+      return false;
+    }
+    for ( auto i = 0u; i < windows.size(); ++i )
+    {
+      this->steps().append( schedules[2 * i] );
+    }
+    for ( auto i = windows.size(); i-- > 0u; )
+    {
+      this->steps().append( schedules[2 * i + 1] );
+    }
+    return true;
+  }
+
+  /* pebbles a window starting from the pebbled gates in initial, raises the pebble limit until a schedule is found */
+  template<class Solver>
+  bool solve_window( window_view const& view, std::vector<node> const& initial, Steps& steps, std::mutex& mutex )
+  {
+    auto limit = ps.pebble_limit ? std::max( ps.pebble_limit, std::max<uint32_t>( view.num_pos(), initial.size() ) ) : 0u;
+    while ( true )
+    {
+      if ( this->cancellation().is_cancelled() )
+      {
+        bennett_window( view, initial, steps );
+        return true;
+      }
+      if ( limit >= view.num_gates() )
+      {
+        limit = 0u;
+      }
+
+      pebble_solver<window_view, Solver> solver( view, limit, ps.encoding );
+      solver.initialize( initial );
+
+      /* steps below the lower bound are encoded without solving */
+      const auto first = std::min( solver.lower_bound_steps(), ps.max_steps );
+      while ( solver.current_step() + 1u < first )
+      {
+        solver.add_step();
+      }
+
+      auto result = percy::failure;
+      while ( result == percy::failure && solver.current_step() < ps.max_steps && !this->cancellation().is_cancelled() )
+      {
+        solver.add_step();
+        result = solver.solve( ps.conflict_limit );
+      }
+
+      {
+        std::lock_guard<std::mutex> lock( mutex );
+        if ( pst )
+        {
+          pst->num_vars += solver.nr_vars();
+          pst->num_clauses += solver.nr_clauses();
+          pst->max_window_pebbles = std::max( pst->max_window_pebbles, limit ? limit : view.num_gates() );
+        }
+      }
+
+      if ( result == percy::success )
+      {
+        steps.clear();
+        solver.extract_result( steps );
+        return true;
+      }
+      if ( limit == 0u && !this->cancellation().is_cancelled() )
+      {
+        return false;
+      }
+      ++limit;
+    }
+  }
+
+  /* computes the gates of a window that are not pebbled in initial in topological order, then uncomputes all but the outputs in reverse order */
+  void bennett_window( window_view const& view, std::vector<node> const& initial, Steps& steps ) const
+  {
+    std::unordered_set<node> pebbled( initial.begin(), initial.end() ), outputs;
+    view.foreach_po( [&]( auto const& f ) { outputs.insert( view.get_node( f ) ); } );
+
+    std::vector<node> gates;
+    view.foreach_gate( [&]( auto const& n ) { gates.push_back( n ); } );
+
+    steps.clear();
+    for ( auto const& n : gates )
+    {
+      if ( !pebbled.count( n ) )
+      {
+        steps.emplace_back( n, compute_action{} );
+      }
+    }
+    for ( auto it = gates.rbegin(); it != gates.rend(); ++it )
+    {
+      if ( !outputs.count( *it ) )
+      {
+        steps.emplace_back( *it, uncompute_action{} );
+      }
+    }
+  }
+
+private:
+  windowed_pebbling_mapping_strategy_params ps;
+  windowed_pebbling_mapping_strategy_stats* pst;
+};
+
+} // namespace caterpillar
@@ -13,6 +13,7 @@
 #include <tweedledum/networks/netlist.hpp>
 
 #include <algorithm>
+#include <unordered_set>
 
 
 namespace caterpillar
@@ -125,19 +126,10 @@ class xag_mapping_strategy : public mapping_strategy<mockturtle::xag_network>
     return chs;
   }
 
-  bool first_cone_included_in_second(std::vector<uint32_t> first, std::vector<uint32_t> second)
+  bool first_cone_included_in_second( std::vector<uint32_t> const& first, std::vector<uint32_t> const& second )
   {
-    /* if second is included in first */
-    bool is_included = true;
-    for(auto l : first)
-    {
-      if (std::find( second.begin(), second.end(), l) == second.end())
-      {
-        is_included = false;
-        break;
-      }
-    }
-    return is_included;
+    /* cones are sorted */
+    return std::includes( second.begin(), second.end(), first.begin(), first.end() );
   }
 
 
@@ -194,43 +186,38 @@ public:
     mockturtle::topo_view topo {ntk};
     xag = topo;
 
-    std::vector<mockturtle::node<mockturtle::xag_network>> drivers;
-    xag.foreach_po( [&]( auto const& f ) { drivers.push_back( xag.get_node( f ) ); } );
-                                                                                   
+    std::unordered_set<mockturtle::node<mockturtle::xag_network>> drivers;
+    xag.foreach_po( [&]( auto const& f ) { drivers.insert( xag.get_node( f ) ); } );
 
-    auto it = steps().begin();
+    step_builder<mockturtle::xag_network> builder;
 
     fi.resize( xag.size() );
 
-
     xag.foreach_node( [&]( auto node ) {
 
       compute_fi( node );
 
       if ( xag.is_and( node ) )
       {
-
-        
         /* compute step */
         auto cc = compute( node , true);
-        it = steps().insert( it, cc.begin(), cc.end() );
-        it = it + cc.size();
+        builder.push_forward( cc.begin(), cc.end() );
 
-        if ( std::find( drivers.begin(), drivers.end(), node ) == drivers.end() )
+        if ( !drivers.count( node ) )
         {
           auto uc = compute( node , false);
-          it = steps().insert( it, uc.begin(), uc.end() );
+          builder.push_backward( uc.begin(), uc.end() );
         }
       }
       /* node is an XOR output */
-      else if ( std::find( drivers.begin(), drivers.end(), node ) != drivers.end() )
+      else if ( drivers.count( node ) )
       {
         auto xc = compute( node, true);
-        it = steps().insert( it, xc.begin(), xc.end() );
-
+        builder.push_backward( xc.begin(), xc.end() );
       }
 
     } );
+    builder.append_to( steps() );
 
     return true;
   }
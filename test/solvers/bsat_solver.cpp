@@ -0,0 +1,257 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <caterpillar/solvers/bsat_solver.hpp>
+#include <caterpillar/synthesis/strategies/step_store.hpp>
+#include <mockturtle/networks/aig.hpp>
+
+namespace
+{
+
+template<class Solver>
+uint32_t solve_until_sat( Solver& solver, uint32_t max_steps )
+{
+  auto result = solver.current_step() > 0u ? solver.solve( 0 ) : percy::failure;
+  while ( result == percy::failure && solver.current_step() < max_steps )
+  {
+    solver.add_step();
+    result = solver.solve( 0 );
+  }
+  return result == percy::success ? solver.current_step() : 0u;
+}
+
+template<class Solver>
+std::vector<std::pair<mockturtle::aig_network::node, caterpillar::mapping_strategy_action>> extract_steps( Solver& solver )
+{
+  std::vector<std::pair<mockturtle::aig_network::node, caterpillar::mapping_strategy_action>> steps;
+  solver.extract_result( steps );
+  return steps;
+}
+
+} // namespace
+
+TEST_CASE( "Tighten pebble limit in incremental pebble solver", "[bsat_solver]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 7u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 7u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  pebble_solver<aig_network> incremental( aig, 5u );
+  incremental.initialize();
+  CHECK( incremental.max_pebbles() == 5u );
+
+  for ( auto limit = 5u; limit >= 4u; --limit )
+  {
+    incremental.set_pebbles( limit );
+    const auto steps = solve_until_sat( incremental, 30u );
+
+    pebble_solver<aig_network> fresh( aig, limit );
+    fresh.initialize();
+    CHECK( steps > 0u );
+    CHECK( steps == solve_until_sat( fresh, 30u ) );
+
+    /* schedule uses no more than the selected number of pebbles */
+    int32_t pebbles{0}, peak{0};
+    for ( auto const& [n, action] : extract_steps( incremental ) )
+    {
+      (void)n;
+      pebbles += std::holds_alternative<compute_action>( action ) ? 1 : -1;
+      peak = std::max( peak, pebbles );
+    }
+    CHECK( peak <= static_cast<int32_t>( limit ) );
+  }
+}
+
+TEST_CASE( "Bound total weight of moves in pebble solver", "[bsat_solver]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 5u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 5u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  /* the first gate is expensive, values of the network are not used */
+  uint32_t first_gate{0u};
+  aig.foreach_gate( [&]( auto n, auto i ) {
+    if ( i == 0u )
+    {
+      first_gate = aig.node_to_index( n );
+    }
+  } );
+  const auto move_weight = [&]( uint32_t index ) { return index == first_gate ? 5u : 1u; };
+
+  const auto total_weight = [&]( auto const& steps ) {
+    auto weight = 0u;
+    for ( auto const& [n, action] : steps )
+    {
+      (void)action;
+      weight += move_weight( aig.node_to_index( n ) );
+    }
+    return weight;
+  };
+
+  /* unweighted schedule with 3 pebbles */
+  pebble_solver<aig_network> unweighted( aig, 3u );
+  unweighted.initialize();
+  REQUIRE( solve_until_sat( unweighted, 30u ) > 0u );
+  const auto unweighted_weight = total_weight( extract_steps( unweighted ) );
+
+  /* each gate is computed and all but the output are uncomputed at least once */
+  const auto min_weight = 2u * ( 5u + 1u + 1u ) + 1u;
+  CHECK( unweighted_weight >= min_weight );
+
+  for ( auto [pebbles, max_weight] : {std::make_pair( 3u, unweighted_weight ), std::make_pair( 4u, min_weight )} )
+  {
+    pebble_solver<aig_network> weighted( aig, pebbles, cardinality_encoding::totalizer, max_weight, 0u, move_weight );
+    weighted.initialize();
+    CHECK( solve_until_sat( weighted, 30u ) > 0u );
+    CHECK( total_weight( extract_steps( weighted ) ) <= max_weight );
+  }
+
+  /* with 3 pebbles, some gate must be recomputed */
+  pebble_solver<aig_network> infeasible( aig, 3u, cardinality_encoding::totalizer, min_weight, 0u, move_weight );
+  infeasible.initialize();
+  CHECK( solve_until_sat( infeasible, 30u ) == 0u );
+}
+
+TEST_CASE( "Structural lower bound on pebbling steps", "[bsat_solver]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 7u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 7u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  /* compute 6 levels and uncompute 5 of them */
+  pebble_solver<aig_network> solver( aig, 5u );
+  solver.initialize();
+  const auto bound = solver.lower_bound_steps();
+  CHECK( bound == 11u );
+
+  for ( auto step = 1u; step < bound; ++step )
+  {
+    solver.add_step();
+    CHECK( solver.solve( 0 ) == percy::failure );
+  }
+  CHECK( solve_until_sat( solver, 30u ) >= bound );
+
+  /* the bound is infinite with fewer pebbles than outputs */
+  aig.create_po( aig.create_and( pis[0], pis[1] ) );
+  aig.create_po( aig.create_and( pis[2], pis[3] ) );
+  pebble_solver<aig_network> few( aig, 2u );
+  few.initialize();
+  CHECK( few.lower_bound_steps() == std::numeric_limits<uint32_t>::max() );
+}
+
+TEST_CASE( "Remove redundant moves from pebbling", "[bsat_solver]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 4u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 4u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  /* with many more steps than needed, the solver may move pebbles back and forth */
+  pebble_solver<aig_network> solver( aig, 3u );
+  solver.initialize();
+  while ( solver.current_step() < 20u )
+  {
+    solver.add_step();
+  }
+  CHECK( solver.solve( 0 ) == percy::success );
+
+  std::vector<uint32_t> pebbled( aig.size(), 0u );
+  auto legal = true;
+  uint32_t num_moves{0u};
+  for ( auto const& [n, action] : extract_steps( solver ) )
+  {
+    aig.foreach_fanin( n, [&]( auto const& f ) {
+      legal &= aig.is_pi( aig.get_node( f ) ) || pebbled[aig.get_node( f )];
+    } );
+    pebbled[n] = std::holds_alternative<compute_action>( action );
+    ++num_moves;
+  }
+  CHECK( legal );
+  CHECK( pebbled[aig.get_node( f )] );
+  CHECK( num_moves == 5u );
+}
+
+TEST_CASE( "Bound moves per step in pebble solver", "[bsat_solver]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  /* four independent outputs that can be computed in a single step */
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  for ( auto i = 0u; i < 8u; i += 2u )
+  {
+    aig.create_po( aig.create_and( pis[i], pis[i + 1u] ) );
+  }
+
+  pebble_solver<aig_network> unbounded( aig, 0u );
+  unbounded.initialize();
+  CHECK( solve_until_sat( unbounded, 10u ) == 1u );
+
+  for ( auto max_moves = 1u; max_moves <= 3u; ++max_moves )
+  {
+    pebble_solver<aig_network> solver( aig, 0u, cardinality_encoding::totalizer, 0u, max_moves );
+    solver.initialize();
+    const auto bound = ( 4u + max_moves - 1u ) / max_moves;
+    CHECK( solver.lower_bound_steps() == bound );
+    CHECK( solve_until_sat( solver, 10u ) == bound );
+    step_store<aig_network> steps;
+    solver.extract_result( steps );
+    CHECK( steps.size() == 4u );
+  }
+}
@@ -0,0 +1,97 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <caterpillar/solvers/cardinality.hpp>
+#include <percy/solvers/bsat2.hpp>
+
+TEST_CASE( "Cardinality encodings with selectable bounds", "[cardinality]" )
+{
+  using namespace caterpillar;
+
+  const auto num_inputs = 7u;
+  const auto cap = 5u;
+
+  for ( auto encoding : {cardinality_encoding::sequential_counter, cardinality_encoding::totalizer,
+                         cardinality_encoding::modulo_totalizer, cardinality_encoding::sorting_network} )
+  {
+    percy::bsat_wrapper solver;
+    uint32_t nr_vars{0};
+    cardinality_stats st;
+    cardinality_encoder<percy::bsat_wrapper> encoder( solver, nr_vars, encoding, cap, st );
+
+    std::vector<int> inputs;
+    for ( auto i = 0u; i < num_inputs; ++i )
+    {
+      solver.add_var();
+      inputs.push_back( nr_vars++ );
+    }
+    auto counter = encoder.count( inputs );
+    CHECK( st.num_vars + num_inputs == nr_vars );
+    CHECK( st.num_clauses > 0u );
+
+    for ( auto k = 0u; k < cap; ++k )
+    {
+      const auto bound = encoder.bound_var( counter, k );
+      REQUIRE( bound != -1 );
+
+      for ( auto a = 0u; a < ( 1u << num_inputs ); ++a )
+      {
+        std::vector<int> assumptions;
+        for ( auto i = 0u; i < num_inputs; ++i )
+        {
+          assumptions.push_back( pabc::Abc_Var2Lit( inputs[i], ( a >> i ) & 1 ? 0 : 1 ) );
+        }
+        assumptions.push_back( pabc::Abc_Var2Lit( bound, 1 ) );
+        const auto expected = static_cast<uint32_t>( __builtin_popcount( a ) ) <= k ? percy::success : percy::failure;
+        CHECK( solver.solve( assumptions.data(), assumptions.data() + assumptions.size(), 0 ) == expected );
+      }
+    }
+  }
+}
+
+TEST_CASE( "Incremental weighted counter", "[cardinality]" )
+{
+  using namespace caterpillar;
+
+  const std::vector<uint32_t> weights{3u, 0u, 1u, 2u, 5u, 1u};
+  const auto cap = 7u;
+
+  percy::bsat_wrapper solver;
+  uint32_t nr_vars{0};
+  cardinality_stats st;
+  cardinality_encoder<percy::bsat_wrapper> encoder( solver, nr_vars, cardinality_encoding::sequential_counter, cap, st );
+
+  std::vector<int> inputs;
+  for ( auto i = 0u; i < weights.size(); ++i )
+  {
+    solver.add_var();
+    inputs.push_back( nr_vars++ );
+  }
+
+  /* add the inputs in two parts */
+  cardinality_counter counter;
+  encoder.add_weighted( counter, std::vector<int>( inputs.begin(), inputs.begin() + 3 ), std::vector<uint32_t>( weights.begin(), weights.begin() + 3 ) );
+  encoder.add_weighted( counter, std::vector<int>( inputs.begin() + 3, inputs.end() ), std::vector<uint32_t>( weights.begin() + 3, weights.end() ) );
+
+  for ( auto k = 0u; k < cap; ++k )
+  {
+    const auto bound = encoder.bound_var( counter, k );
+    REQUIRE( bound != -1 );
+
+    for ( auto a = 0u; a < ( 1u << weights.size() ); ++a )
+    {
+      std::vector<int> assumptions;
+      auto weight = 0u;
+      for ( auto i = 0u; i < weights.size(); ++i )
+      {
+        assumptions.push_back( pabc::Abc_Var2Lit( inputs[i], ( a >> i ) & 1 ? 0 : 1 ) );
+        weight += ( a >> i ) & 1 ? weights[i] : 0u;
+      }
+      assumptions.push_back( pabc::Abc_Var2Lit( bound, 1 ) );
+      const auto expected = weight <= k ? percy::success : percy::failure;
+      CHECK( solver.solve( assumptions.data(), assumptions.data() + assumptions.size(), 0 ) == expected );
+    }
+  }
+}
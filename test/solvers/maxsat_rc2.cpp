@@ -0,0 +1,62 @@
+#include <catch.hpp>
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <caterpillar/solvers/maxsat_rc2.hpp>
+#include <caterpillar/structures/cancellation_token.hpp>
+#include <easy/sat2/maxsat.hpp>
+
+TEST_CASE( "Cancellable RC2 finds the optimum of easy's RC2", "[maxsat_rc2]" )
+{
+  using namespace caterpillar;
+
+  /* at most one of x1, x2, x3 and x3 or x4, with weighted preferences for all of them */
+  const std::vector<std::vector<int>> hard{{-1, -2}, {-1, -3}, {-2, -3}, {3, 4}};
+  const std::vector<std::pair<std::vector<int>, int>> soft{{{1}, 3}, {{2}, 2}, {{3}, 4}, {{4}, 1}, {{-4, 1}, 2}};
+
+  const auto cost = [&]( auto& solver ) {
+    for ( auto const& c : hard )
+    {
+      solver.add_clause( c );
+    }
+    for ( auto const& [c, w] : soft )
+    {
+      solver.add_soft_clause( c, w );
+    }
+    REQUIRE( solver.solve() == std::decay_t<decltype( solver )>::state::success );
+    auto sum = 0;
+    for ( auto i : solver.get_disabled_clauses() )
+    {
+      sum += soft[i].second;
+    }
+    return sum;
+  };
+
+  int sid1{5}, sid2{5};
+  easy::sat2::maxsat_solver_statistics st1, st2;
+  easy::sat2::maxsat_solver_params ps1, ps2;
+  easy::sat2::maxsat_solver<easy::sat2::maxsat_rc2> reference( st1, ps1, sid1 );
+  maxsat_rc2_solver solver( st2, ps2, sid2 );
+  const auto optimum = cost( solver );
+  CHECK( optimum == cost( reference ) );
+  CHECK( optimum == 6 );
+}
+
+TEST_CASE( "Cancelled RC2 fails", "[maxsat_rc2]" )
+{
+  using namespace caterpillar;
+
+  int sid{3};
+  easy::sat2::maxsat_solver_statistics st;
+  easy::sat2::maxsat_solver_params ps;
+  maxsat_rc2_solver solver( st, ps, sid );
+  solver.add_clause( {-1, -2} );
+  solver.add_soft_clause( {1} );
+  solver.add_soft_clause( {2} );
+
+  const auto token = cancellation_token::make();
+  token.cancel();
+  CHECK( solver.solve( token ) == maxsat_rc2_solver::state::fail );
+}
@@ -0,0 +1,111 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp>
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+#include "pebbling_test_utils.hpp"
+
+TEST_CASE( "Bennett mapping strategy computes and uncomputes in reverse order", "[bennett_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  const auto a = aig.create_pi();
+  const auto b = aig.create_pi();
+  const auto c = aig.create_pi();
+  const auto w1 = aig.create_and( a, b );
+  const auto w2 = aig.create_and( w1, c );
+  const auto w3 = aig.create_and( w2, !a );
+  aig.create_po( w3 );
+
+  bennett_mapping_strategy<aig_network> strategy;
+  CHECK( strategy.compute_steps( aig ) );
+
+  std::vector<std::pair<uint32_t, bool>> steps;
+  strategy.foreach_step( [&]( auto n, auto const& action ) {
+    steps.emplace_back( aig.node_to_index( n ), std::holds_alternative<compute_action>( action ) );
+  } );
+
+  const auto i1 = aig.node_to_index( aig.get_node( w1 ) );
+  const auto i2 = aig.node_to_index( aig.get_node( w2 ) );
+  const auto i3 = aig.node_to_index( aig.get_node( w3 ) );
+  const std::vector<std::pair<uint32_t, bool>> expected{{i1, true}, {i2, true}, {i3, true}, {i2, false}, {i1, false}};
+  CHECK( steps == expected );
+}
+
+TEST_CASE( "Step builder keeps backward blocks in order", "[bennett_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  step_builder<aig_network> builder;
+  const std::vector<std::pair<aig_network::node, mapping_strategy_action>> block{{4u, uncompute_action{}}, {5u, uncompute_action{}}};
+
+  builder.push_forward( 1u, compute_action{} );
+  builder.push_backward( 2u, uncompute_action{} );
+  builder.push_forward( 3u, compute_action{} );
+  builder.push_backward( block.begin(), block.end() );
+
+  std::vector<std::pair<aig_network::node, mapping_strategy_action>> steps;
+  builder.append_to( steps );
+
+  std::vector<aig_network::node> nodes;
+  for ( auto const& [n, action] : steps )
+  {
+    nodes.push_back( n );
+  }
+  CHECK( nodes == std::vector<aig_network::node>{1u, 3u, 4u, 5u, 2u} );
+}
+
+TEST_CASE( "Bennett checkpointing trades pebbles for moves on a chain", "[bennett_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  aig_network aig;
+  auto f = aig.create_pi();
+  for ( auto i = 0u; i < 16u; ++i )
+  {
+    f = aig.create_and( f, aig.create_pi() );
+  }
+  aig.create_po( f );
+
+  /* 16 gates in 4 leaves of 4 gates: 3 * 3 leaves of 7 moves, and 4 + 1 + 1 pebbles */
+  for ( auto const& [levels, moves, pebbles] : std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>{{0u, 31u, 16u}, {1u, 45u, 9u}, {2u, 63u, 6u}} )
+  {
+    bennett_checkpoint_mapping_strategy_params ps;
+    ps.segments = 2u;
+    ps.levels = levels;
+    bennett_checkpoint_mapping_strategy<aig_network> strategy( ps );
+    CHECK( strategy.compute_steps( aig ) );
+    CHECK( strategy.num_steps() == moves );
+    CHECK( play_pebble_game( aig, strategy ) == pebbles );
+  }
+}
+
+TEST_CASE( "Bennett checkpointing of 4-bit multiplier", "[bennett_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 4u );
+
+  for ( auto segments : {2u, 3u} )
+  {
+    bennett_checkpoint_mapping_strategy_params ps;
+    ps.segments = segments;
+    ps.levels = 2u;
+    bennett_checkpoint_mapping_strategy<xag_network> strategy( ps );
+    CHECK( synthesize_and_verify( xag, strategy ) );
+  }
+}
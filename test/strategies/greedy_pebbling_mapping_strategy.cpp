@@ -0,0 +1,65 @@
+#include <catch.hpp>
+
+#include <cstdint>
+
+#include <caterpillar/structures/stg_gate.hpp>
+#include <caterpillar/synthesis/strategies/greedy_pebbling_mapping_strategy.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+#include "pebbling_test_utils.hpp"
+
+TEST_CASE( "Greedy pebbling respects pebble limit", "[greedy_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  const auto xag = multiplier( 4u );
+
+  greedy_pebbling_mapping_strategy<xag_network> unlimited;
+  CHECK( unlimited.compute_steps( xag ) );
+  CHECK( play_pebble_game( xag, unlimited ) == xag.num_gates() );
+
+  for ( auto limit : {40u, 30u} )
+  {
+    greedy_pebbling_mapping_strategy_params ps;
+    ps.pebble_limit = limit;
+    greedy_pebbling_mapping_strategy<xag_network> strategy( ps );
+    CHECK( strategy.compute_steps( xag ) );
+
+    const auto peak = play_pebble_game( xag, strategy );
+    CHECK( peak > 0u );
+    CHECK( peak <= limit );
+    CHECK( strategy.num_steps() > unlimited.num_steps() );
+
+    netlist<stg_gate> circ;
+    CHECK( synthesize_and_verify( circ, xag, strategy ) );
+    CHECK( circ.num_qubits() <= 8u + limit );
+  }
+
+  /* no progress with fewer pebbles than outputs */
+  greedy_pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = 4u;
+  greedy_pebbling_mapping_strategy<xag_network> strategy( ps );
+  CHECK( !strategy.compute_steps( xag ) );
+}
+
+TEST_CASE( "Greedy pebbling of large network", "[greedy_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 32u );
+
+  greedy_pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = xag.num_gates() / 4;
+  greedy_pebbling_mapping_strategy<xag_network> strategy( ps );
+  CHECK( strategy.compute_steps( xag ) );
+
+  const auto peak = play_pebble_game( xag, strategy );
+  CHECK( peak > 0u );
+  CHECK( peak <= ps.pebble_limit );
+}
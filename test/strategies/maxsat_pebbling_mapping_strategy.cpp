@@ -0,0 +1,150 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <caterpillar/synthesis/strategies/maxsat_pebbling_mapping_strategy.hpp>
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+#include "pebbling_test_utils.hpp"
+
+TEST_CASE( "MaxSAT pebbling of a chain with fewest moves", "[maxsat_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 5u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 5u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  /* Bennett's schedule needs 4 pebbles, with 3 pebbles two gates are computed twice */
+  for ( auto const& [limit, moves] : std::vector<std::pair<uint32_t, uint64_t>>{{0u, 7u}, {3u, 9u}} )
+  {
+    maxsat_pebbling_mapping_strategy_params ps;
+    ps.pebble_limit = limit;
+    ps.num_steps = 10u;
+    maxsat_pebbling_mapping_strategy_stats st;
+    maxsat_pebbling_mapping_strategy<aig_network> strategy( ps, &st );
+    CHECK( strategy.compute_steps( aig ) );
+    CHECK( strategy.num_steps() == moves );
+    CHECK( st.cost == moves );
+  }
+
+  /* there are not enough steps for 2 pebbles */
+  maxsat_pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = 2u;
+  ps.num_steps = 10u;
+  maxsat_pebbling_mapping_strategy<aig_network> strategy( ps );
+  CHECK( !strategy.compute_steps( aig ) );
+}
+
+TEST_CASE( "MaxSAT pebbling with weighted moves", "[maxsat_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis( 6u );
+  std::generate( pis.begin(), pis.end(), [&]() { return aig.create_pi(); } );
+  const auto p1 = aig.create_and( pis[0], pis[1] );
+  const auto p2 = aig.create_and( p1, pis[2] );
+  const auto q1 = aig.create_and( pis[3], pis[4] );
+  const auto q2 = aig.create_and( q1, pis[5] );
+  aig.create_po( aig.create_and( p2, q2 ) );
+
+  /* with 4 pebbles, the first gate of one branch is computed twice, the expensive one is not */
+  for ( auto const& [expensive, cheap] : {std::make_pair( p1, q1 ), std::make_pair( q1, p1 )} )
+  {
+    const auto move_cost = [&, expensive = expensive]( uint32_t index ) { return index == aig.node_to_index( aig.get_node( expensive ) ) ? 10u : 1u; };
+
+    maxsat_pebbling_mapping_strategy_params ps;
+    ps.pebble_limit = 4u;
+    ps.move_cost = move_cost;
+    maxsat_pebbling_mapping_strategy_stats st;
+    maxsat_pebbling_mapping_strategy<aig_network> strategy( ps, &st );
+    CHECK( strategy.compute_steps( aig ) );
+    CHECK( strategy.num_steps() == 11u );
+    CHECK( st.cost == 29u );
+
+    uint64_t cost{0u};
+    uint32_t expensive_computes{0u}, cheap_computes{0u};
+    strategy.foreach_step( [&]( auto n, auto const& action ) {
+      cost += move_cost( aig.node_to_index( n ) );
+      if ( std::holds_alternative<compute_action>( action ) )
+      {
+        expensive_computes += n == aig.get_node( expensive );
+        cheap_computes += n == aig.get_node( cheap );
+      }
+    } );
+    CHECK( cost == st.cost );
+    CHECK( expensive_computes == 1u );
+    CHECK( cheap_computes == 2u );
+  }
+}
+
+TEST_CASE( "Cancelled MaxSAT pebbling fails without steps", "[maxsat_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 2u );
+  const auto token = cancellation_token::make();
+  maxsat_pebbling_mapping_strategy<xag_network> strategy;
+  strategy.set_cancellation( token );
+  CHECK( strategy.compute_steps( xag ) );
+  CHECK( strategy.num_steps() > 0u );
+
+  token.cancel();
+  CHECK( !strategy.compute_steps( xag ) );
+  CHECK( strategy.num_steps() == 0u );
+}
+
+TEST_CASE( "MaxSAT pebbling without gate outputs", "[maxsat_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  const auto a = aig.create_pi();
+  const auto b = aig.create_pi();
+  aig.create_and( a, b );
+  aig.create_po( a );
+  aig.create_po( !b );
+  aig.create_po( aig.get_constant( true ) );
+
+  maxsat_pebbling_mapping_strategy_stats st;
+  maxsat_pebbling_mapping_strategy<aig_network> strategy( {}, &st );
+  CHECK( strategy.compute_steps( aig ) );
+  CHECK( strategy.num_steps() == 0u );
+  CHECK( st.cost == 0u );
+}
+
+TEST_CASE( "MaxSAT pebbling of 2-bit multiplier", "[maxsat_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 2u );
+
+  maxsat_pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = xag.num_gates() - 1u;
+  maxsat_pebbling_mapping_strategy<xag_network> strategy( ps );
+  CHECK( synthesize_and_verify( xag, strategy ) );
+  CHECK( play_pebble_game( xag, strategy ) > 0u );
+  CHECK( play_pebble_game( xag, strategy ) <= ps.pebble_limit );
+}
@@ -1,6 +1,10 @@
 #include <catch.hpp>
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <variant>
+#include <vector>
 
 #include <caterpillar/structures/stg_gate.hpp>
 #include <caterpillar/synthesis/lhrs.hpp>
@@ -9,9 +13,12 @@
 #include <kitty/static_truth_table.hpp>
 #include <mockturtle/algorithms/simulation.hpp>
 #include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/xag.hpp>
 #include <tweedledum/io/write_unicode.hpp>
 #include <tweedledum/networks/netlist.hpp>
 
+#include "pebbling_test_utils.hpp"
+
 TEST_CASE( "Pebble mapping strategy for 3-bit sorting network", "[pebbling_mapping_strategy]" )
 {
   using namespace caterpillar;
@@ -44,3 +51,314 @@ TEST_CASE( "Pebble mapping strategy for 3-bit sorting network", "[pebbling_mappi
   CHECK( sorter2 );
   CHECK( simulate<kitty::static_truth_table<3>>( sorter ) == simulate<kitty::static_truth_table<3>>( *sorter2 ) );
 }
+
+TEST_CASE( "Portfolio search for smallest pebble limit", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 5u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = aig.create_and( pis[0], pis[1] );
+  for ( auto i = 2u; i < 5u; ++i )
+  {
+    f = aig.create_and( f, aig.create_xor( pis[i], pis[i - 1] ) );
+  }
+  aig.create_po( f );
+
+  const auto peak_pebbles = []( auto const& strategy ) {
+    int32_t pebbles{0}, peak{0};
+    strategy.foreach_step( [&]( auto, auto const& action ) {
+      std::visit( caterpillar::detail::overloaded{
+                      []( auto const& ) {},
+                      [&]( compute_action const& ) { peak = std::max( peak, ++pebbles ); },
+                      [&]( uncompute_action const& ) { --pebbles; }},
+                  action );
+    } );
+    return peak;
+  };
+
+  pebbling_mapping_strategy_params ps;
+  ps.max_steps = 30u;
+  ps.num_threads = 4u;
+  pebbling_mapping_strategy<aig_network> portfolio( ps );
+  CHECK( portfolio.compute_steps( aig ) );
+  const auto peak = peak_pebbles( portfolio );
+  CHECK( peak < static_cast<int32_t>( aig.num_gates() ) );
+
+  /* no schedule with fewer pebbles within the same number of steps */
+  ps.num_threads = 1u;
+  ps.exponential_step_search = true;
+  ps.pebble_limit = peak - 1;
+  pebbling_mapping_strategy<aig_network> sequential( ps );
+  CHECK( !sequential.compute_steps( aig ) );
+
+  netlist<stg_gate> circ;
+  logic_network_synthesis_stats st;
+  logic_network_synthesis( circ, aig, portfolio, {}, {}, &st );
+  const auto aig2 = circuit_to_logic_network<aig_network>( circ, st.i_indexes, st.o_indexes );
+  CHECK( aig2 );
+  CHECK( simulate<kitty::static_truth_table<5>>( aig ) == simulate<kitty::static_truth_table<5>>( *aig2 ) );
+}
+
+TEST_CASE( "Pebbling with different cardinality encodings", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 7u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 7u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  std::vector<std::size_t> num_steps;
+  std::vector<pebbling_mapping_strategy_stats> stats;
+  for ( auto encoding : {cardinality_encoding::sequential_counter, cardinality_encoding::totalizer,
+                         cardinality_encoding::modulo_totalizer, cardinality_encoding::sorting_network} )
+  {
+    pebbling_mapping_strategy_params ps;
+    ps.pebble_limit = 4u;
+    ps.max_steps = 30u;
+    ps.encoding = encoding;
+    pebbling_mapping_strategy_stats st;
+    pebbling_mapping_strategy<aig_network> strategy( ps, &st );
+    CHECK( strategy.compute_steps( aig ) );
+    num_steps.push_back( strategy.num_steps() );
+    stats.push_back( st );
+
+    CHECK( st.cardinality.num_vars > 0u );
+    CHECK( st.cardinality.num_vars < st.num_vars );
+    CHECK( st.cardinality.num_clauses < st.num_clauses );
+  }
+
+  /* all encodings find a schedule after the same number of steps */
+  CHECK( std::adjacent_find( num_steps.begin(), num_steps.end(), std::not_equal_to<>() ) == num_steps.end() );
+  CHECK( stats[1].cardinality.num_vars < stats[0].cardinality.num_vars );
+}
+
+TEST_CASE( "Pebbling with glucose backend", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 7u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 7u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = 4u;
+  ps.max_steps = 30u;
+  pebbling_mapping_strategy<aig_network> bsat( ps );
+  CHECK( bsat.compute_steps( aig ) );
+
+  ps.backend = sat_backend::glucose;
+  pebbling_mapping_strategy<aig_network> glucose( ps );
+  CHECK( glucose.compute_steps( aig ) );
+
+  netlist<stg_gate> circ;
+  logic_network_synthesis_stats st;
+  logic_network_synthesis( circ, aig, glucose, {}, {}, &st );
+  const auto aig2 = circuit_to_logic_network<aig_network>( circ, st.i_indexes, st.o_indexes );
+  CHECK( aig2 );
+  CHECK( simulate<kitty::static_truth_table<7>>( aig ) == simulate<kitty::static_truth_table<7>>( *aig2 ) );
+}
+
+TEST_CASE( "Exponential step search", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 6u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  auto g = pis[5];
+  for ( auto i = 1u; i < 5u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+    g = aig.create_xor( g, pis[i] );
+  }
+  aig.create_po( f );
+  aig.create_po( aig.create_and( f, g ) );
+
+  for ( auto exponential : {false, true} )
+  {
+    pebbling_mapping_strategy_params ps;
+    ps.pebble_limit = 6u;
+    ps.max_steps = 60u;
+    ps.exponential_step_search = exponential;
+    pebbling_mapping_strategy<aig_network> strategy( ps );
+    CHECK( strategy.compute_steps( aig ) );
+
+    netlist<stg_gate> circ;
+    logic_network_synthesis_stats st;
+    logic_network_synthesis( circ, aig, strategy, {}, {}, &st );
+    const auto aig2 = circuit_to_logic_network<aig_network>( circ, st.i_indexes, st.o_indexes );
+    CHECK( aig2 );
+    CHECK( simulate<kitty::static_truth_table<6>>( aig ) == simulate<kitty::static_truth_table<6>>( *aig2 ) );
+  }
+}
+
+TEST_CASE( "Warm-start pebbling from greedy schedule", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 3u );
+
+  /* the SAT solver gives up immediately, such that the greedy schedule is returned */
+  pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = 2u * xag.num_gates() / 3u;
+  ps.conflict_limit = 1u;
+  pebbling_mapping_strategy<xag_network> cold( ps );
+  CHECK( !cold.compute_steps( xag ) );
+
+  ps.warm_start = true;
+  pebbling_mapping_strategy<xag_network> fallback( ps );
+  CHECK( fallback.compute_steps( xag ) );
+  CHECK( synthesize_and_verify( xag, fallback ) );
+
+  ps.conflict_limit = 0u;
+  for ( auto exponential : {false, true} )
+  {
+    ps.exponential_step_search = exponential;
+    pebbling_mapping_strategy<xag_network> strategy( ps );
+    CHECK( strategy.compute_steps( xag ) );
+    CHECK( synthesize_and_verify( xag, strategy ) );
+  }
+}
+
+TEST_CASE( "Cancelled pebbling returns the warm-start schedule", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 5u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 5u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  logic_network_synthesis_params sps;
+  sps.cancellation = cancellation_token::make();
+  sps.cancellation.cancel();
+
+  pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = 3u;
+  pebbling_mapping_strategy<aig_network> cold( ps );
+  netlist<stg_gate> circ;
+  CHECK( !logic_network_synthesis( circ, aig, cold, {}, sps ) );
+
+  ps.warm_start = true;
+  for ( auto exponential : {false, true} )
+  {
+    ps.exponential_step_search = exponential;
+    pebbling_mapping_strategy_stats pst;
+    pebbling_mapping_strategy<aig_network> warm( ps, &pst );
+    netlist<stg_gate> warm_circ;
+    logic_network_synthesis_stats st;
+    CHECK( logic_network_synthesis( warm_circ, aig, warm, {}, sps, &st ) );
+    const auto aig2 = circuit_to_logic_network<aig_network>( warm_circ, st.i_indexes, st.o_indexes );
+    CHECK( aig2 );
+    CHECK( simulate<kitty::static_truth_table<5>>( aig ) == simulate<kitty::static_truth_table<5>>( *aig2 ) );
+
+    /* no step is encoded for a solver call after the cancellation */
+    CHECK( pst.num_vars == aig.num_gates() );
+  }
+}
+
+TEST_CASE( "Bound weighted moves without network values", "[pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  /* the values of the network are left untouched */
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 5u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = pis[0];
+  for ( auto i = 1u; i < 5u; ++i )
+  {
+    f = aig.create_and( f, pis[i] );
+  }
+  aig.create_po( f );
+
+  const auto solve = [&]( pebbling_mapping_strategy_params const& ps ) {
+    pebbling_mapping_strategy<aig_network> strategy( ps );
+    uint32_t weight{0u};
+    if ( !strategy.compute_steps( aig ) )
+    {
+      return 0u;
+    }
+    strategy.foreach_step( [&]( auto const& n, auto const& ) {
+      weight += ps.move_weight ? ps.move_weight( aig.node_to_index( n ) ) : 1u;
+    } );
+    return weight;
+  };
+
+  /* without weight function, 4 gates need 4 computes and 3 uncomputes */
+  pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = 4u;
+  ps.max_steps = 20u;
+  ps.max_weight = 6u;
+  CHECK( solve( ps ) == 0u );
+  ps.max_weight = 7u;
+  CHECK( solve( ps ) == 7u );
+
+  /* the first gate is expensive */
+  uint32_t first_gate{0u};
+  aig.foreach_gate( [&]( auto n, auto i ) {
+    if ( i == 0u )
+    {
+      first_gate = aig.node_to_index( n );
+    }
+  } );
+  ps.move_weight = [&]( uint32_t index ) { return index == first_gate ? 5u : 1u; };
+  for ( auto warm_start : {false, true} )
+  {
+    ps.warm_start = warm_start;
+    ps.max_weight = 14u;
+    CHECK( solve( ps ) == 0u );
+    ps.max_weight = 15u;
+    CHECK( solve( ps ) == 15u );
+  }
+}
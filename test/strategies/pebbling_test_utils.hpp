@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include <caterpillar/structures/stg_gate.hpp>
+#include <caterpillar/synthesis/lhrs.hpp>
+#include <caterpillar/synthesis/strategies/action.hpp>
+#include <caterpillar/verification/circuit_to_logic_network.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <mockturtle/algorithms/simulation.hpp>
+#include <mockturtle/generators/arithmetic.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+namespace caterpillar::test
+{
+
+/* plays the steps as reversible pebble game and returns the largest number of pebbles,
+   or 0 if a move is not legal or the game does not end with exactly the outputs pebbled */
+template<class Ntk, class Strategy>
+uint32_t play_pebble_game( Ntk const& ntk, Strategy const& strategy )
+{
+  std::unordered_set<mockturtle::node<Ntk>> pebbled;
+  bool legal{true};
+  uint32_t peak{0u};
+  strategy.foreach_step( [&]( auto n, auto const& action ) {
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      const auto c = ntk.get_node( f );
+      legal &= ntk.is_constant( c ) || ntk.is_pi( c ) || pebbled.count( c );
+    } );
+    if ( std::holds_alternative<compute_action>( action ) )
+    {
+      legal &= pebbled.insert( n ).second;
+    }
+    else
+    {
+      legal &= std::holds_alternative<uncompute_action>( action ) && pebbled.erase( n );
+    }
+    peak = std::max<uint32_t>( peak, static_cast<uint32_t>( pebbled.size() ) );
+  } );
+
+  std::unordered_set<mockturtle::node<Ntk>> outputs;
+  ntk.foreach_po( [&]( auto const& f ) {
+    const auto n = ntk.get_node( f );
+    if ( !ntk.is_constant( n ) && !ntk.is_pi( n ) )
+      outputs.insert( n );
+  } );
+  return legal && pebbled == outputs ? peak : 0u;
+}
+
+/* carry ripple multiplier with two inputs of bitwidth bits */
+inline mockturtle::xag_network multiplier( uint32_t bitwidth )
+{
+  mockturtle::xag_network xag;
+  std::vector<mockturtle::xag_network::signal> a( bitwidth ), b( bitwidth );
+  std::generate( a.begin(), a.end(), [&]() { return xag.create_pi(); } );
+  std::generate( b.begin(), b.end(), [&]() { return xag.create_pi(); } );
+  for ( auto const& f : mockturtle::carry_ripple_multiplier( xag, a, b ) )
+  {
+    xag.create_po( f );
+  }
+  return xag;
+}
+
+/* synthesizes the network with the strategy into circ and checks the circuit by simulation */
+template<class Ntk, class Strategy>
+bool synthesize_and_verify( tweedledum::netlist<stg_gate>& circ, Ntk const& ntk, Strategy& strategy, logic_network_synthesis_params const& ps = {} )
+{
+  logic_network_synthesis_stats st;
+  if ( !logic_network_synthesis( circ, ntk, strategy, {}, ps, &st ) )
+  {
+    return false;
+  }
+  const auto ntk2 = circuit_to_logic_network<Ntk>( circ, st.i_indexes, st.o_indexes );
+  if ( !ntk2 )
+  {
+    return false;
+  }
+  const mockturtle::default_simulator<kitty::dynamic_truth_table> sim( ntk.num_pis() );
+  return mockturtle::simulate<kitty::dynamic_truth_table>( ntk, sim ) == mockturtle::simulate<kitty::dynamic_truth_table>( *ntk2, sim );
+}
+
+template<class Ntk, class Strategy>
+bool synthesize_and_verify( Ntk const& ntk, Strategy& strategy, logic_network_synthesis_params const& ps = {} )
+{
+  tweedledum::netlist<stg_gate> circ;
+  return synthesize_and_verify( circ, ntk, strategy, ps );
+}
+
+} // namespace caterpillar::test
@@ -0,0 +1,169 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <caterpillar/synthesis/strategies/step_store.hpp>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+TEST_CASE( "Encode and decode steps in packed store", "[step_store]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  kitty::dynamic_truth_table maj( 3u );
+  kitty::create_majority( maj );
+
+  std::vector<std::pair<xag_network::node, mapping_strategy_action>> steps;
+  steps.emplace_back( 4u, compute_action{} );
+  steps.emplace_back( 5u, compute_action{std::vector<uint32_t>{1, 2, 3}, std::nullopt} );
+  steps.emplace_back( 6u, compute_action{std::nullopt, std::make_pair( maj, std::vector<uint32_t>{1, 4, 5} )} );
+  steps.emplace_back( 7u, compute_inplace_action{5u, std::vector<uint32_t>{2}} );
+  steps.emplace_back( 7u, uncompute_inplace_action{5u, std::nullopt} );
+  steps.emplace_back( 6u, uncompute_action{std::nullopt, std::make_pair( maj, std::vector<uint32_t>{1, 4, 5} )} );
+  steps.emplace_back( 5u, uncompute_action{std::vector<uint32_t>{}, std::nullopt} );
+
+  step_store<xag_network> store;
+  store.assign( steps.begin(), steps.end() );
+  CHECK( store.size() == steps.size() );
+
+  auto i = 0u;
+  store.foreach_step( [&]( auto n, auto const& action ) {
+    CHECK( n == steps[i].first );
+    CHECK( action.index() == steps[i].second.index() );
+    std::visit( [&]( auto const& a ) {
+      using action_t = std::decay_t<decltype( a )>;
+      auto const& expected = std::get<action_t>( steps[i].second );
+      CHECK( a.leaves == expected.leaves );
+      if constexpr ( std::is_same_v<action_t, compute_action> || std::is_same_v<action_t, uncompute_action> )
+      {
+        CHECK( a.cell_override == expected.cell_override );
+      }
+      else
+      {
+        CHECK( a.target_index == expected.target_index );
+      }
+    },
+                action );
+    ++i;
+  } );
+  CHECK( i == steps.size() );
+}
+
+TEST_CASE( "Iterate over views of packed steps", "[step_store]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  kitty::dynamic_truth_table maj( 3u );
+  kitty::create_majority( maj );
+
+  std::vector<std::pair<xag_network::node, mapping_strategy_action>> steps;
+  steps.emplace_back( 5u, compute_action{std::vector<uint32_t>{1, 2, 3}, std::nullopt} );
+  steps.emplace_back( 6u, compute_action{std::nullopt, std::make_pair( maj, std::vector<uint32_t>{1, 4, 5} )} );
+  steps.emplace_back( 7u, compute_inplace_action{5u, std::vector<uint32_t>{2}} );
+  steps.emplace_back( 6u, uncompute_action{std::nullopt, std::make_pair( maj, std::vector<uint32_t>{1, 4, 5} )} );
+
+  step_store<xag_network> store;
+  store.assign( steps.begin(), steps.end() );
+
+  auto i = 0u;
+  store.foreach_step_view( [&]( auto n, auto const& view ) {
+    CHECK( n == steps[i].first );
+    CHECK( view.index() == steps[i].second.index() );
+    const auto expected = make_action_view( steps[i].second );
+    std::visit( [&]( auto const& a ) {
+      using view_t = std::decay_t<decltype( a )>;
+      auto const& e = std::get<view_t>( expected );
+      REQUIRE( a.leaves.has_value() == e.leaves.has_value() );
+      if ( a.leaves )
+      {
+        CHECK( a.leaves->to_vector() == e.leaves->to_vector() );
+      }
+      if constexpr ( std::is_same_v<view_t, compute_action_view> || std::is_same_v<view_t, uncompute_action_view> )
+      {
+        REQUIRE( a.cell_override.has_value() == e.cell_override.has_value() );
+        if ( a.cell_override )
+        {
+          /* the function refers to the interned truth table */
+          const auto id = stg_function_store::instance().intern( maj );
+          CHECK( &a.cell_override->function == &stg_function_store::instance()[id] );
+          stg_function_store::instance().release( id );
+          CHECK( a.cell_override->leaves.to_vector() == e.cell_override->leaves.to_vector() );
+        }
+      }
+    },
+                view );
+    ++i;
+  } );
+  CHECK( i == steps.size() );
+}
+
+TEST_CASE( "Packed steps without leaves use fixed-size records", "[step_store]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  step_store<xag_network> store;
+  store.reserve( 1000u );
+  for ( auto i = 0u; i < 500u; ++i )
+  {
+    store.emplace_back( i, compute_action{} );
+    store.emplace_back( i, uncompute_action{} );
+  }
+  CHECK( store.memory_usage() == 1000u * step_store<xag_network>::record_size );
+  CHECK( store.memory_usage() * 5u <= 1000u * sizeof( std::pair<xag_network::node, mapping_strategy_action> ) );
+}
+
+TEST_CASE( "Packed steps release their cell functions", "[step_store]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  auto& functions = stg_function_store::instance();
+  const auto num_functions = functions.num_functions();
+
+  kitty::dynamic_truth_table tt( 9u );
+  kitty::create_random( tt, 7u );
+
+  step_store<xag_network> store;
+  store.emplace_back( 6u, compute_action{std::nullopt, std::make_pair( tt, std::vector<uint32_t>{1, 4, 5} )} );
+  store.emplace_back( 6u, uncompute_action{std::nullopt, std::make_pair( tt, std::vector<uint32_t>{1, 4, 5} )} );
+  CHECK( functions.num_functions() == num_functions + 1u );
+
+  {
+    auto copy = store;
+    store.clear();
+    CHECK( functions.num_functions() == num_functions + 1u );
+    CHECK( std::get<compute_action>( copy[0u].second ).cell_override->first == tt );
+  }
+  CHECK( functions.num_functions() == num_functions );
+}
+
+TEST_CASE( "Append packed steps", "[step_store]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+
+  kitty::dynamic_truth_table maj( 3u );
+  kitty::create_majority( maj );
+
+  step_store<xag_network> first, second;
+  first.emplace_back( 5u, compute_action{std::vector<uint32_t>{1, 2, 3}, std::nullopt} );
+  second.emplace_back( 6u, compute_action{std::vector<uint32_t>{4}, std::make_pair( maj, std::vector<uint32_t>{1, 4, 5} )} );
+  second.emplace_back( 7u, compute_inplace_action{5u, std::vector<uint32_t>{2, 6}} );
+
+  first.append( second );
+  second.clear();
+  REQUIRE( first.size() == 3u );
+  CHECK( std::get<compute_action>( first[0u].second ).leaves == std::vector<uint32_t>{1, 2, 3} );
+  const auto step = first[1u];
+  auto const& cell = std::get<compute_action>( step.second );
+  CHECK( cell.leaves == std::vector<uint32_t>{4} );
+  CHECK( cell.cell_override->first == maj );
+  CHECK( cell.cell_override->second == std::vector<uint32_t>{1, 4, 5} );
+  CHECK( std::get<compute_inplace_action>( first[2u].second ).leaves == std::vector<uint32_t>{2, 6} );
+}
@@ -0,0 +1,142 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <caterpillar/structures/cancellation_token.hpp>
+#include <caterpillar/synthesis/strategies/eager_mapping_strategy.hpp>
+#include <caterpillar/synthesis/strategies/tree_pebbling_mapping_strategy.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+#include "pebbling_test_utils.hpp"
+
+TEST_CASE( "Tree pebbling of a chain", "[tree_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  xag_network xag;
+  auto f = xag.create_pi();
+  for ( auto i = 1u; i < 16u; ++i )
+  {
+    f = xag.create_and( f, xag.create_pi() );
+  }
+  xag.create_po( f );
+
+  /* the chain of 15 gates is a single cone, which needs fewer pebbles when more moves are allowed */
+  uint32_t last_peak{xag.num_gates()};
+  for ( auto factor : {1u, 2u, 4u, 16u} )
+  {
+    tree_pebbling_mapping_strategy_params ps;
+    ps.max_move_factor = factor;
+    tree_pebbling_mapping_strategy_stats st;
+    tree_pebbling_mapping_strategy<xag_network> strategy( ps, &st );
+    CHECK( strategy.compute_steps( xag ) );
+    CHECK( st.num_trees == 1u );
+    CHECK( strategy.num_steps() <= factor * ( 2u * xag.num_gates() - 1u ) );
+
+    const auto peak = play_pebble_game( xag, strategy );
+    CHECK( peak > 0u );
+    CHECK( peak == st.max_tree_pebbles );
+    CHECK( peak <= last_peak );
+    last_peak = peak;
+  }
+  CHECK( last_peak < xag.num_gates() / 2u );
+
+  /* no recomputation is allowed for factor 0, as for factor 1 */
+  tree_pebbling_mapping_strategy_params ps;
+  ps.max_move_factor = 0u;
+  tree_pebbling_mapping_strategy<xag_network> strategy( ps );
+  CHECK( strategy.compute_steps( xag ) );
+  CHECK( strategy.num_steps() == 2u * xag.num_gates() - 1u );
+  CHECK( play_pebble_game( xag, strategy ) == xag.num_gates() );
+}
+
+TEST_CASE( "Tree pebbling of a long chain", "[tree_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  xag_network xag;
+  auto f = xag.create_pi();
+  for ( auto i = 1u; i < 251u; ++i )
+  {
+    f = xag.create_and( f, xag.create_pi() );
+  }
+  xag.create_po( f );
+
+  /* Knill's schedule for 250 gates needs 9 pebbles, and 12 pebbles with at most 4 times the moves */
+  for ( auto const& [factor, pebbles] : std::vector<std::pair<uint32_t, uint32_t>>{{4u, 12u}, {1u, 250u}} )
+  {
+    tree_pebbling_mapping_strategy_params ps;
+    ps.max_move_factor = factor;
+    tree_pebbling_mapping_strategy_stats st;
+    tree_pebbling_mapping_strategy<xag_network> strategy( ps, &st );
+    CHECK( strategy.compute_steps( xag ) );
+    CHECK( strategy.num_steps() <= factor * ( 2u * xag.num_gates() - 1u ) );
+    CHECK( st.max_tree_pebbles == pebbles );
+    CHECK( play_pebble_game( xag, strategy ) == pebbles );
+  }
+}
+
+TEST_CASE( "Cancelled tree pebbling does not recompute", "[tree_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  xag_network xag;
+  auto f = xag.create_pi();
+  for ( auto i = 1u; i < 16u; ++i )
+  {
+    f = xag.create_and( f, xag.create_pi() );
+  }
+  xag.create_po( f );
+
+  const auto token = cancellation_token::make();
+  token.cancel();
+  tree_pebbling_mapping_strategy_params ps;
+  ps.max_move_factor = 4u;
+  tree_pebbling_mapping_strategy<xag_network> strategy( ps );
+  strategy.set_cancellation( token );
+  CHECK( strategy.compute_steps( xag ) );
+  CHECK( strategy.num_steps() == 2u * xag.num_gates() - 1u );
+  CHECK( play_pebble_game( xag, strategy ) == xag.num_gates() );
+
+  /* the steps still realize the network */
+  const auto mult = multiplier( 3u );
+  CHECK( strategy.compute_steps( mult ) );
+  CHECK( synthesize_and_verify( mult, strategy ) );
+}
+
+TEST_CASE( "Tree pebbling of 4-bit multiplier", "[tree_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 4u );
+
+  tree_pebbling_mapping_strategy_stats st;
+  tree_pebbling_mapping_strategy<xag_network> strategy( {}, &st );
+  CHECK( strategy.compute_steps( xag ) );
+  CHECK( play_pebble_game( xag, strategy ) > 0u );
+  CHECK( st.num_fallback_gates == 0u );
+  CHECK( synthesize_and_verify( xag, strategy ) );
+
+  /* without cones every gate is computed and uncomputed once, as in the eager strategy */
+  tree_pebbling_mapping_strategy_params ps;
+  ps.max_tree_size = 1u;
+  tree_pebbling_mapping_strategy_stats fst;
+  tree_pebbling_mapping_strategy<xag_network> fallback( ps, &fst );
+  CHECK( fallback.compute_steps( xag ) );
+  CHECK( play_pebble_game( xag, fallback ) > 0u );
+  CHECK( fst.num_trees == 0u );
+
+  eager_mapping_strategy<xag_network> eager;
+  CHECK( eager.compute_steps( xag ) );
+  CHECK( fallback.num_steps() == eager.num_steps() );
+}
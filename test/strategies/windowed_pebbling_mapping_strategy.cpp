@@ -0,0 +1,54 @@
+#include <catch.hpp>
+
+#include <caterpillar/structures/cancellation_token.hpp>
+#include <caterpillar/synthesis/lhrs.hpp>
+#include <caterpillar/synthesis/strategies/windowed_pebbling_mapping_strategy.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+#include "pebbling_test_utils.hpp"
+
+TEST_CASE( "Windowed pebbling of 4-bit multiplier", "[windowed_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 4u );
+
+  windowed_pebbling_mapping_strategy_params ps;
+  ps.window_size = 12u;
+  ps.pebble_limit = 8u;
+  windowed_pebbling_mapping_strategy_stats st;
+  windowed_pebbling_mapping_strategy<xag_network> strategy( ps, &st );
+  CHECK( strategy.compute_steps( xag ) );
+  CHECK( play_pebble_game( xag, strategy ) > 0u );
+  CHECK( st.num_windows == ( xag.num_gates() + 11u ) / 12u );
+  CHECK( synthesize_and_verify( xag, strategy ) );
+
+  /* windows are solved independently, such that parallel solving finds the same schedule */
+  ps.num_threads = 4u;
+  windowed_pebbling_mapping_strategy<xag_network> parallel( ps );
+  CHECK( parallel.compute_steps( xag ) );
+  CHECK( play_pebble_game( xag, parallel ) > 0u );
+  CHECK( parallel.num_steps() == strategy.num_steps() );
+}
+
+TEST_CASE( "Cancelled windowed pebbling falls back to Bennett windows", "[windowed_pebbling_mapping_strategy]" )
+{
+  using namespace caterpillar;
+  using namespace caterpillar::test;
+  using namespace mockturtle;
+
+  const auto xag = multiplier( 4u );
+
+  /* the token is cancelled before synthesis, such that no window is solved */
+  windowed_pebbling_mapping_strategy_params ps;
+  ps.window_size = 12u;
+  ps.pebble_limit = 8u;
+  windowed_pebbling_mapping_strategy<xag_network> strategy( ps );
+
+  logic_network_synthesis_params sps;
+  sps.cancellation = cancellation_token::make();
+  sps.cancellation.cancel();
+  CHECK( synthesize_and_verify( xag, strategy, sps ) );
+}
@@ -0,0 +1,35 @@
+#include <catch.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include <caterpillar/structures/cancellation_token.hpp>
+
+TEST_CASE( "Cancel shared token", "[cancellation_token]" )
+{
+  using namespace caterpillar;
+
+  cancellation_token never;
+  CHECK( !never.is_cancellable() );
+  never.cancel();
+  CHECK( !never.is_cancelled() );
+
+  const auto token = cancellation_token::make();
+  const auto copy = token;
+  CHECK( token.is_cancellable() );
+  CHECK( !copy.is_cancelled() );
+  std::thread( [&]() { token.cancel(); } ).join();
+  CHECK( copy.is_cancelled() );
+}
+
+TEST_CASE( "Token with deadline", "[cancellation_token]" )
+{
+  using namespace caterpillar;
+
+  const auto late = cancellation_token::with_timeout( std::chrono::hours( 1 ) );
+  CHECK( !late.is_cancelled() );
+
+  const auto token = cancellation_token::with_timeout( std::chrono::milliseconds( 1 ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+  CHECK( token.is_cancelled() );
+}
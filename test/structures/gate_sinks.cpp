@@ -0,0 +1,302 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <caterpillar/structures/gate_sinks.hpp>
+#include <caterpillar/structures/stg_gate.hpp>
+#include <caterpillar/synthesis/lhrs.hpp>
+#include <caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp>
+#include <mockturtle/networks/aig.hpp>
+#include <tweedledum/io/qasm.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+namespace
+{
+
+mockturtle::aig_network sorting_network()
+{
+  mockturtle::aig_network sorter;
+  const auto a = sorter.create_pi();
+  const auto b = sorter.create_pi();
+  const auto c = sorter.create_pi();
+
+  const auto w1 = sorter.create_and( a, b );
+  const auto w2 = sorter.create_and( c, w1 );
+  const auto w3 = sorter.create_and( !a, !b );
+  const auto w4 = sorter.create_and( !c, !w1 );
+  const auto w5 = sorter.create_and( !w3, !w4 );
+  const auto w6 = sorter.create_or( c, !w3 );
+
+  sorter.create_po( w2 );
+  sorter.create_po( w5 );
+  sorter.create_po( w6 );
+  return sorter;
+}
+
+/* strips the header (first 4 lines) of a QASM file */
+std::string qasm_body( std::string const& qasm )
+{
+  auto pos = 0u;
+  for ( auto i = 0u; i < 4u; ++i )
+  {
+    pos = qasm.find( '\n', pos ) + 1;
+  }
+  return qasm.substr( pos );
+}
+
+/* stream buffer that cannot seek, like a pipe */
+class pipe_buffer : public std::streambuf
+{
+public:
+  std::string data;
+
+protected:
+  int_type overflow( int_type c ) override
+  {
+    if ( c != traits_type::eof() )
+      data.push_back( static_cast<char>( c ) );
+    return c;
+  }
+
+  std::streamsize xsputn( char const* s, std::streamsize n ) override
+  {
+    data.append( s, static_cast<std::size_t>( n ) );
+    return n;
+  }
+};
+
+/* simulates the gates h, x, cx, ccx, and u1(+-pi/k) of a QASM body on a basis state */
+std::vector<std::complex<double>> simulate_qasm( std::string const& body, uint32_t num_qubits, uint32_t input )
+{
+  std::vector<std::complex<double>> state( 1u << num_qubits );
+  state[input] = 1.0;
+
+  std::istringstream is( body );
+  std::string line;
+  while ( std::getline( is, line ) )
+  {
+    std::vector<uint32_t> qs;
+    for ( auto pos = line.find( "q[" ); pos != std::string::npos; pos = line.find( "q[", pos + 1 ) )
+      qs.push_back( static_cast<uint32_t>( std::stoul( line.substr( pos + 2 ) ) ) );
+    const auto controlled = [&]( uint32_t k ) {
+      for ( auto i = 0u; i + 1u < qs.size(); ++i )
+        if ( !( ( k >> qs[i] ) & 1u ) )
+          return false;
+      return true;
+    };
+    const auto t = 1u << qs.back();
+
+    if ( line.rfind( "h ", 0 ) == 0 )
+    {
+      for ( auto k = 0u; k < state.size(); ++k )
+      {
+        if ( k & t )
+          continue;
+        const auto a = state[k], b = state[k | t];
+        state[k] = ( a + b ) / std::sqrt( 2.0 );
+        state[k | t] = ( a - b ) / std::sqrt( 2.0 );
+      }
+    }
+    else if ( line.rfind( "u1(", 0 ) == 0 )
+    {
+      const auto negative = line[3] == '-';
+      const auto denominator = std::stod( line.substr( line.find( '/' ) + 1 ) );
+      const auto phase = std::polar( 1.0, ( negative ? -1.0 : 1.0 ) * 3.14159265358979323846 / denominator );
+      for ( auto k = 0u; k < state.size(); ++k )
+        if ( k & t )
+          state[k] *= phase;
+    }
+    else
+    {
+      for ( auto k = 0u; k < state.size(); ++k )
+        if ( !( k & t ) && controlled( k ) )
+          std::swap( state[k], state[k | t] );
+    }
+  }
+  return state;
+}
+
+} // namespace
+
+TEST_CASE( "count resources with a gate sink", "[gate_sinks]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  const auto sorter = sorting_network();
+
+  netlist<stg_gate> circ;
+  bennett_mapping_strategy<aig_network> strategy;
+  logic_network_synthesis( circ, sorter, strategy );
+
+  resource_counting_sink sink;
+  bennett_mapping_strategy<aig_network> strategy2;
+  logic_network_synthesis_stats st;
+  logic_network_synthesis( sink, sorter, strategy2, {}, {}, &st );
+
+  uint32_t num_not{0}, num_cnot{0}, num_mcx{0};
+  circ.foreach_cgate( [&]( auto const& n ) {
+    if ( n.gate.is( gate_set::pauli_x ) || ( n.gate.is( gate_set::mcx ) && n.gate.num_controls() == 0 ) )
+      ++num_not;
+    else if ( n.gate.is( gate_set::cx ) || ( n.gate.is( gate_set::mcx ) && n.gate.num_controls() == 1 ) )
+      ++num_cnot;
+    else if ( n.gate.is( gate_set::mcx ) )
+      ++num_mcx;
+  } );
+
+  CHECK( sink.num_qubits() == circ.num_qubits() );
+  CHECK( sink.num_gates() == circ.num_gates() );
+  CHECK( sink.num_not() == num_not );
+  CHECK( sink.num_cnot() == num_cnot );
+  CHECK( sink.num_mcx() == num_mcx );
+  CHECK( sink.t_count() == 7u * num_mcx );
+  CHECK( st.o_indexes.size() == 3u );
+}
+
+TEST_CASE( "write QASM with a gate sink", "[gate_sinks]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  const auto sorter = sorting_network();
+
+  netlist<stg_gate> circ;
+  bennett_mapping_strategy<aig_network> strategy;
+  logic_network_synthesis( circ, sorter, strategy );
+
+  std::stringstream expected;
+  write_qasm( circ, expected );
+
+  std::stringstream os;
+  {
+    qasm_gate_sink sink( os, 16u );
+    bennett_mapping_strategy<aig_network> strategy2;
+    logic_network_synthesis( sink, sorter, strategy2 );
+    CHECK( sink.num_qubits() == circ.num_qubits() );
+  }
+
+  /* CNOT gates are always written with a space between the qubits */
+  auto expected_body = qasm_body( expected.str() );
+  for ( auto pos = expected_body.find( "],q[" ); pos != std::string::npos; pos = expected_body.find( "],q[", pos ) )
+    expected_body.replace( pos, 4u, "], q[" );
+  CHECK( qasm_body( os.str() ) == expected_body );
+  CHECK( os.str().find( fmt::format( "qreg q[{}]", circ.num_qubits() ) ) != std::string::npos );
+
+  /* a non-seekable stream gives the same output */
+  pipe_buffer buffer;
+  std::ostream pipe( &buffer );
+  {
+    qasm_gate_sink sink( pipe, 16u );
+    bennett_mapping_strategy<aig_network> strategy3;
+    logic_network_synthesis( sink, sorter, strategy3 );
+  }
+  CHECK( buffer.data == os.str() );
+}
+
+TEST_CASE( "write MCX gates with many controls as QASM", "[gate_sinks]" )
+{
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  std::stringstream os;
+  qasm_gate_sink sink( os );
+  for ( auto i = 0u; i < 5u; ++i )
+    sink.add_qubit();
+  sink.add_gate( gate::mcx, std::vector<qubit_id>{qubit_id( 0u ), qubit_id( 1u, true ), qubit_id( 2u )}, std::vector<qubit_id>{qubit_id( 3u ), qubit_id( 4u )} );
+  CHECK_THROWS_AS( sink.add_gate( gate::mcz, std::vector<qubit_id>{qubit_id( 0u )}, std::vector<qubit_id>{qubit_id( 1u )} ), std::invalid_argument );
+  sink.finalize();
+
+  /* both targets are flipped exactly when q0 and q2 are 1 and q1 is 0 */
+  const auto body = qasm_body( os.str() );
+  for ( auto input = 0u; input < 32u; ++input )
+  {
+    const auto fire = ( input & 7u ) == 5u;
+    const auto output = fire ? input ^ 24u : input;
+    const auto state = simulate_qasm( body, 5u, input );
+    CHECK( std::abs( state[output] - 1.0 ) < 1e-9 );
+  }
+}
+
+TEST_CASE( "write MCX gates by borrowing qubits as QASM", "[gate_sinks]" )
+{
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  /* 6 controls on qubits 0 to 5 and target 6, the other qubits are borrowed and restored */
+  for ( auto num_qubits : {11u, 8u} )
+  {
+    std::stringstream os;
+    qasm_gate_sink sink( os );
+    for ( auto i = 0u; i < num_qubits; ++i )
+      sink.add_qubit();
+    std::vector<qubit_id> controls;
+    for ( auto i = 0u; i < 6u; ++i )
+      controls.emplace_back( i );
+    sink.add_gate( gate::mcx, controls, std::vector<qubit_id>{qubit_id( 6u )} );
+    sink.finalize();
+
+    const auto body = qasm_body( os.str() );
+    CHECK( body.find( "u1" ) == std::string::npos );
+    if ( num_qubits == 11u )
+    {
+      CHECK( std::count( body.begin(), body.end(), '\n' ) == 16 );
+    }
+    for ( auto input = 0u; input < ( 1u << num_qubits ); input += 7u )
+    {
+      const auto output = ( input & 63u ) == 63u ? input ^ 64u : input;
+      const auto state = simulate_qasm( body, num_qubits, input );
+      CHECK( std::abs( state[output] - 1.0 ) < 1e-9 );
+    }
+  }
+
+  /* without qubits to borrow, only gates with few controls can be written */
+  std::stringstream os;
+  qasm_gate_sink sink( os );
+  for ( auto i = 0u; i < 6u; ++i )
+    sink.add_qubit();
+  std::vector<qubit_id> controls;
+  for ( auto i = 0u; i < 5u; ++i )
+    controls.emplace_back( i );
+  CHECK_THROWS_AS( sink.add_gate( gate::mcx, controls, std::vector<qubit_id>{qubit_id( 5u )} ), std::invalid_argument );
+}
+
+TEST_CASE( "write binary circuit with a gate sink", "[gate_sinks]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  const auto sorter = sorting_network();
+
+  std::stringstream os;
+  binary_gate_sink sink( os );
+  bennett_mapping_strategy<aig_network> strategy;
+  logic_network_synthesis( sink, sorter, strategy );
+  sink.finalize();
+
+  const auto data = os.str();
+  REQUIRE( data.size() > 20u );
+  CHECK( data.substr( 0, 4 ) == "CTPB" );
+
+  uint32_t num_qubits{};
+  uint64_t num_gates{};
+  std::copy( data.data() + 8, data.data() + 12, reinterpret_cast<char*>( &num_qubits ) );
+  std::copy( data.data() + 12, data.data() + 20, reinterpret_cast<char*>( &num_gates ) );
+  CHECK( num_qubits == sink.num_qubits() );
+  CHECK( num_gates == sink.num_gates() );
+
+  std::vector<qubit_id> controls;
+  for ( auto i = 0u; i < 256u; ++i )
+    controls.emplace_back( i );
+  CHECK_THROWS_AS( sink.add_gate( gate::mcx, controls, std::vector<qubit_id>{qubit_id( 256u )} ), std::invalid_argument );
+}
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <kitty/constructors.hpp>
 #include <kitty/dynamic_truth_table.hpp>
+#include <thread>
 #include <vector>
 
 #include <tweedledum/networks/netlist.hpp>
@@ -43,3 +44,126 @@ TEST_CASE( "create a netlist with one stg", "[stg netlist]" )
   CHECK( indexes == std::vector<uint32_t>{{0, 1, 2}} );
   CHECK( pol == std::vector<bool>{{false, true, false}} );
 }
+
+TEST_CASE( "compact stg storage", "[stg netlist]" )
+{
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  kitty::dynamic_truth_table maj( 3u ), maj2( 3u ), parity( 8u );
+  kitty::create_majority( maj );
+  kitty::create_majority( maj2 );
+  kitty::create_parity( parity );
+
+  std::vector<qubit_id> controls;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    controls.emplace_back( i, i % 2 == 1 );
+  }
+
+  stg_gate g1( maj, {0, 1, 2}, 3 );
+  stg_gate g2( maj2, {4, 5, 6}, 7 );
+  stg_gate g3( parity, controls, 8 );
+
+  /* functions are interned */
+  CHECK( g1.has_function() );
+  CHECK( g1.function_id() == g2.function_id() );
+  CHECK( g1.function_id() != g3.function_id() );
+  CHECK( g1.function() == maj );
+  CHECK( g3.function() == parity );
+
+  /* controls exceeding the inline storage */
+  CHECK( g3.num_controls() == 8u );
+  CHECK( g3.controls().to_vector() == controls );
+  CHECK( g3.targets()[0] == qubit_id( 8 ) );
+
+  auto g4 = g3;
+  stg_gate g5 = std::move( g3 );
+  CHECK( g4.controls().to_vector() == controls );
+  CHECK( g5.controls().to_vector() == controls );
+  g4 = g1;
+  CHECK( g4.num_controls() == 3u );
+  CHECK( g4.targets()[0] == qubit_id( 3 ) );
+
+  stg_gate cx( gate::cx, qubit_id( 1, true ), 2 );
+  CHECK( !cx.has_function() );
+  CHECK( cx.controls()[0].is_complemented() );
+  CHECK( cx.targets()[0] == qubit_id( 2 ) );
+
+  CHECK( sizeof( stg_gate ) <= sizeof( gate_base ) + 32u );
+}
+
+TEST_CASE( "concurrent access to interned functions", "[stg netlist]" )
+{
+  using namespace caterpillar;
+
+  /* 4 threads intern the same 3000 functions, crossing several chunks, and read them back */
+  std::vector<std::vector<uint32_t>> ids( 4u );
+  std::vector<uint8_t> correct( 4u, 1u );
+  std::vector<std::thread> threads;
+  for ( auto t = 0u; t < 4u; ++t )
+  {
+    threads.emplace_back( [&, t]() {
+      for ( auto i = 0u; i < 3000u; ++i )
+      {
+        kitty::dynamic_truth_table tt( 12u );
+        *tt.begin() = i;
+        const auto id = stg_function_store::instance().intern( tt );
+        ids[t].push_back( id );
+        correct[t] &= stg_function_store::instance()[id] == tt;
+      }
+    } );
+  }
+  for ( auto& thread : threads )
+  {
+    thread.join();
+  }
+
+  for ( auto t = 0u; t < 4u; ++t )
+  {
+    CHECK( correct[t] );
+    CHECK( ids[t] == ids[0] );
+  }
+  CHECK( stg_function_store::instance().size() > 3000u );
+
+  for ( auto const& ids_t : ids )
+  {
+    for ( auto id : ids_t )
+    {
+      stg_function_store::instance().release( id );
+    }
+  }
+}
+
+TEST_CASE( "interned functions are released with their last gate", "[stg netlist]" )
+{
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  auto& store = stg_function_store::instance();
+  const auto num_functions = store.num_functions();
+
+  kitty::dynamic_truth_table tt( 10u );
+  kitty::create_random( tt, 42u );
+
+  uint32_t id;
+  {
+    netlist<stg_gate> circ;
+    const auto a = circ.add_qubit();
+    const auto b = circ.add_qubit();
+    stg_gate g( tt, {a}, b );
+    id = g.function_id();
+    circ.add_gate( g );
+    auto copy = g;
+    stg_gate moved = std::move( g );
+    CHECK( store.num_functions() == num_functions + 1u );
+  }
+  CHECK( store.num_functions() == num_functions );
+
+  /* the id of a released function is reused */
+  kitty::dynamic_truth_table other( 10u );
+  kitty::create_random( other, 43u );
+  stg_gate g( other, {0}, 1 );
+  CHECK( g.function_id() == id );
+  CHECK( g.function() == other );
+}
@@ -87,3 +87,34 @@ TEST_CASE("decompose circ with many ands", "[decopmpose circ with many ands]")
 
   CHECK(caterpillar::detail::t_cost(qcirc) == 16);
 }
+
+TEST_CASE( "Exact ESOP synthesis falls back when cancelled", "[stg_from_exact_synthesis]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  /* the multiplexer is not totally symmetric and is synthesized with MaxSAT */
+  kitty::dynamic_truth_table mux( 3u );
+  kitty::create_from_hex_string( mux, "d8" );
+
+  const auto synthesize = [&]( cancellation_token const& token ) {
+    netlist<stg_gate> circ;
+    std::vector<qubit_id> qubits;
+    for ( auto i = 0u; i < 4u; ++i )
+    {
+      qubits.push_back( circ.add_qubit() );
+    }
+    stg_from_exact_synthesis( []( kitty::cube const& ) { return 1; }, token )( circ, qubits, mux );
+
+    const auto ntk = circuit_to_logic_network<xag_network>( circ, {qubits[0], qubits[1], qubits[2]}, {qubits[3]} );
+    REQUIRE( ntk );
+    const default_simulator<kitty::dynamic_truth_table> sim( 3u );
+    return simulate<kitty::dynamic_truth_table>( *ntk, sim )[0] == mux;
+  };
+
+  const auto token = cancellation_token::make();
+  CHECK( synthesize( token ) );
+  token.cancel();
+  CHECK( synthesize( token ) );
+}
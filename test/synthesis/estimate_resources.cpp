@@ -0,0 +1,148 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/klut.hpp>
+
+#include <caterpillar/structures/gate_sinks.hpp>
+#include <caterpillar/structures/stg_gate.hpp>
+#include <caterpillar/synthesis/estimate_resources.hpp>
+#include <caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp>
+#include <caterpillar/synthesis/strategies/best_fit_mapping_strategy.hpp>
+
+#include <tweedledum/algorithms/synthesis/stg.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+TEST_CASE( "estimate resources of LUT network", "[estimate_resources]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  kitty::dynamic_truth_table maj( 3u ), parity( 3u );
+  kitty::create_majority( maj );
+  kitty::create_parity( parity );
+
+  klut_network klut;
+  const auto a = klut.create_pi();
+  const auto b = klut.create_pi();
+  const auto c = klut.create_pi();
+  const auto d = klut.create_pi();
+  const auto n1 = klut.create_node( {a, b, c}, maj );
+  const auto n2 = klut.create_node( {b, c, d}, maj );
+  const auto n3 = klut.create_node( {n1, n2, a}, maj );
+  const auto n4 = klut.create_node( {n1, n2, d}, parity );
+  klut.create_po( n3 );
+  klut.create_po( n4 );
+
+  /* full synthesis */
+  netlist<stg_gate> circ;
+  bennett_mapping_strategy<klut_network> strategy;
+  logic_network_synthesis( circ, klut, strategy );
+
+  resource_counting_sink expected;
+  bennett_mapping_strategy<klut_network> strategy2;
+  logic_network_synthesis( expected, klut, strategy2 );
+
+  resource_counting_sink estimate;
+  bennett_mapping_strategy<klut_network> strategy3;
+  CHECK( estimate_resources( estimate, klut, strategy3 ) );
+
+  CHECK( estimate.num_qubits() == circ.num_qubits() );
+  CHECK( estimate.num_gates() == circ.num_gates() );
+  CHECK( estimate.num_gates() == expected.num_gates() );
+  CHECK( estimate.num_not() == expected.num_not() );
+  CHECK( estimate.num_cnot() == expected.num_cnot() );
+  CHECK( estimate.num_mcx() == expected.num_mcx() );
+  CHECK( estimate.t_count() == expected.t_count() );
+}
+
+TEST_CASE( "cache single-target gates per function", "[estimate_resources]" )
+{
+  using namespace caterpillar;
+  using namespace mockturtle;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = aig.create_and( pis[0], pis[1] );
+  auto g = aig.create_or( pis[0], pis[1] );
+  for ( auto i = 2u; i < 8u; ++i )
+  {
+    f = aig.create_xor( f, aig.create_and( pis[i], !pis[i - 1] ) );
+    g = aig.create_and( g, aig.create_xor( pis[i], f ) );
+  }
+  aig.create_po( f );
+  aig.create_po( g );
+
+  resource_counting_sink expected;
+  best_fit_mapping_strategy<aig_network> strategy;
+  logic_network_synthesis( expected, aig, strategy );
+
+  resource_counting_sink estimate;
+  best_fit_mapping_strategy<aig_network> strategy2;
+  const cached_stg_fn<stg_from_pprm> cached;
+  logic_network_synthesis_params ps;
+  ps.replay_cells = false;
+  CHECK( logic_network_synthesis( estimate, aig, strategy2, cached, ps ) );
+
+  CHECK( cached.num_hits() > 0u );
+  CHECK( estimate.num_qubits() == expected.num_qubits() );
+  CHECK( estimate.num_gates() == expected.num_gates() );
+  CHECK( estimate.t_count() == expected.t_count() );
+}
+
+namespace
+{
+
+/* adds a helper qubit for each call */
+struct stg_with_helper_qubit
+{
+  uint32_t* calls;
+
+  template<class Network>
+  void operator()( Network& net, std::vector<tweedledum::qubit_id> const& qubits, kitty::dynamic_truth_table const& ) const
+  {
+    ++*calls;
+    const auto helper = tweedledum::qubit_id( net.num_qubits() );
+    net.add_qubit();
+    net.add_gate( tweedledum::gate::cx, qubits[0], helper );
+    net.add_gate( tweedledum::gate::cx, helper, qubits.back() );
+  }
+};
+
+} // namespace
+
+TEST_CASE( "functions with helper qubits are synthesized once per call", "[estimate_resources]" )
+{
+  using namespace caterpillar;
+
+  kitty::dynamic_truth_table maj( 3u );
+  kitty::create_majority( maj );
+
+  uint32_t calls{0u};
+  const cached_stg_fn<stg_with_helper_qubit> cached( stg_with_helper_qubit{&calls} );
+
+  resource_counting_sink qnet;
+  std::vector<tweedledum::qubit_id> qubits;
+  for ( auto i = 0u; i < 4u; ++i )
+  {
+    qubits.push_back( qnet.add_qubit() );
+  }
+  for ( auto i = 0u; i < 3u; ++i )
+  {
+    cached( qnet, qubits, maj );
+  }
+
+  CHECK( calls == 3u );
+  CHECK( cached.num_misses() == 3u );
+  CHECK( cached.num_hits() == 0u );
+  CHECK( qnet.num_qubits() == 7u );
+  CHECK( qnet.num_gates() == 6u );
+}
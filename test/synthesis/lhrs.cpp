@@ -1,5 +1,8 @@
 #include <catch.hpp>
 
+#include <numeric>
+#include <sstream>
+
 #include <mockturtle/algorithms/simulation.hpp>
 #include <mockturtle/networks/aig.hpp>
 #include <mockturtle/networks/mig.hpp>
@@ -8,6 +11,8 @@
 
 #include <caterpillar/synthesis/lhrs.hpp>
 #include <caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp>
+#include <caterpillar/synthesis/strategies/best_fit_mapping_strategy.hpp>
+#include <caterpillar/synthesis/strategies/eager_mapping_strategy.hpp>
 #include <caterpillar/structures/stg_gate.hpp>
 #include <caterpillar/verification/circuit_to_logic_network.hpp>
 
@@ -133,3 +138,285 @@ TEST_CASE( "synthesize multioutput maj3", "[multiout MAJ]" )
   CHECK( simulate<kitty::static_truth_table<3>>( *ntk )[1] == ~maj );
   CHECK( simulate<kitty::static_truth_table<3>>( *ntk )[2] == maj );
 }
+
+namespace
+{
+
+struct counting_stg_from_pprm
+{
+  template<class Network>
+  void operator()( Network& network, std::vector<tweedledum::qubit_id> const& qubits, kitty::dynamic_truth_table const& function ) const
+  {
+    ++calls;
+    tweedledum::stg_from_pprm()( network, qubits, function );
+  }
+
+  mutable uint32_t calls{0u};
+};
+
+} // namespace
+
+TEST_CASE( "replay cells on uncompute", "[lhrs replay cells]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = aig.create_and( pis[0], pis[1] );
+  auto g = aig.create_or( pis[0], pis[1] );
+  for ( auto i = 2u; i < 8u; ++i )
+  {
+    f = aig.create_xor( f, aig.create_and( pis[i], !pis[i - 1] ) );
+    g = aig.create_and( g, aig.create_xor( pis[i], f ) );
+  }
+  aig.create_po( f );
+  aig.create_po( g );
+
+  netlist<stg_gate> circ_replay, circ_resynth;
+  logic_network_synthesis_stats st_replay, st_resynth;
+  counting_stg_from_pprm stg_replay, stg_resynth;
+
+  best_fit_mapping_strategy<aig_network> strategy_replay;
+  logic_network_synthesis( circ_replay, aig, strategy_replay, stg_replay, {}, &st_replay );
+
+  logic_network_synthesis_params ps;
+  ps.replay_cells = false;
+  best_fit_mapping_strategy<aig_network> strategy_resynth;
+  logic_network_synthesis( circ_resynth, aig, strategy_resynth, stg_resynth, ps, &st_resynth );
+
+  CHECK( stg_replay.calls < stg_resynth.calls );
+  CHECK( circ_replay.num_gates() == circ_resynth.num_gates() );
+  CHECK( circ_replay.num_qubits() == circ_resynth.num_qubits() );
+
+  const auto ntk = circuit_to_logic_network<xag_network>( circ_replay, st_replay.i_indexes, st_replay.o_indexes );
+  REQUIRE( ntk );
+  CHECK( simulate<kitty::static_truth_table<8>>( *ntk ) == simulate<kitty::static_truth_table<8>>( aig ) );
+}
+
+TEST_CASE( "ancilla allocation policies", "[lhrs ancilla allocation]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 6u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = aig.create_and( pis[0], pis[1] );
+  for ( auto i = 2u; i < 6u; ++i )
+  {
+    f = aig.create_or( aig.create_and( f, pis[i] ), aig.create_and( !f, !pis[i - 1] ) );
+    aig.create_po( f );
+  }
+
+  std::vector<uint32_t> num_qubits;
+  std::vector<uint64_t> holes;
+  for ( auto policy : {ancilla_allocation::lifo, ancilla_allocation::fifo, ancilla_allocation::lowest_index, ancilla_allocation::interval_coloring} )
+  {
+    netlist<stg_gate> circ;
+    eager_mapping_strategy<aig_network> strategy;
+    logic_network_synthesis_params ps;
+    ps.allocation = policy;
+    logic_network_synthesis_stats st;
+    logic_network_synthesis( circ, aig, strategy, stg_from_pprm(), ps, &st );
+
+    const auto ntk = circuit_to_logic_network<xag_network>( circ, st.i_indexes, st.o_indexes );
+    REQUIRE( ntk );
+    CHECK( simulate<kitty::static_truth_table<6>>( *ntk ) == simulate<kitty::static_truth_table<6>>( aig ) );
+
+    uint32_t computed{0u};
+    strategy.foreach_step( [&]( auto, auto const& action ) {
+      computed += std::holds_alternative<compute_action>( action ) ? 1u : 0u;
+    } );
+    CHECK( std::accumulate( st.ancilla_lifetimes.begin(), st.ancilla_lifetimes.end(), 0u ) == computed );
+    num_qubits.push_back( circ.num_qubits() );
+    holes.push_back( st.ancilla_holes );
+  }
+
+  /* all policies reuse free qubits */
+  CHECK( std::adjacent_find( num_qubits.begin(), num_qubits.end(), std::not_equal_to<>() ) == num_qubits.end() );
+
+  /* the planned values that are never released occupy the low qubits */
+  CHECK( holes[3] < holes[0] );
+  CHECK( holes[3] <= holes[2] );
+}
+
+TEST_CASE( "interval coloring of ancillae", "[lhrs ancilla allocation]" )
+{
+  using namespace caterpillar;
+
+  detail::ancilla_allocator allocator( ancilla_allocation::interval_coloring );
+  const auto inf = detail::ancilla_allocator::infinite;
+  CHECK( allocator.plan( {{1, 3}, {2, inf}, {5, 6}} ) == 2u );
+
+  uint32_t next{0u};
+  const auto new_qubit = [&]() { return next++; };
+  /* the value that is never released gets the lower qubit, although it is requested later */
+  const auto q1 = allocator.request( new_qubit );
+  const auto q2 = allocator.request( new_qubit );
+  CHECK( q1 == 1u );
+  CHECK( q2 == 0u );
+  allocator.release( q1 );
+  CHECK( allocator.request( new_qubit ) == q1 );
+  CHECK( next == 2u );
+
+  /* falls back to the left-edge coloring if first fit by length needs more colors */
+  CHECK( allocator.plan( {{1, 6}, {4, 8}, {7, 11}, {8, 9}, {9, 15}} ) == 3u );
+}
+
+TEST_CASE( "synthesize with lazily generated steps", "[lhrs lazy steps]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 6u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = aig.create_and( pis[0], pis[1] );
+  for ( auto i = 2u; i < 6u; ++i )
+  {
+    f = aig.create_or( aig.create_and( f, pis[i] ), aig.create_and( !f, !pis[i - 1] ) );
+    aig.create_po( f );
+  }
+
+  const auto check = [&]( auto&& strategy, auto&& lazy_strategy ) {
+    std::vector<std::pair<aig_network::node, std::size_t>> steps, lazy_steps;
+    strategy.compute_steps( aig );
+    strategy.foreach_step( [&]( auto n, auto const& action ) { steps.emplace_back( n, action.index() ); } );
+    const auto generator = lazy_strategy.make_step_generator( aig );
+    REQUIRE( generator );
+    while ( const auto step = generator->next() )
+    {
+      lazy_steps.emplace_back( step->first, step->second.index() );
+    }
+    CHECK( steps == lazy_steps );
+
+    netlist<stg_gate> circ;
+    logic_network_synthesis_params ps;
+    ps.lazy_steps = true;
+    logic_network_synthesis_stats st;
+    CHECK( logic_network_synthesis( circ, aig, lazy_strategy, stg_from_pprm(), ps, &st ) );
+    CHECK( lazy_strategy.num_steps() == 0u );
+    CHECK( st.qubit_timeline.empty() );
+
+    netlist<stg_gate> circ_timeline;
+    ps.lazy_qubit_timeline = true;
+    logic_network_synthesis_stats st_timeline;
+    CHECK( logic_network_synthesis( circ_timeline, aig, lazy_strategy, stg_from_pprm(), ps, &st_timeline ) );
+    CHECK( st_timeline.qubit_timeline.size() == steps.size() );
+    CHECK( st_timeline.peak_live_qubits == st.peak_live_qubits );
+
+    const auto ntk = circuit_to_logic_network<xag_network>( circ, st.i_indexes, st.o_indexes );
+    REQUIRE( ntk );
+    CHECK( simulate<kitty::static_truth_table<6>>( *ntk ) == simulate<kitty::static_truth_table<6>>( aig ) );
+  };
+
+  check( bennett_mapping_strategy<aig_network>(), bennett_mapping_strategy<aig_network>() );
+  check( eager_mapping_strategy<aig_network>(), eager_mapping_strategy<aig_network>() );
+}
+
+TEST_CASE( "cancel lazily generated steps", "[lhrs lazy steps]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  const auto a = aig.create_pi();
+  const auto b = aig.create_pi();
+  const auto c = aig.create_pi();
+  aig.create_po( aig.create_and( aig.create_and( a, b ), c ) );
+
+  const auto token = cancellation_token::make();
+  eager_mapping_strategy<aig_network> strategy;
+
+  const auto generator = strategy.make_step_generator( aig );
+  REQUIRE( generator );
+  generator->set_cancellation( token );
+  CHECK( generator->next() );
+  token.cancel();
+  while ( generator->next() )
+  {
+  }
+  CHECK( generator->failed() );
+
+  /* a partially synthesized circuit is not returned as success */
+  netlist<stg_gate> circ;
+  logic_network_synthesis_params ps;
+  ps.lazy_steps = true;
+  ps.cancellation = token;
+  CHECK( !logic_network_synthesis( circ, aig, strategy, stg_from_pprm(), ps ) );
+
+  netlist<stg_gate> circ2;
+  ps.cancellation = {};
+  CHECK( logic_network_synthesis( circ2, aig, strategy, stg_from_pprm(), ps ) );
+}
+
+TEST_CASE( "per-action synthesis statistics", "[lhrs stats]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+  auto f = aig.create_and( pis[0], pis[1] );
+  auto g = aig.create_or( pis[0], pis[1] );
+  for ( auto i = 2u; i < 8u; ++i )
+  {
+    f = aig.create_xor( f, aig.create_and( pis[i], !pis[i - 1] ) );
+    g = aig.create_and( g, aig.create_xor( pis[i], f ) );
+  }
+  aig.create_po( f );
+  aig.create_po( !g );
+
+  {
+    netlist<stg_gate> circ;
+    bennett_mapping_strategy<aig_network> strategy;
+    logic_network_synthesis_stats st;
+    logic_network_synthesis( circ, aig, strategy, stg_from_pprm(), {}, &st );
+
+    CHECK( st.compute_gates + st.uncompute_gates + st.io_gates == circ.num_gates() );
+    CHECK( st.compute_gates == st.uncompute_gates + 2u );
+    CHECK( st.io_gates == 1u );
+    CHECK( st.cell_gates == 0u );
+    CHECK( st.peak_live_qubits == circ.num_qubits() );
+    CHECK( st.qubit_timeline.size() == strategy.num_steps() );
+    CHECK( st.qubit_timeline.back() == 10u );
+  }
+
+  {
+    netlist<stg_gate> circ;
+    best_fit_mapping_strategy<aig_network> strategy;
+    logic_network_synthesis_stats st;
+    logic_network_synthesis( circ, aig, strategy, stg_from_pprm(), {}, &st );
+
+    CHECK( st.compute_gates + st.uncompute_gates + st.compute_inplace_gates + st.uncompute_inplace_gates + st.cell_gates + st.io_gates == circ.num_gates() );
+    CHECK( st.cell_gates > 0u );
+    CHECK( st.num_cell_functions > 0u );
+    CHECK( st.peak_live_qubits == *std::max_element( st.qubit_timeline.begin(), st.qubit_timeline.end() ) );
+
+    std::stringstream json;
+    st.to_json( json );
+    CHECK( json.str().front() == '{' );
+    CHECK( json.str().find( "\"peak_live_qubits\": " + std::to_string( st.peak_live_qubits ) ) != std::string::npos );
+    CHECK( json.str().find( "\"cell\": " + std::to_string( st.cell_gates ) ) != std::string::npos );
+  }
+}
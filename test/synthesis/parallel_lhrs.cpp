@@ -0,0 +1,114 @@
+#include <catch.hpp>
+
+#include <mockturtle/algorithms/simulation.hpp>
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+#include <caterpillar/structures/stg_gate.hpp>
+#include <caterpillar/synthesis/parallel_lhrs.hpp>
+#include <caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp>
+#include <caterpillar/synthesis/strategies/eager_mapping_strategy.hpp>
+#include <caterpillar/verification/circuit_to_logic_network.hpp>
+
+#include <tweedledum/algorithms/synthesis/stg.hpp>
+#include <tweedledum/networks/netlist.hpp>
+
+TEST_CASE( "synthesize independent output cones in parallel", "[parallel lhrs]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+
+  /* two disjoint cones */
+  auto f = aig.create_and( pis[0], pis[1] );
+  auto g = aig.create_or( pis[4], pis[5] );
+  for ( auto i = 1u; i < 4u; ++i )
+  {
+    f = aig.create_xor( f, aig.create_and( pis[i], !pis[i - 1] ) );
+    g = aig.create_maj( g, pis[4 + i], !pis[3 + i] );
+  }
+  aig.create_po( f );
+  aig.create_po( g );
+  /* shares most of its cone with f */
+  aig.create_po( aig.create_and( f, pis[3] ) );
+  aig.create_po( !pis[6] );
+  aig.create_po( !g );
+
+  for ( auto threads : {1u, 2u} )
+  {
+    netlist<stg_gate> circ;
+    parallel_logic_network_synthesis_params ps;
+    ps.num_threads = threads;
+    logic_network_synthesis_stats st;
+    parallel_logic_network_synthesis_stats pst;
+    CHECK( parallel_logic_network_synthesis( circ, aig, bennett_mapping_strategy<aig_network>(), stg_from_pprm(), ps, &st, &pst ) );
+
+    CHECK( pst.num_clusters == 2u );
+    CHECK( pst.reused_qubits > 0u );
+    CHECK( st.i_indexes.size() == 8u );
+    CHECK( st.o_indexes.size() == 5u );
+    CHECK( st.required_ancillae == circ.num_qubits() - 8u );
+
+    const auto ntk = circuit_to_logic_network<xag_network>( circ, st.i_indexes, st.o_indexes );
+    REQUIRE( ntk );
+    CHECK( simulate<kitty::static_truth_table<8>>( *ntk ) == simulate<kitty::static_truth_table<8>>( aig ) );
+  }
+
+  /* outputs without shared gates are never merged */
+  netlist<stg_gate> circ;
+  parallel_logic_network_synthesis_params ps;
+  ps.merge_overlap = 0.0;
+  logic_network_synthesis_stats st;
+  parallel_logic_network_synthesis_stats pst;
+  CHECK( parallel_logic_network_synthesis( circ, aig, eager_mapping_strategy<aig_network>(), stg_from_pprm(), ps, &st, &pst ) );
+  CHECK( pst.num_clusters == 2u );
+
+  const auto ntk = circuit_to_logic_network<xag_network>( circ, st.i_indexes, st.o_indexes );
+  REQUIRE( ntk );
+  CHECK( simulate<kitty::static_truth_table<8>>( *ntk ) == simulate<kitty::static_truth_table<8>>( aig ) );
+}
+
+TEST_CASE( "complemented input outputs do not affect later clusters", "[parallel lhrs]" )
+{
+  using namespace mockturtle;
+  using namespace caterpillar;
+  using namespace tweedledum;
+
+  aig_network aig;
+  std::vector<aig_network::signal> pis;
+  for ( auto i = 0u; i < 8u; ++i )
+  {
+    pis.push_back( aig.create_pi() );
+  }
+
+  /* !pis[6] is an output before the cluster that reads pis[6] */
+  auto f = aig.create_and( pis[0], pis[1] );
+  for ( auto i = 2u; i < 6u; ++i )
+  {
+    f = aig.create_xor( f, pis[i] );
+  }
+  aig.create_po( f );
+  aig.create_po( !pis[6] );
+  aig.create_po( aig.create_and( pis[6], pis[7] ) );
+  aig.create_po( pis[6] );
+  aig.create_po( aig.get_constant( true ) );
+  aig.create_po( !pis[6] );
+
+  netlist<stg_gate> circ;
+  logic_network_synthesis_stats st;
+  parallel_logic_network_synthesis_stats pst;
+  CHECK( parallel_logic_network_synthesis( circ, aig, bennett_mapping_strategy<aig_network>(), stg_from_pprm(), {}, &st, &pst ) );
+  CHECK( pst.num_clusters == 2u );
+  CHECK( st.o_indexes.size() == 6u );
+
+  const auto ntk = circuit_to_logic_network<xag_network>( circ, st.i_indexes, st.o_indexes );
+  REQUIRE( ntk );
+  CHECK( simulate<kitty::static_truth_table<8>>( *ntk ) == simulate<kitty::static_truth_table<8>>( aig ) );
+}
@@ -1,5 +1,10 @@
 #include <catch.hpp>
 
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <caterpillar/structures/cancellation_token.hpp>
 #include <caterpillar/synthesis/satbased_cnotrz.hpp>
 #include <tweedledum/gates/mcst_gate.hpp>
 #include <tweedledum/io/write_unicode.hpp>
@@ -34,6 +39,33 @@ TEST_CASE( "Optimum phase polynomial circuit for Toffoli with 2 controls", "[sat
   CHECK( circ.num_qubits() == 3u );
 }
 
+TEST_CASE( "Optimum phase polynomial circuit with glucose backend", "[satbased_cnotrz]" )
+{
+  tweedledum::bit_matrix_rm<> transform( 3u, 3u );
+  transform.at( 0, 0 ) = 1;
+  transform.at( 1, 1 ) = 1;
+  transform.at( 2, 2 ) = 1;
+
+  tweedledum::parity_terms terms;
+  constexpr auto T = tweedledum::symbolic_angles::one_eighth;
+  constexpr auto Tdag = tweedledum::symbolic_angles::seven_eighth;
+
+  terms.add_term( 0b001, T );
+  terms.add_term( 0b010, T );
+  terms.add_term( 0b011, Tdag );
+  terms.add_term( 0b100, T );
+  terms.add_term( 0b101, Tdag );
+  terms.add_term( 0b110, Tdag );
+  terms.add_term( 0b111, T );
+
+  caterpillar::satbased_cnotrz_params ps;
+  ps.backend = caterpillar::sat_backend::glucose;
+  const auto circ = caterpillar::satbased_cnotrz<tweedledum::netlist<tweedledum::mcst_gate>>( transform, terms, ps );
+
+  CHECK( circ.num_gates() == 13u );
+  CHECK( circ.num_qubits() == 3u );
+}
+
 TEST_CASE( "Optimum phase polynomial circuit for Toffoli with 3 controls", "[satbased_cnotrz]" )
 {
   return; // ? (this test case takes a while, but works)
@@ -97,3 +129,57 @@ TEST_CASE( "Optimum phase polynomial circuit for smaller circuit with 4 qubits",
   CHECK( circ.num_gates() == 16u );
   CHECK( circ.num_qubits() == 4u );
 }
+
+TEST_CASE( "Heuristic phase polynomial circuit after cancellation", "[satbased_cnotrz]" )
+{
+  tweedledum::bit_matrix_rm<> transform( 3u, 3u );
+  transform.at( 0, 0 ) = 1;
+  transform.at( 0, 1 ) = 1;
+  transform.at( 1, 2 ) = 1;
+  transform.at( 2, 0 ) = 1;
+  transform.at( 2, 2 ) = 1;
+
+  tweedledum::parity_terms terms;
+  constexpr auto T = tweedledum::symbolic_angles::one_eighth;
+  constexpr auto Tdag = tweedledum::symbolic_angles::seven_eighth;
+
+  terms.add_term( 0b001, T );
+  terms.add_term( 0b011, Tdag );
+  terms.add_term( 0b101, Tdag );
+  terms.add_term( 0b110, Tdag );
+  terms.add_term( 0b111, T );
+
+  caterpillar::satbased_cnotrz_params ps;
+  ps.cancellation = caterpillar::cancellation_token::make();
+  ps.cancellation.cancel();
+  caterpillar::satbased_cnotrz_stats st;
+  const auto circ = caterpillar::satbased_cnotrz<tweedledum::netlist<tweedledum::mcst_gate>>( transform, terms, ps, &st );
+
+  CHECK( st.cancelled );
+  CHECK( circ.num_qubits() == 3u );
+
+  /* track the parity on each qubit and the rotations applied to each parity */
+  std::vector<uint32_t> states{0b001, 0b010, 0b100};
+  std::map<uint32_t, double> angles;
+  circ.foreach_cgate( [&]( auto const& node ) {
+    if ( node.gate.is( tweedledum::gate_set::cx ) )
+    {
+      uint32_t control{0u}, target{0u};
+      node.gate.foreach_control( [&]( auto q ) { control = q; } );
+      node.gate.foreach_target( [&]( auto q ) { target = q; } );
+      states[target] ^= states[control];
+    }
+    else
+    {
+      CHECK( node.gate.is_z_rotation() );
+      node.gate.foreach_target( [&]( auto q ) { angles[states[q]] += node.gate.rotation_angle().numeric_value(); } );
+    }
+  } );
+
+  CHECK( states == std::vector<uint32_t>{0b011, 0b100, 0b101} );
+  CHECK( angles.size() == terms.num_terms() );
+  for ( auto const& [term, angle] : terms )
+  {
+    CHECK( angles[term] == Approx( angle.numeric_value() ) );
+  }
+}